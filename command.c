@@ -0,0 +1,324 @@
+/******************************************************************************
+ * Line oriented command interpreter
+ *
+ * Description:
+ *
+ * See command.h. Characters are gathered into a line buffer as they arrive.
+ * Nothing is parsed until the carriage return, and then the line is split
+ * into words in place and looked up in the command table.
+ *
+ *****************************************************************************/
+
+// system includes
+#include <string.h>
+
+// project includes
+#include "command.h"
+
+// Definitions
+
+// Kinds of argument a command takes.
+#define ARG_NUMBER 0
+#define ARG_MODE   1
+
+#define BACKSPACE  0x08
+#define DELETE     0x7F
+
+// One entry of the command table.
+typedef struct
+{
+   const char* name;
+   UINT8 id;
+   UINT8 minArgs;
+   UINT8 maxArgs;
+   UINT8 argType;
+} CommandEntry;
+
+// Maps a mode name onto its MODE_ value.
+typedef struct
+{
+   const char* name;
+   UINT8 id;
+} ModeEntry;
+
+static const CommandEntry commandTable[] =
+{
+   { "RANGE",   CMD_RANGE,   2, 2, ARG_NUMBER },
+   { "CAPTURE", CMD_CAPTURE, 1, 2, ARG_NUMBER },
+   { "MODE",    CMD_MODE,    1, 1, ARG_MODE   },
+   { "DUMP",    CMD_DUMP,    0, 0, ARG_NUMBER },
+   { "STATS",   CMD_STATS,   0, 0, ARG_NUMBER },
+   { "RESET",   CMD_RESET,   0, 0, ARG_NUMBER },
+   { "EXIT",    CMD_EXIT,    0, 0, ARG_NUMBER },
+   { "PROFILE", CMD_PROFILE, 0, 0, ARG_NUMBER },
+   { "TRACE",   CMD_TRACE,   0, 0, ARG_NUMBER },
+   { "GLITCH",  CMD_GLITCH,  1, 1, ARG_NUMBER },
+   { "SKEW",    CMD_SKEW,    1, 2, ARG_NUMBER },
+   { "MAP",     CMD_MAP,     1, 1, ARG_NUMBER },
+   { "DUMPMAP", CMD_DUMPMAP, 0, 0, ARG_NUMBER },
+   { "WINDOW",  CMD_WINDOW,  1, 1, ARG_NUMBER },
+   { "POLL",    CMD_POLL,    0, 0, ARG_NUMBER }
+};
+
+static const ModeEntry modeTable[] =
+{
+   { "BATCH", MODE_BATCH },
+   { "PAGED", MODE_PAGED },
+   { "LIVE",  MODE_LIVE  }
+};
+
+#define COMMAND_TABLE_SIZE (sizeof(commandTable) / sizeof(commandTable[0]))
+#define MODE_TABLE_SIZE    (sizeof(modeTable) / sizeof(modeTable[0]))
+
+// The line being collected. One extra byte for the terminating null.
+static char lineBuffer[COMMAND_MAX_LINE + 1];
+static UINT8 lineLength = 0;
+
+// Set when the line ran past COMMAND_MAX_LINE, the rest of it is dropped.
+static UINT8 lineOverflow = 0;
+
+//*****************************************************************************
+// Splits off the next space separated word of the line.
+//
+// Parameters:
+//    cursor  Points at the current position in the line, advanced past the
+//            word on return.
+//
+// Return: The null terminated word, or a null pointer at the end of the line.
+//*****************************************************************************
+static char* nextWord(char** cursor)
+{
+   char* word = *cursor;
+
+   while (*word == ' ')
+   {
+      ++word;
+   }
+
+   if (*word == 0)
+   {
+      return 0;
+   }
+
+   *cursor = word;
+   while (**cursor != 0 && **cursor != ' ')
+   {
+      ++*cursor;
+   }
+
+   if (**cursor == ' ')
+   {
+      **cursor = 0;
+      ++*cursor;
+   }
+
+   return word;
+}
+
+//*****************************************************************************
+// Converts a word of decimal digits into a 16-bit value.
+//
+// Parameters:
+//    word   The word to convert.
+//    value  Where the value is stored.
+//
+// Return: Non-zero on success, zero if the word isn't a number or is bigger
+//         than 65535.
+//*****************************************************************************
+static UINT8 parseNumber(const char* word, UINT16* value)
+{
+   UINT32 result = 0;
+
+   do
+   {
+      if (*word < '0' || *word > '9')
+      {
+         return 0;
+      }
+
+      result = result * 10 + (UINT8)(*word - '0');
+      if (result > 65535UL)
+      {
+         return 0;
+      }
+
+      ++word;
+   }
+   while (*word != 0);
+
+   *value = (UINT16)result;
+   return 1;
+}
+
+//*****************************************************************************
+// Looks up a mode name.
+//
+// Parameters:
+//    word   The mode name.
+//    value  Where the MODE_ value is stored.
+//
+// Return: Non-zero if the name is known.
+//*****************************************************************************
+static UINT8 parseMode(const char* word, UINT16* value)
+{
+   UINT8 i;
+
+   for (i = 0; i < MODE_TABLE_SIZE; ++i)
+   {
+      if (strcmp(word, modeTable[i].name) == 0)
+      {
+         *value = modeTable[i].id;
+         return 1;
+      }
+   }
+
+   return 0;
+}
+
+//*****************************************************************************
+// Parses the completed line in lineBuffer.
+//
+// Parameters:
+//    command  Filled in with the result.
+//
+// Return: The command id, CMD_NONE for an empty line.
+//*****************************************************************************
+static UINT8 parseLine(Command* command)
+{
+   char* cursor = lineBuffer;
+   char* word;
+   const CommandEntry* entry = 0;
+   UINT8 i;
+
+   command->argCount = 0;
+   command->error = 0;
+   command->id = CMD_ERROR;
+
+   word = nextWord(&cursor);
+   if (word == 0)
+   {
+      command->id = CMD_NONE;
+      return CMD_NONE;
+   }
+
+   for (i = 0; i < COMMAND_TABLE_SIZE; ++i)
+   {
+      if (strcmp(word, commandTable[i].name) == 0)
+      {
+         entry = &commandTable[i];
+         break;
+      }
+   }
+
+   if (entry == 0)
+   {
+      command->error = "UNKNOWN COMMAND";
+      return CMD_ERROR;
+   }
+
+   while ((word = nextWord(&cursor)) != 0)
+   {
+      if (command->argCount == entry->maxArgs)
+      {
+         command->error = "TOO MANY ARGUMENTS";
+         return CMD_ERROR;
+      }
+
+      if (entry->argType == ARG_MODE)
+      {
+         if (!parseMode(word, &command->args[command->argCount]))
+         {
+            command->error = "UNKNOWN MODE";
+            return CMD_ERROR;
+         }
+      }
+      else if (!parseNumber(word, &command->args[command->argCount]))
+      {
+         command->error = "BAD NUMBER";
+         return CMD_ERROR;
+      }
+
+      ++command->argCount;
+   }
+
+   if (command->argCount < entry->minArgs)
+   {
+      command->error = "MISSING ARGUMENTS";
+      return CMD_ERROR;
+   }
+
+   command->id = entry->id;
+   return command->id;
+}
+
+//*****************************************************************************
+// Reads whatever characters are waiting and parses the line once its carriage
+// return arrives. Line feeds are ignored so CR/LF terminated lines work too,
+// and backspace removes the last character.
+//
+// Parameters:
+//    command  Filled in when a complete line has been read.
+//
+// Return: The id of the parsed command, or CMD_NONE if the line isn't
+//         complete yet.
+//*****************************************************************************
+UINT8 CommandPoll(Command* command)
+{
+   UINT8 ch;
+   UINT8 id;
+
+   while (PollChar(&ch))
+   {
+      if (ch == '\r')
+      {
+         lineBuffer[lineLength] = 0;
+
+         if (lineOverflow)
+         {
+            command->id = CMD_ERROR;
+            command->argCount = 0;
+            command->error = "LINE TOO LONG";
+            id = CMD_ERROR;
+         }
+         else
+         {
+            id = parseLine(command);
+         }
+
+         lineLength = 0;
+         lineOverflow = 0;
+
+         // Hand back one command at a time, the rest waits for the next poll.
+         if (id != CMD_NONE)
+         {
+            return id;
+         }
+      }
+      else if (ch == BACKSPACE || ch == DELETE)
+      {
+         if (lineLength > 0)
+         {
+            --lineLength;
+         }
+      }
+      else if (ch != '\n')
+      {
+         if (lineLength < COMMAND_MAX_LINE)
+         {
+            // Words are matched in upper case.
+            if (ch >= 'a' && ch <= 'z')
+            {
+               ch = (UINT8)(ch - 'a' + 'A');
+            }
+            lineBuffer[lineLength] = (char)ch;
+            ++lineLength;
+         }
+         else
+         {
+            lineOverflow = 1;
+         }
+      }
+   }
+
+   return CMD_NONE;
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+ * Line oriented command interpreter
+ *
+ * Description:
+ *
+ * Collects characters from SCI0 without ever waiting for them and turns each
+ * completed line into a Command. The caller polls CommandPoll from its main
+ * loop, so reading a command never holds up a capture that is in progress.
+ *
+ * A line is a command word followed by up to COMMAND_MAX_ARGS arguments,
+ * separated by spaces and ended by a carriage return. Words are not case
+ * sensitive. Numeric arguments are decimal values from 0 to 65535, and the
+ * MODE command takes one of the mode names instead of a number.
+ *
+ *****************************************************************************/
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include "types.h"
+
+// Longest line accepted, not counting the carriage return.
+#define COMMAND_MAX_LINE 32
+
+// Most arguments any command takes.
+#define COMMAND_MAX_ARGS 2
+
+// Command identifiers.
+#define CMD_NONE     0   // no complete line yet
+#define CMD_RANGE    1   // RANGE <lowerUs> <upperUs>
+#define CMD_CAPTURE  2   // CAPTURE <intervals> [<durationMs>]
+#define CMD_MODE     3   // MODE <name>
+#define CMD_DUMP     4   // DUMP
+#define CMD_STATS    5   // STATS
+#define CMD_RESET    6   // RESET
+#define CMD_EXIT     7   // EXIT
+#define CMD_ERROR    8   // the line could not be parsed, see Command.error
+#define CMD_PROFILE  9   // PROFILE
+#define CMD_TRACE    10  // TRACE
+#define CMD_GLITCH   11  // GLITCH <minimumUs>
+#define CMD_SKEW     12  // SKEW <pairs> [<durationMs>]
+#define CMD_MAP      13  // MAP <cellsPerSide>
+#define CMD_DUMPMAP  14  // DUMPMAP
+#define CMD_WINDOW   15  // WINDOW <intervals>
+#define CMD_POLL     16  // POLL
+
+// Mode identifiers, passed as the argument of CMD_MODE.
+#define MODE_BATCH   0   // DUMP writes the fixed machine readable layout
+#define MODE_PAGED   1   // DUMP pages through the buckets one key at a time
+#define MODE_LIVE    2   // changed buckets are streamed while capturing
+
+// A parsed command line.
+typedef struct
+{
+   UINT8 id;                          // one of the CMD_ values
+   UINT8 argCount;                    // number of arguments present
+   UINT16 args[COMMAND_MAX_ARGS];     // numeric or MODE_ arguments
+   const char* error;                 // reason when id is CMD_ERROR
+} Command;
+
+// Provided by main.c. Fetches a received character without waiting for one.
+// Returns non-zero and stores the character when one was available.
+UINT8 PollChar(UINT8* ch);
+
+//*****************************************************************************
+// Reads whatever characters are waiting and parses the line once its carriage
+// return arrives.
+//
+// Parameters:
+//    command  Filled in when a complete line has been read.
+//
+// Return: The id of the parsed command, or CMD_NONE if the line isn't
+//         complete yet.
+//*****************************************************************************
+UINT8 CommandPoll(Command* command);
+
+#endif // COMMAND_H
@@ -115,7 +115,7 @@
 #define USE_SEVERAL_PAGES 0
 
 #if defined(__DPAGE__) /* check which pages are used  */
-#define PAGE_ADDR PPAGE_ADDR
+#define PAGE_ADDR DPAGE_ADDR
 #elif defined(__EPAGE__)
 #define PAGE_ADDR EPAGE_ADDR
 #elif defined(__PPAGE__)
@@ -770,6 +770,224 @@ done:
 #endif /* USE_SEVERAL_PAGES */
 }
 
+#if USE_SEVERAL_PAGES /* only needed for several pages support */
+/*--------------------------- _PAGE_RUN_END --------------------------------
+  Runtime routine to find the last offset of the page window, or of the unpaged
+  area, an address is in. A block copy can run up to there with the page
+  registers set once. The bounds of all windows are used, whether their page
+  register is in use or not, so a run never spans two of them.
+
+  Arguments :
+  - Y : offset part of an address
+
+  Result :
+  - D : last offset of the area Y is in
+  - all other registers remain unchanged
+  --------------------------- _PAGE_RUN_END ----------------------------------*/
+
+#ifdef __cplusplus
+extern "C"
+#endif
+#pragma NO_ENTRY
+#pragma NO_EXIT
+#pragma NO_FRAME
+
+static void NEAR _PAGE_RUN_END(void) { /*lint -esym(528, _PAGE_RUN_END) used in asm code */
+  asm {
+        LDD     #EPAGE_LOW_BOUND-1
+        CPY     #EPAGE_LOW_BOUND  ;/* below EPAGE */
+        BLO     L_END
+        LDD     #EPAGE_HIGH_BOUND
+        CPY     #EPAGE_HIGH_BOUND ;/* in EPAGE */
+        BLS     L_END
+        LDD     #DPAGE_LOW_BOUND-1
+        CPY     #DPAGE_LOW_BOUND  ;/* between EPAGE and DPAGE */
+        BLO     L_END
+        LDD     #DPAGE_HIGH_BOUND
+        CPY     #DPAGE_HIGH_BOUND ;/* in DPAGE */
+        BLS     L_END
+        LDD     #PPAGE_HIGH_BOUND
+        CPY     #PPAGE_HIGH_BOUND ;/* in PPAGE */
+        BLS     L_END
+        LDD     #0xFFFF           ;/* above PPAGE */
+L_END:
+        RTS
+  }
+}
+
+/*--------------------------- _FAR_COPY_RUNS --------------------------------
+  Block copy for several pages, used by _FAR_COPY_RC and _FAR_COPY.
+  The copy is split where the source or the destination crosses into another
+  page window. For each run the page registers are looked up once, saved, set
+  and restored once, and the bytes are moved a word at a time:
+  - source and destination use different page registers, or none, or the same
+    one with the same page: both are set and the run is moved with MOVW.
+  - both are in the same window on different pages: the page register is
+    switched for every word.
+  An odd byte is moved first.
+
+  Arguments :
+  - offset part of the source in the X register
+  - page part of the source in the A register
+  - offset part of the dest in the Y register
+  - page part of the dest in the B register
+  - number of bytes to be copied on the stack above the return address
+
+  Result :
+  - memory area copied
+  - no registers are saved, i.e. all registers may be destroyed
+  - all page register still contain the same value as before the call
+  - the number of bytes stays on the stack
+
+  stack-structure at the run-label:
+     0,SP : bytes in this run, then words
+     2,SP : source page register, 0 if none
+     4,SP : destination page register, 0 if none
+     6,SP : saved source page register
+     7,SP : saved destination page register
+     8,SP : temporary
+    10,SP : destination offset
+    12,SP : source offset
+    14,SP : source page
+    15,SP : destination page
+    16,SP : return address
+    18,SP : bytes still to be copied
+  --------------------------- _FAR_COPY_RUNS ----------------------------------*/
+
+#ifdef __cplusplus
+extern "C"
+#endif
+#pragma NO_ENTRY
+#pragma NO_EXIT
+#pragma NO_FRAME
+
+static void NEAR _FAR_COPY_RUNS(void) { /*lint -esym(528, _FAR_COPY_RUNS) used in asm code */
+  asm {
+        PSHD                      ;/* save both pages */
+        PSHX                      ;/* save source offset */
+        PSHY                      ;/* save destination offset */
+        LEAS    -10,SP            ;/* locals */
+run:
+        LDD     18,SP             ;/* bytes still to be copied */
+        LBEQ    done
+        SUBD    #1
+        STD     0,SP              ;/* run length-1, at most what is left */
+        LDY     12,SP
+        __PIC_JSR(_PAGE_RUN_END)  ;/* end of the source window */
+        SUBD    12,SP
+        CPD     0,SP
+        BHS     src_fits
+        STD     0,SP              ;/* source window ends first */
+src_fits:
+        LDY     10,SP
+        __PIC_JSR(_PAGE_RUN_END)  ;/* end of the destination window */
+        SUBD    10,SP
+        CPD     0,SP
+        BHS     dest_fits
+        STD     0,SP              ;/* destination window ends first */
+dest_fits:
+        LDD     0,SP
+        ADDD    #1
+        STD     0,SP              ;/* bytes in this run */
+        LDD     18,SP
+        SUBD    0,SP
+        STD     18,SP             ;/* bytes left after it */
+
+        LDX     #0
+        LDY     12,SP
+        __PIC_JSR(_GET_PAGE_REG)  ;/* X stays 0 for unpaged */
+        STX     2,SP              ;/* source page register */
+        BEQ     src_saved
+        MOVB    0,X, 6,SP         ;/* save it */
+src_saved:
+        LDX     #0
+        LDY     10,SP
+        __PIC_JSR(_GET_PAGE_REG)
+        STX     4,SP              ;/* destination page register */
+        BEQ     dest_saved
+        MOVB    0,X, 7,SP         ;/* save it */
+dest_saved:
+        LDX     2,SP
+        BEQ     direct            ;/* unpaged source */
+        CPX     4,SP
+        BNE     direct            ;/* different page registers */
+        LDAA    14,SP
+        CMPA    15,SP
+        BNE     switched          ;/* same window, different pages */
+
+direct:
+        LDX     2,SP
+        BEQ     direct_src
+        MOVB    14,SP, 0,X        ;/* set source page */
+direct_src:
+        LDX     4,SP
+        BEQ     direct_dest
+        MOVB    15,SP, 0,X        ;/* set destination page */
+direct_dest:
+        LDX     12,SP             ;/* source */
+        LDY     10,SP             ;/* destination */
+        LDD     0,SP
+        BITB    #1
+        BEQ     direct_even
+        MOVB    1,X+, 1,Y+        ;/* odd byte */
+direct_even:
+        LSRD                      ;/* words */
+        BEQ     run_done
+direct_loop:
+        MOVW    2,X+, 2,Y+
+        DBNE    D, direct_loop
+        BRA     run_done
+
+switched:
+        LDX     12,SP             ;/* source */
+        LDY     10,SP             ;/* destination */
+        LDD     0,SP
+        BITB    #1
+        BEQ     switched_even
+        LDAA    14,SP
+        STAA    [2,SP]            ;/* set source page */
+        LDAB    1,X+              ;/* odd byte */
+        LDAA    15,SP
+        STAA    [2,SP]            ;/* set destination page */
+        STAB    1,Y+
+switched_even:
+        LDD     0,SP
+        LSRD                      ;/* words */
+        BEQ     run_done
+        STD     0,SP
+switched_loop:
+        LDAA    14,SP
+        STAA    [2,SP]            ;/* set source page */
+        LDD     2,X+              ;/* load word */
+        STD     8,SP
+        LDAA    15,SP
+        STAA    [2,SP]            ;/* set destination page */
+        MOVW    8,SP, 2,Y+        ;/* store word */
+        LDD     0,SP
+        SUBD    #1
+        STD     0,SP
+        BNE     switched_loop
+
+run_done:
+        STX     12,SP             ;/* next source offset */
+        STY     10,SP             ;/* next destination offset */
+        LDX     4,SP
+        BEQ     dest_restored
+        MOVB    7,SP, 0,X         ;/* restore destination page register */
+dest_restored:
+        LDX     2,SP
+        BEQ     src_restored
+        MOVB    6,SP, 0,X         ;/* restore source page register */
+src_restored:
+        LBRA    run
+
+done:
+        LEAS    16,SP             ;/* release stack */
+        RTS
+  }
+}
+#endif /* USE_SEVERAL_PAGES */
+
 /*--------------------------- _FAR_COPY_RC --------------------------------
   This runtime routine is used to access paged memory via a runtime function.
   It may also be used if the compiler  option -Cp is not used with the runtime argument.
@@ -788,12 +1006,8 @@ done:
   - the function returns after the constant defining the number of bytes to be copied
 
 
-  stack-structure at the loop-label:
-     0,SP : destination offset
-     2,SP : source page
-     3,SP : destination page
-     4,SP : source offset
-     6,SP : points to length to be copied. This function returns after the size
+  With several pages the copy is done by _FAR_COPY_RUNS, a word at a time and with
+  the page registers set once per page window, not once per byte.
 
   A usual call to this function looks like:
 
@@ -819,28 +1033,14 @@ extern "C"
 void NEAR _FAR_COPY_RC(void) {
 #if USE_SEVERAL_PAGES
   asm {
-        DEX                       ;/* source addr-=1, because loop counter ends at 1 */
+        LEAS    -2,SP             ;/* room for the size */
         PSHX                      ;/* save source offset */
-        PSHD                      ;/* save both pages */
-        DEY                       ;/* destination addr-=1, because loop counter ends at 1 */
-        PSHY                      ;/* save destination offset */
-        LDY     6,SP              ;/* Load Return address */
-        LDX     2,Y+              ;/* Load Size to copy */
-        STY     6,SP              ;/* Store adjusted return address */
-loop:
-        LDD     4,SP              ;/* load source offset */
-        LEAY    D,X               ;/* calculate actual source address */
-        LDAB    2,SP              ;/* load source page */
-        __PIC_JSR(_LOAD_FAR_8)    ;/* load 1 source byte */
-        PSHB                      ;/* save value */
-        LDD     0+1,SP            ;/* load destination offset */
-        LEAY    D,X               ;/* calculate actual destination address */
-        PULA                      ;/* restore value */
-        LDAB    3,SP              ;/* load destination page */
-        __PIC_JSR(_STORE_FAR_8)   ;/* store one byte */
-        DEX
-        BNE     loop
-        LEAS    6,SP              ;/* release stack */
+        LDX     4,SP              ;/* Load Return address */
+        MOVW    2,X+, 2,SP        ;/* Load Size to copy */
+        STX     4,SP              ;/* Store adjusted return address */
+        PULX                      ;/* restore source offset */
+        __PIC_JSR(_FAR_COPY_RUNS)
+        LEAS    2,SP              ;/* release stack */
         _SRET                     ;/* debug info only: This is the last instr of a function with a special return */
         RTS                       ;/* return */
   }
@@ -896,28 +1096,11 @@ extern "C"
 void NEAR _FAR_COPY(void) {
 #if USE_SEVERAL_PAGES
   asm {
-        DEX                       ;/* source addr-=1, because loop counter ends at 1 */
-        PSHX                      ;/* save source offset */
-        PSHD                      ;/* save both pages */
-        DEY                       ;/* destination addr-=1, because loop counter ends at 1 */
-        PSHY                      ;/* save destination offset */
-        LDX     8,SP              ;/* load counter, assuming counter > 0 */
-
-loop:
-        LDD     4,SP              ;/* load source offset */
-        LEAY    D,X               ;/* calculate actual source address */
-        LDAB    2,SP              ;/* load source page */
-        __PIC_JSR(_LOAD_FAR_8)    ;/* load 1 source byte */
-        PSHB                      ;/* save value */
-        LDD     0+1,SP            ;/* load destination offset */
-        LEAY    D,X               ;/* calculate actual destination address */
-        PULA                      ;/* restore value */
-        LDAB    3,SP              ;/* load destination page */
-        __PIC_JSR(_STORE_FAR_8)   ;/* store one byte */
-        DEX
-        BNE     loop
-        LDX     6,SP              ;/* load return address */
-        LEAS    10,SP             ;/* release stack */
+        LEAS    -2,SP
+        MOVW    4,SP, 0,SP        ;/* pass the counter on */
+        __PIC_JSR(_FAR_COPY_RUNS)
+        LDX     2,SP              ;/* load return address */
+        LEAS    6,SP              ;/* release stack */
         JMP     0,X               ;/* return */
   }
 #else
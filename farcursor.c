@@ -0,0 +1,84 @@
+/******************************************************************************
+ * Sequential access to paged memory
+ *
+ * Description:
+ *
+ * See farcursor.h. The routines here are only called when a cursor opens,
+ * closes or reaches the end of the window, the accesses in between are the
+ * macros' near loads and stores. They change the page register, so on the
+ * target they go in non-banked flash.
+ *
+ *****************************************************************************/
+
+// project includes
+#include "farcursor.h"
+
+// The cursor maps pages into the PPAGE window, so it mustn't be banked
+// itself. It is on the deep capture's hot path as well.
+#include "hal_hot_begin.h"
+
+//*****************************************************************************
+// Opens a cursor on a buffer in paged memory.
+//
+// Parameters:
+//    cursor  The cursor.
+//    page    Page the buffer starts on.
+//    offset  Where it starts in the window, even.
+//    index   Word of the buffer to start at.
+//
+// Return: None.
+//*****************************************************************************
+void FarCursorOpen(FarCursor* cursor, UINT8 page, UINT16 offset, UINT16 index)
+{
+   UINT16 word;
+
+   // word of the window the buffer starts at, plus how far in to go.
+   word = (UINT16)((offset - HAL_PAGE_WINDOW_START) >> 1);
+   page = (UINT8)(page + index / HAL_PAGE_WINDOW_WORDS);
+   index = (UINT16)(index % HAL_PAGE_WINDOW_WORDS);
+   if (index >= HAL_PAGE_WINDOW_WORDS - word)
+   {
+      ++page;
+      index = (UINT16)(index - (HAL_PAGE_WINDOW_WORDS - word));
+      word = 0;
+   }
+
+   cursor->savedPage = HAL_PAGE_GET();
+   cursor->page = page;
+   HAL_PAGE_SET(page);
+
+   cursor->next = HAL_PAGE_WINDOW() + word + index;
+   cursor->end = HAL_PAGE_WINDOW() + HAL_PAGE_WINDOW_WORDS;
+}
+
+//*****************************************************************************
+// Moves a cursor that has reached the end of the window onto the next page.
+//
+// Parameters:
+//    cursor  The cursor.
+//
+// Return: None.
+//*****************************************************************************
+void FarCursorNextPage(FarCursor* cursor)
+{
+   ++cursor->page;
+   HAL_PAGE_SET(cursor->page);
+
+   cursor->next = HAL_PAGE_WINDOW();
+   cursor->end = HAL_PAGE_WINDOW() + HAL_PAGE_WINDOW_WORDS;
+}
+
+//*****************************************************************************
+// Closes a cursor, the window gets back the page it had before.
+//
+// Parameters:
+//    cursor  The cursor.
+//
+// Return: None.
+//*****************************************************************************
+void FarCursorClose(FarCursor* cursor)
+{
+   HAL_PAGE_SET(cursor->savedPage);
+}
+
+#include "hal_hot_end.h"
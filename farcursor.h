@@ -0,0 +1,84 @@
+/******************************************************************************
+ * Sequential access to paged memory
+ *
+ * Description:
+ *
+ * A far pointer dereference goes through _LOAD_FAR_16 or _STORE_FAR_16 in
+ * datapage.c, which works out the page register, saves it, sets it and
+ * restores it again for every single word. A cursor does that once: it maps
+ * the page into the HAL's page window and then walks the window with a near
+ * pointer, so each word costs what a near access does. Only when it runs off
+ * the end of the window is the next page mapped in, and the walk goes on
+ * from the start of the window. A buffer can run over as many pages as
+ * there are.
+ *
+ * The page register stays set from FarCursorOpen to FarCursorClose. In
+ * between, nothing else may use the window, which means the code doing the
+ * walk must not be banked when the window is PPAGE's, and there can be only
+ * one cursor open at a time. Interrupt service routines don't touch paged
+ * memory.
+ *
+ *    FarCursor cursor;
+ *
+ *    FarCursorOpen(&cursor, page, offset, first);
+ *    for (i = 0; i < count; ++i)
+ *    {
+ *       FAR_CURSOR_READ(&cursor, value);
+ *       ...
+ *    }
+ *    FarCursorClose(&cursor);
+ *
+ *****************************************************************************/
+
+#ifndef FARCURSOR_H
+#define FARCURSOR_H
+
+#include "hal.h"
+
+typedef struct
+{
+   UINT16* next;          // next word, inside the window
+   UINT16* end;           // end of the window
+   UINT8 page;            // page mapped into the window
+   UINT8 savedPage;       // what the window had before the cursor opened
+} FarCursor;
+
+// Near and non-banked, see farcursor.c.
+#include "hal_hot_begin.h"
+
+// Maps the page in and points the cursor at word index of a buffer that
+// starts at page:offset. The offset has to be even and inside the window,
+// index can take it onto the pages after.
+void FarCursorOpen(FarCursor* cursor, UINT8 page, UINT16 offset, UINT16 index);
+
+// Maps the next page in and points the cursor at its first word.
+void FarCursorNextPage(FarCursor* cursor);
+
+// Puts back the page the window had before.
+void FarCursorClose(FarCursor* cursor);
+
+#include "hal_hot_end.h"
+
+// Reads or writes the next word and moves on. Inline, the page only
+// changes at the end of the window.
+#define FAR_CURSOR_READ(cursor, value)                \
+   do                                                 \
+   {                                                  \
+      if ((cursor)->next == (cursor)->end)            \
+      {                                               \
+         FarCursorNextPage(cursor);                   \
+      }                                               \
+      (value) = *(cursor)->next++;                    \
+   } while (0)
+
+#define FAR_CURSOR_WRITE(cursor, value)               \
+   do                                                 \
+   {                                                  \
+      if ((cursor)->next == (cursor)->end)            \
+      {                                               \
+         FarCursorNextPage(cursor);                   \
+      }                                               \
+      *(cursor)->next++ = (value);                    \
+   } while (0)
+
+#endif // FARCURSOR_H
@@ -0,0 +1,175 @@
+/******************************************************************************
+ * Lightweight output formatting
+ *
+ * Description:
+ *
+ * See format.h. The conversions walk a table of powers of ten from the
+ * largest down and count how many times each one can be subtracted. That
+ * gives at most 9 subtractions per digit and no calls into the division
+ * runtime, which is a lot cheaper than printf on the HCS12.
+ *
+ *****************************************************************************/
+
+// project includes
+#include "format.h"
+
+// Definitions
+
+// Number of decimal digits in the largest 16 and 32 bit values.
+#define DIGITS_16BIT 5
+#define DIGITS_32BIT 10
+
+// Powers of ten used for the 16-bit conversion.
+static const UINT16 powersOfTen16[DIGITS_16BIT] =
+{
+   10000, 1000, 100, 10, 1
+};
+
+// Powers of ten used for the 32-bit and fixed-point conversions.
+static const UINT32 powersOfTen32[DIGITS_32BIT] =
+{
+   1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+   10000UL, 1000UL, 100UL, 10UL, 1UL
+};
+
+// Hex digits for PutHex.
+static const char hexDigits[] = "0123456789ABCDEF";
+
+// All of the output goes through here, so it is kept near and non-banked.
+#include "hal_hot_begin.h"
+
+//*****************************************************************************
+// Writes a null terminated string to the terminal.
+//
+// Parameters:
+//    str  The string to write.
+//
+// Return: None.
+//*****************************************************************************
+void PutString(const char* str)
+{
+   while (*str != 0)
+   {
+      PutChar(*str);
+      ++str;
+   }
+}
+
+//*****************************************************************************
+// Writes a 16-bit unsigned value in decimal. Only 16-bit subtractions are
+// used so this is the one to use for counts and microsecond values.
+//
+// Parameters:
+//    value  The value to write.
+//
+// Return: None.
+//*****************************************************************************
+void PutUnsigned(UINT16 value)
+{
+   UINT8 position = 0;
+   UINT8 started = 0;
+   INT8 digit;
+
+   for (position = 0; position < DIGITS_16BIT; ++position)
+   {
+      digit = '0';
+      while (value >= powersOfTen16[position])
+      {
+         value -= powersOfTen16[position];
+         ++digit;
+      }
+
+      // Skip leading zeros but always write the units digit.
+      if (digit != '0' || started || position == DIGITS_16BIT - 1)
+      {
+         started = 1;
+         PutChar(digit);
+      }
+   }
+}
+
+//*****************************************************************************
+// Writes a 32-bit unsigned value in decimal.
+//
+// Parameters:
+//    value  The value to write.
+//
+// Return: None.
+//*****************************************************************************
+void PutUnsignedLong(UINT32 value)
+{
+   PutFixed(value, 0);
+}
+
+//*****************************************************************************
+// Writes a fixed-point value in decimal. The value is an integer scaled by
+// 10^decimals, and exactly that many digits are written after the point.
+//
+// Parameters:
+//    value     The scaled value to write.
+//    decimals  Number of digits after the decimal point (0 to 9).
+//
+// Return: None.
+//*****************************************************************************
+void PutFixed(UINT32 value, UINT8 decimals)
+{
+   UINT8 position = 0;
+   UINT8 started = 0;
+   INT8 digit;
+
+   // The position holding the units digit.
+   const UINT8 unitsPosition = (UINT8)(DIGITS_32BIT - 1 - decimals);
+
+   for (position = 0; position < DIGITS_32BIT; ++position)
+   {
+      digit = '0';
+      while (value >= powersOfTen32[position])
+      {
+         value -= powersOfTen32[position];
+         ++digit;
+      }
+
+      // Skip leading zeros up to the units digit.
+      if (digit != '0' || started || position >= unitsPosition)
+      {
+         if (position == unitsPosition + 1)
+         {
+            PutChar('.');
+         }
+         started = 1;
+         PutChar(digit);
+      }
+   }
+}
+
+//*****************************************************************************
+// Writes a 16-bit value as 4 hex digits, leading zeros and all. One digit a
+// nibble, so this is the quick way to send a lot of raw values.
+//
+// Parameters:
+//    value  The value to write.
+//
+// Return: None.
+//*****************************************************************************
+void PutHex(UINT16 value)
+{
+   PutChar(hexDigits[(value >> 12) & 0xF]);
+   PutChar(hexDigits[(value >> 8) & 0xF]);
+   PutChar(hexDigits[(value >> 4) & 0xF]);
+   PutChar(hexDigits[value & 0xF]);
+}
+
+//*****************************************************************************
+// Ends the current terminal line.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void PutNewLine(void)
+{
+   PutChar('\r');
+   PutChar('\n');
+}
+
+#include "hal_hot_end.h"
@@ -0,0 +1,48 @@
+/******************************************************************************
+ * Lightweight output formatting
+ *
+ * Description:
+ *
+ * A small replacement for printf on the reporting paths. Each routine writes
+ * straight to PutChar, so no format string is parsed at run time and none
+ * of the varargs machinery is linked in for these calls.
+ *
+ * Digits are produced by subtracting powers of ten taken from a table, which
+ * avoids the 16 and 32 bit division runtime routines on the HCS12.
+ *
+ *****************************************************************************/
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include "types.h"
+
+// The output is on the hot paths, see hal_hot_begin.h.
+#include "hal_hot_begin.h"
+
+// Provided by main.c. Queues one byte for SCI0, TERMIO_PutChar does the
+// same for printf.
+void PutChar(INT8 ch);
+
+// Writes a null terminated string.
+void PutString(const char* str);
+
+// Writes a 16-bit unsigned value in decimal without leading zeros.
+void PutUnsigned(UINT16 value);
+
+// Writes a 32-bit unsigned value in decimal without leading zeros.
+void PutUnsignedLong(UINT32 value);
+
+// Writes a 16-bit value as exactly 4 upper case hex digits.
+void PutHex(UINT16 value);
+
+// Writes a fixed-point value. The value is scaled by 10^decimals, so
+// PutFixed(12345, 2) writes "123.45" and PutFixed(5, 2) writes "0.05".
+void PutFixed(UINT32 value, UINT8 decimals);
+
+// Writes the carriage return / line feed pair used on the terminal.
+void PutNewLine(void);
+
+#include "hal_hot_end.h"
+
+#endif // FORMAT_H
@@ -0,0 +1,113 @@
+/******************************************************************************
+ * Hardware abstraction layer
+ *
+ * Description:
+ *
+ * Everything the application needs from the hardware goes through the
+ * macros and functions declared here: the free running timer, input capture
+ * channels 1 and 2, output compare channel 3, SCI0, the interrupt mask and the interrupt service routine
+ * declarations. The application code never touches a register itself.
+ *
+ * Two backends provide them:
+ *    hal_hcs12.h  the MC9S12DT256 registers (the default)
+ *    hal_host.h   a Linux model of them, selected by defining HAL_HOST
+ *
+ * The macros every backend has to define:
+ *
+ *    HAL_READ_TIMER()             current value of the free running counter
+ *    HAL_READ_CAPTURE1()          value latched by input capture channel 1
+ *    HAL_CLEAR_CAPTURE1_FLAG()    acknowledge the channel 1 interrupt
+ *    HAL_READ_CAPTURE2()          value latched by input capture channel 2,
+ *                                 off the same timer
+ *    HAL_CLEAR_CAPTURE2_FLAG()    acknowledge the channel 2 interrupt
+ *    HAL_CAPTURE2_INTERRUPT_ON()
+ *    HAL_CAPTURE2_INTERRUPT_OFF()
+ *                                 the channel 2 interrupt, off until the
+ *                                 firmware turns it on
+ *    HAL_SET_COMPARE3(value)      the timer value output compare channel 3
+ *                                 interrupts at, each time the timer gets
+ *                                 there. The channel drives no pin
+ *    HAL_CLEAR_COMPARE3_FLAG()    acknowledge the channel 3 interrupt
+ *    HAL_COMPARE3_INTERRUPT_ON()
+ *    HAL_COMPARE3_INTERRUPT_OFF()
+ *                                 the channel 3 interrupt, off until the
+ *                                 firmware turns it on
+ *    HAL_CLEAR_OVERFLOW_FLAG()    acknowledge the timer overflow interrupt
+ *    HAL_OVERFLOW_PENDING()       non-zero while that interrupt is pending
+ *    HAL_TIMER_PRESCALE_SHIFT     bus cycles per timer tick, as a power of 2
+ *    HAL_BUS_CLOCK_HZ             the bus clock
+ *    HAL_READ_EDGE_COUNT()        8-bit count of the edges on channel 1,
+ *                                 captured or not
+ *    HAL_CAPTURE_DELAY_STEPS      number of settings of the capture delay
+ *                                 counter, 0 if there isn't one
+ *    HAL_CAPTURE_DELAY_CYCLES(step)
+ *                                 the narrowest pulse, in bus cycles, that
+ *                                 gets captured at that step
+ *    HAL_SET_CAPTURE_DELAY(step)  select a step, 0 for no delay
+ *    HAL_SCI_RECEIVED()           non-zero when SCI0 holds a received byte
+ *    HAL_SCI_READ()               fetch the received byte
+ *    HAL_SCI_TRANSMIT_READY()     non-zero when SCI0 can take the next byte
+ *    HAL_SCI_WRITE(ch)            send a byte
+ *    HAL_SCI_TRANSMIT_INTERRUPT_ON()
+ *    HAL_SCI_TRANSMIT_INTERRUPT_OFF()
+ *                                 the SCI0 interrupt for a free transmit
+ *                                 data register, it shares the vector with
+ *                                 the receive interrupt
+ *    HAL_ENABLE_INTERRUPTS()      clear the interrupt mask
+ *    HAL_DISABLE_INTERRUPTS()     set the interrupt mask
+ *    HAL_SLEEP_UNTIL_INTERRUPT()  enable interrupts and wait for one, see
+ *                                 TaskRun in task.c for how to use it
+ *    HAL_ISR(vector, name)        start the definition of an interrupt
+ *                                 service routine for the vector number
+ *    HAL_PAGE_WINDOW_START        first address of the page window
+ *    HAL_PAGE_WINDOW_WORDS        its size in 16-bit words
+ *    HAL_PAGE_WINDOW()            UINT16 pointer to the start of the window
+ *    HAL_PAGE_GET()               page mapped into the window
+ *    HAL_PAGE_SET(page)           map another page into it
+ *
+ * Interrupt service routines are bracketed by the segment headers, which
+ * place them in non-banked flash on the target:
+ *
+ *    #include "hal_isr_begin.h"
+ *    HAL_ISR(9, OC1_isr)
+ *    {
+ *       ...
+ *    }
+ *    #include "hal_isr_end.h"
+ *
+ * The rest of the code is placed the same way. What the capture, the
+ * binning and the output run through is bracketed by hal_hot_begin.h and
+ * hal_hot_end.h, which make it near and keep it in non-banked flash, and
+ * code that only runs once or waits on the user by hal_cold_begin.h and
+ * hal_cold_end.h, which move it to banked flash. Prototypes are bracketed
+ * the same as their functions. host/placement checks that nothing on a hot
+ * path calls out of it or reaches for far data.
+ *
+ *****************************************************************************/
+
+#ifndef HAL_H
+#define HAL_H
+
+#ifdef HAL_HOST
+#include "hal_host.h"
+#else
+#include "hal_hcs12.h"
+#endif
+
+#include "types.h"
+
+// Set up runs once, see hal_cold_begin.h.
+#include "hal_cold_begin.h"
+
+// Initializes SCI0 for 8N1, 9600 baud, bytes received and sent by
+// interrupt.
+void InitializeSerialPort(void);
+
+// Starts the timer at 1 MHz with input capture on channels 1 and 2 and
+// output compare on channel 3, and enables the channel 1 and overflow
+// interrupts.
+void InitializeTimer(void);
+
+#include "hal_cold_end.h"
+
+#endif // HAL_H
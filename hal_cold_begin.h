@@ -0,0 +1,23 @@
+/******************************************************************************
+ * Cold code placement, start
+ *
+ * Description:
+ *
+ * Included in front of code that runs once or waits on the user, such as
+ * the POST and the paged display, and in front of its prototypes. The
+ * CODE_SEG pragma puts it in banked flash, out of the way of the hot paths
+ * in non-banked flash, which is the scarcer of the two. hal_cold_end.h
+ * returns to the default scheme.
+ *
+ * The following line must be added to the PLACEMENT block of the
+ * Project.prm file:
+ *		COLD_ROM INTO PAGE_30, PAGE_31, PAGE_32, PAGE_33;
+ *
+ * There is deliberately no include guard, this is included once per block.
+ *
+ *****************************************************************************/
+
+#ifndef HAL_HOST
+#pragma push
+#pragma CODE_SEG __FAR_SEG COLD_ROM
+#endif
@@ -0,0 +1,14 @@
+/******************************************************************************
+ * Cold code placement, end
+ *
+ * Description:
+ *
+ * Included after each block started with hal_cold_begin.h to undo it.
+ *
+ * There is deliberately no include guard, this is included once per block.
+ *
+ *****************************************************************************/
+
+#ifndef HAL_HOST
+#pragma pop
+#endif
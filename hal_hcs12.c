@@ -0,0 +1,110 @@
+/******************************************************************************
+ * Hardware abstraction layer, MC9S12DT256 backend
+ *
+ * Description:
+ *
+ * Register level set up of SCI0 and the timer. See hal.h.
+ *
+ *****************************************************************************/
+
+// project includes
+#include "hal.h"
+
+// Definitions
+
+// Low byte of the input capture channel 1 vector address, for HPRIO.
+#define CAPTURE1_VECTOR_LOW 0xEC
+
+// Set up only runs once.
+#include "hal_cold_begin.h"
+
+// Initializes SCI0 for 8N1, 9600 baud, interrupt driven
+// transmit and receive.
+// The value for the baud selection registers is determined
+// using the formula:
+//
+// SCI0 Baud Rate = ( 2 MHz Bus Clock ) / ( 16 * SCI0BD[12:0] )
+//--------------------------------------------------------------
+void InitializeSerialPort(void)
+{
+    // Set baud rate to ~9600 (See above formula)
+    SCI0BD = 13;          
+    
+    // 8N1 is default, so we don't have to touch SCI0CR1.
+    // Enable the transmitter and receiver.
+    SCI0CR2_TE = 1;
+    SCI0CR2_RE = 1;
+    
+    // Receive by interrupt so a character wakes us up from WAI and nothing
+    // is lost while the main loop is busy. The transmit interrupt is
+    // turned on by PutChar when it has something to send.
+    SCI0CR2_RIE = 1;
+}
+
+
+// Initializes I/O and timer settings for the demo.
+//--------------------------------------------------------------       
+void InitializeTimer(void)
+{
+  // Set the timer prescaler to %2, since the bus clock is at 2 MHz,
+  // and we want the timer running at 1 MHz
+  TSCR2_PR0 = 1;
+  TSCR2_PR1 = 0;
+  TSCR2_PR2 = 0;       
+    
+  // Change to an input compare. HR 
+  // Enable input capture on Channel 1  
+  TIOS_IOS1 = 0;
+  
+  
+  // Set up input capture edge control to capture on a rising edge. 
+  TCTL4_EDG1A = 1;
+  TCTL4_EDG1B = 0;
+  
+  // Channel 2 captures the rising edges of the second signal of a skew
+  // measurement the same way. Its interrupt is only turned on while one
+  // runs.
+  TIOS_IOS2 = 0;
+  TCTL4_EDG2A = 1;
+  TCTL4_EDG2B = 0;
+  
+  // Channel 3 is an output compare that times the captures given a
+  // duration. OM3 and OL3 are left clear, so it doesn't drive PT3, and its
+  // interrupt is only turned on while one runs.
+  TIOS_IOS3 = 1;
+   
+  // from here down we want this code. HR.
+  // Count the edges on channel 1 in pulse accumulator 1 as well, so the
+  // ones the interrupt misses can be worked out.
+  ICPAR_PA1EN = 1;
+  
+  // Clear the input capture Interrupt Flag (Channel 1) 
+  TFLG1 = TFLG1_C1F_MASK;
+  
+  // Enable the input capture interrupt on Channel 1;
+  TIE_C1I = 1;  
+  
+  // Enable the timer overflow interrupt, it's the periodic wake up.
+  TFLG2 = TFLG2_TOF_MASK;
+  TSCR2_TOI = 1;
+  
+  // Promote the channel 1 interrupt above every other maskable one, so
+  // when it is pending along with the SCI0 or overflow interrupt it is
+  // taken first. HPRIO takes the low byte of its vector address, 0xFFEC,
+  // and can only be written with the I bit set, which it still is here.
+  // Nothing nests, so a serial interrupt that is already running still
+  // delays it by as long as it takes.
+  HPRIO = CAPTURE1_VECTOR_LOW;
+  
+  //
+  // Enable the timer
+  // 
+  TSCR1_TEN = 1;
+   
+  //
+  // Enable interrupts via macro provided by hidef.h
+  //
+  EnableInterrupts;
+}
+
+#include "hal_cold_end.h"
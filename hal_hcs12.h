@@ -0,0 +1,92 @@
+/******************************************************************************
+ * Hardware abstraction layer, MC9S12DT256 backend
+ *
+ * Description:
+ *
+ * Maps the HAL macros straight onto the registers from the derivative
+ * header, so going through the HAL costs nothing on the target. Included by
+ * hal.h, don't include it directly.
+ *
+ *****************************************************************************/
+
+#ifndef HAL_HCS12_H
+#define HAL_HCS12_H
+
+#include <hidef.h>      /* common defines and macros */
+#include "derivative.h" /* derivative-specific definitions */
+
+// A deep capture needs RAM behind the page window. The DT256 only pages its
+// flash, and pages 0x30 to 0x33 hold the cold code, see hal_cold_begin.h.
+#ifdef CAPTURE_PAGED
+#error "CAPTURE_PAGED needs paged RAM, the DT256 only pages its flash"
+#endif
+
+#define HAL_READ_TIMER()             (TCNT)
+#define HAL_READ_CAPTURE1()          (TC1)
+#define HAL_CLEAR_CAPTURE1_FLAG()    (TFLG1 = TFLG1_C1F_MASK)
+#define HAL_READ_CAPTURE2()          (TC2)
+#define HAL_CLEAR_CAPTURE2_FLAG()    (TFLG1 = TFLG1_C2F_MASK)
+#define HAL_CAPTURE2_INTERRUPT_ON()  (TIE_C2I = 1)
+#define HAL_CAPTURE2_INTERRUPT_OFF() (TIE_C2I = 0)
+#define HAL_SET_COMPARE3(value)      (TC3 = (value))
+#define HAL_CLEAR_COMPARE3_FLAG()    (TFLG1 = TFLG1_C3F_MASK)
+#define HAL_COMPARE3_INTERRUPT_ON()  (TIE_C3I = 1)
+#define HAL_COMPARE3_INTERRUPT_OFF() (TIE_C3I = 0)
+#define HAL_CLEAR_OVERFLOW_FLAG()    (TFLG2 = TFLG2_TOF_MASK)
+#define HAL_OVERFLOW_PENDING()       (TFLG2_TOF)
+
+// The prescaler InitializeTimer sets, 2 bus cycles a tick.
+#define HAL_TIMER_PRESCALE_SHIFT     1
+#define HAL_BUS_CLOCK_HZ             2000000UL
+
+// Pulse accumulator 1 counts the same edges channel 1 captures, whether the
+// interrupt gets to them or not.
+#define HAL_READ_EDGE_COUNT()        (PACN1)
+
+// The ECT delay counter. Once an edge is seen on a capture input the input
+// has to stay at its new level for HAL_CAPTURE_DELAY_CYCLES(step) bus cycles
+// before the edge is captured, so a narrower pulse never gets as far as the
+// interrupt. Steps 1 to 3 are 256, 512 and 1024 cycles, 0 turns it off.
+// Every edge that gets through is late by the same amount, which the
+// intervals don't see.
+#define HAL_CAPTURE_DELAY_STEPS          3
+#define HAL_CAPTURE_DELAY_CYCLES(step)   (128UL << (step))
+#define HAL_SET_CAPTURE_DELAY(step)      (DLYCT = (UINT8)(step))
+
+// Reading SCI0SR1 and then SCI0DRL is what clears RDRF, so test with
+// HAL_SCI_RECEIVED() before every HAL_SCI_READ().
+#define HAL_SCI_RECEIVED()           (SCI0SR1_RDRF)
+#define HAL_SCI_READ()               (SCI0DRL)
+// Reading SCI0SR1 with TDRE set and then writing SCI0DRL clears TDRE. The
+// transmit interrupt fires for as long as TDRE is set, so it is only left
+// on while there is something to send.
+#define HAL_SCI_TRANSMIT_READY()          (SCI0SR1_TDRE)
+#define HAL_SCI_WRITE(ch)                 (SCI0DRL = (ch))
+#define HAL_SCI_TRANSMIT_INTERRUPT_ON()   (SCI0CR2_SCTIE = 1)
+#define HAL_SCI_TRANSMIT_INTERRUPT_OFF()  (SCI0CR2_SCTIE = 0)
+
+#define HAL_ENABLE_INTERRUPTS()      EnableInterrupts
+#define HAL_DISABLE_INTERRUPTS()     DisableInterrupts
+
+// The CPU takes no interrupt until the instruction after CLI has run, and
+// WAI wakes up straight away for one that is already pending, so an
+// interrupt that comes in between the caller's check and the WAI can't be
+// missed. The timer and SCI0 keep running in wait mode because TSWAI and
+// SCISWAI are left clear.
+#define HAL_SLEEP_UNTIL_INTERRUPT()  { __asm CLI; __asm WAI; }
+
+// Paged memory shows through the PPAGE window at 0x8000-0xBFFF, see
+// farcursor.h. The DT256 only pages its flash, so what's there can be read
+// but not written.
+#define HAL_PAGE_WINDOW_START        0x8000u
+#define HAL_PAGE_WINDOW_WORDS        0x2000u
+#define HAL_PAGE_WINDOW()            ((UINT16*)HAL_PAGE_WINDOW_START)
+#define HAL_PAGE_GET()               (PPAGE)
+#define HAL_PAGE_SET(page)           (PPAGE = (page))
+
+// The TRAP_PROC tells the compiler to implement an interrupt function.
+// Alternatively, one could use the __interrupt keyword instead. The vector
+// number is the one for the VECTOR line in Project.prm.
+#define HAL_ISR(vector, name)        void interrupt vector name(void)
+
+#endif // HAL_HCS12_H
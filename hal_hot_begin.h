@@ -0,0 +1,26 @@
+/******************************************************************************
+ * Hot path placement, start
+ *
+ * Description:
+ *
+ * Included in front of the code the capture, the binning and the output
+ * run through, and in front of its prototypes. The CODE_SEG pragma puts the
+ * functions in non-banked flash and makes them near, so they are called
+ * with JSR/RTS instead of CALL/RTC and never touch PPAGE. hal_hot_end.h
+ * returns to the default scheme.
+ *
+ * A near function has to be declared inside the same pragma as it is
+ * defined in, otherwise its callers use CALL. The data the hot paths use is
+ * left in the default data segment, which is near RAM.
+ *
+ * NON_BANKED is placed by the stock Project.prm, nothing has to be added for
+ * it. host/placement checks the whole scheme, see the README.
+ *
+ * There is deliberately no include guard, this is included once per block.
+ *
+ *****************************************************************************/
+
+#ifndef HAL_HOST
+#pragma push
+#pragma CODE_SEG __NEAR_SEG NON_BANKED
+#endif
@@ -0,0 +1,17 @@
+/******************************************************************************
+ * Interrupt service routine placement, start
+ *
+ * Description:
+ *
+ * Included in front of each HAL_ISR. The CODE_SEG pragma is needed to ensure
+ * that the ISR is placed in non-banked memory. hal_isr_end.h returns to the
+ * default scheme, which is necessary when non-ISR code follows.
+ *
+ * There is deliberately no include guard, this is included once per ISR.
+ *
+ *****************************************************************************/
+
+#ifndef HAL_HOST
+#pragma push
+#pragma CODE_SEG __SHORT_SEG NON_BANKED
+#endif
@@ -0,0 +1,14 @@
+/******************************************************************************
+ * Interrupt service routine placement, end
+ *
+ * Description:
+ *
+ * Included after each HAL_ISR to undo hal_isr_begin.h.
+ *
+ * There is deliberately no include guard, this is included once per ISR.
+ *
+ *****************************************************************************/
+
+#ifndef HAL_HOST
+#pragma pop
+#endif
@@ -0,0 +1,604 @@
+/******************************************************************************
+ * Histogram binning bench
+ *
+ * Description:
+ *
+ * Runs the histogram kernel of processTimerMeasurements() over synthetic
+ * captures for a spread of ranges, bucket counts and pulse shapes, with the
+ * bucket index worked out four ways:
+ *
+ *    div    (interval - lower) / width, what the firmware does, an IDIV
+ *    recip  the high word of (interval - lower) * 65536 / width, an EMUL,
+ *           with one compare against the bucket boundary to make it exact
+ *    lut    a table indexed by (interval - lower) >> shift, the shift
+ *           picked so no slot holds more than one boundary, with the same
+ *           compare to fix up the slot that does
+ *    log    buckets that double in width, as many linear steps in each
+ *           octave as the bucket count allows. A different histogram, so
+ *           it's not checked against div.
+ *
+ * For each it reports the time per interval on this machine and the cycles
+ * per interval the HCS12 would take, estimated from the instruction counts
+ * in the cost table below. The host numbers rank the ideas, the cycle
+ * estimates are what count on the board. The div kernel is checked against
+ * the firmware's own processTimerMeasurements() where the bucket count is
+ * the firmware's.
+ *
+ *    binbench [--reps <n>]
+ *
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#define HAL_HOST_BACKEND
+
+// system includes
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// project includes
+#include "hal.h"
+#include "command.h"
+#include "pulsegen.h"
+
+// Definitions
+
+// As main.c has them.
+#define INTERVALS      1000
+#define FIRMWARE_BUCKETS 100
+
+#define MAX_BUCKETS    256
+#define MAX_LUT        (4 * MAX_BUCKETS + 1)
+
+#define DEFAULT_REPS   1000
+
+// HCS12 cycles per interval, counted from the code CodeWarrior generates
+// for the kernel at the default optimisation. Every interval pays EVERY,
+// one outside the range OUTSIDE and one inside it INSIDE plus the cost of
+// its binning.
+#define CYCLES_EVERY        56    // interval, sum, min, max, range checks, loop
+#define CYCLES_OUTSIDE       7    // out of range count
+#define CYCLES_INSIDE       25    // bucket minimum and count
+#define CYCLES_DIV          27    // subtract, IDIVS, clamp
+#define CYCLES_RECIP        28    // subtract, EMUL, boundary fix up, clamp
+#define CYCLES_LUT          24    // subtract, table load, boundary fix up...
+#define CYCLES_LUT_SHIFT     1    // ...and an LSRD for each bit of shift
+#define CYCLES_LOG          23    // subtract, octave from a 256 byte table...
+#define CYCLES_LOG_SHIFT     4    // ...and a shift loop pass per octave up
+
+// The firmware's capture tables and the kernel under test, see main.c.
+extern volatile UINT16 timerValuesUs[];
+extern UINT16 histogram[];
+extern UINT16 minimumHistogramValueUs[];
+extern UINT16 intervalCount;
+extern UINT16 belowRangeCount;
+extern UINT16 aboveRangeCount;
+extern UINT16 outputMode;
+void processTimerMeasurements(UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs);
+
+// Everything a kernel needs to know about the range, worked out once.
+typedef struct
+{
+   UINT16 lower;
+   UINT16 upper;
+   UINT16 buckets;
+   UINT16 width;
+   UINT32 reciprocal;                 // ceil(65536 / width)
+   UINT16 bounds[MAX_BUCKETS];        // offset each bucket starts at
+   UINT8 lutShift;
+   UINT8 lut[MAX_LUT];
+   UINT16 lutSize;
+   UINT8 logBits;                     // linear steps per octave, as a power of 2
+   UINT16 logBuckets;
+} Setup;
+
+// What a kernel produces, the same things processTimerMeasurements does.
+typedef struct
+{
+   UINT16 histogram[MAX_BUCKETS];
+   UINT16 minimum[MAX_BUCKETS];
+   UINT16 below;
+   UINT16 above;
+   UINT16 minimumInterval;
+   UINT16 maximumInterval;
+   UINT32 sum;
+   unsigned long extraCycles;         // data dependent cycles, see the table
+} Result;
+
+typedef int (*BinFunction)(const Setup* setup, UINT16 offset, Result* result);
+
+typedef struct
+{
+   const char* name;
+   BinFunction bin;
+   unsigned int cycles;
+} Strategy;
+
+// Pulse shapes, in terms of the range so every one lands across it.
+typedef struct
+{
+   const char* name;
+   void (*make)(PulseShape* shape, UINT16 lower, UINT16 upper);
+} Shape;
+
+// Ranges and bucket counts run.
+static const UINT16 ranges[][2] =
+{
+   { 900, 1100 }, { 0, 1000 }, { 1000, 11000 }, { 100, 60100 }
+};
+static const UINT16 bucketCounts[] = { 16, FIRMWARE_BUCKETS, 250 };
+
+// Highest set bit of each byte, for the log buckets.
+static UINT8 highBit[256];
+
+//*****************************************************************************
+// Position of the highest set bit, the way the HCS12 would find it, from a
+// table of bytes.
+//
+// Parameters:
+//    value  Not 0.
+//
+// Return: 0 to 15.
+//*****************************************************************************
+static UINT8 highestBit(UINT16 value)
+{
+   return (value >> 8) ? (UINT8)(8 + highBit[value >> 8]) : highBit[value];
+}
+
+//*****************************************************************************
+// Log bucket of an offset: the offset itself below 2^bits, above that the
+// octave and the top bits under the highest one.
+//
+// Parameters:
+//    bits    Linear steps per octave as a power of 2.
+//    offset  Interval less the lower boundary.
+//    shifts  Where the number of shifts taken is added, may be NULL.
+//
+// Return: The bucket.
+//*****************************************************************************
+static UINT16 logBucket(UINT8 bits, UINT16 offset, unsigned long* shifts)
+{
+   UINT8 octave;
+
+   if (offset < (1u << bits))
+   {
+      return offset;
+   }
+
+   octave = (UINT8)(highestBit(offset) - bits);
+   if (shifts)
+   {
+      *shifts += octave;
+   }
+   return (UINT16)(((octave + 1u) << bits) + ((offset >> octave) - (1u << bits)));
+}
+
+//*****************************************************************************
+// Works out the tables for a range.
+//
+// Parameters:
+//    setup    Filled in.
+//    lower    Lower boundary in us.
+//    upper    Upper boundary in us.
+//    buckets  Number of buckets, upper - lower has to be at least this.
+//
+// Return: None.
+//*****************************************************************************
+static void prepare(Setup* setup, UINT16 lower, UINT16 upper, UINT16 buckets)
+{
+   UINT16 spread = (UINT16)(upper - lower);
+   unsigned int i;
+   unsigned int b;
+
+   setup->lower = lower;
+   setup->upper = upper;
+   setup->buckets = buckets;
+   setup->width = (UINT16)((spread - 1) / buckets + 1);
+   setup->reciprocal = (65536UL + setup->width - 1) / setup->width;
+
+   // the width is rounded up as the firmware does, so the buckets can end
+   // past the top of the range.
+   for (b = 0; b < buckets; ++b)
+   {
+      setup->bounds[b] = (UINT16)(b * setup->width);
+   }
+   // a slot no wider than a bucket holds at most one boundary.
+   setup->lutShift = 0;
+   while ((2u << setup->lutShift) <= setup->width)
+   {
+      ++setup->lutShift;
+   }
+   setup->lutSize = (UINT16)((spread >> setup->lutShift) + 1);
+   for (i = 0, b = 0; i < setup->lutSize; ++i)
+   {
+      while (b + 1 < buckets && setup->bounds[b + 1] <= (i << setup->lutShift))
+      {
+         ++b;
+      }
+      setup->lut[i] = (UINT8)b;
+   }
+
+   // as many steps per octave as still fit the whole range in the buckets.
+   setup->logBits = 0;
+   while (setup->logBits < 15 &&
+          logBucket((UINT8)(setup->logBits + 1), spread, NULL) < buckets)
+   {
+      ++setup->logBits;
+   }
+   setup->logBuckets = (UINT16)(logBucket(setup->logBits, spread, NULL) + 1);
+}
+
+//*****************************************************************************
+// The bucket functions, one for each strategy.
+//
+// Parameters:
+//    setup   The range.
+//    offset  Interval less the lower boundary, within the range.
+//    result  For the data dependent cycle count.
+//
+// Return: The bucket.
+//*****************************************************************************
+static int binDivision(const Setup* setup, UINT16 offset, Result* result)
+{
+   int bucket = offset / setup->width;
+
+   (void) result;
+   return bucket >= setup->buckets ? setup->buckets - 1 : bucket;
+}
+
+static int binReciprocal(const Setup* setup, UINT16 offset, Result* result)
+{
+   int bucket = (int)(((UINT32)offset * setup->reciprocal) >> 16);
+
+   (void) result;
+   if (bucket >= setup->buckets)
+   {
+      return setup->buckets - 1;
+   }
+
+   // the rounded up reciprocal can come out one high, never low.
+   if (offset < setup->bounds[bucket])
+   {
+      --bucket;
+   }
+   return bucket;
+}
+
+static int binTable(const Setup* setup, UINT16 offset, Result* result)
+{
+   int bucket = setup->lut[offset >> setup->lutShift];
+
+   (void) result;
+   if (bucket + 1 < setup->buckets && offset >= setup->bounds[bucket + 1])
+   {
+      ++bucket;
+   }
+   return bucket;
+}
+
+static int binLog(const Setup* setup, UINT16 offset, Result* result)
+{
+   return logBucket(setup->logBits, offset, &result->extraCycles);
+}
+
+static const Strategy strategies[] =
+{
+   { "div",   binDivision,   CYCLES_DIV },
+   { "recip", binReciprocal, CYCLES_RECIP },
+   { "lut",   binTable,      CYCLES_LUT },
+   { "log",   binLog,        CYCLES_LOG }
+};
+
+#define STRATEGIES (sizeof(strategies) / sizeof(strategies[0]))
+
+//*****************************************************************************
+// The kernel of processTimerMeasurements, with the bucket worked out by the
+// given function.
+//
+// Parameters:
+//    setup    The range.
+//    values   INTERVALS + 1 timer values.
+//    bin      Works out the bucket.
+//    result   Filled in.
+//
+// Return: None.
+//*****************************************************************************
+static void runKernel(const Setup* setup, const UINT16* values, BinFunction bin,
+                      Result* result)
+{
+   UINT16 interval;
+   int bucket;
+   int i;
+
+   memset(result, 0, sizeof(*result));
+   result->minimumInterval = 65535;
+
+   for (i = 0; i < INTERVALS; ++i)
+   {
+      interval = (UINT16)(values[i + 1] - values[i]);
+
+      result->sum += interval;
+      if (interval < result->minimumInterval)
+      {
+         result->minimumInterval = interval;
+      }
+      if (interval > result->maximumInterval)
+      {
+         result->maximumInterval = interval;
+      }
+
+      if (interval < setup->lower)
+      {
+         ++result->below;
+         continue;
+      }
+      if (interval > setup->upper)
+      {
+         ++result->above;
+         continue;
+      }
+
+      bucket = bin(setup, (UINT16)(interval - setup->lower), result);
+
+      if (result->histogram[bucket] == 0 || interval < result->minimum[bucket])
+      {
+         result->minimum[bucket] = interval;
+      }
+      ++result->histogram[bucket];
+   }
+}
+
+//*****************************************************************************
+// Nanoseconds on the monotonic clock.
+//
+// Parameters: None.
+//
+// Return: The time.
+//*****************************************************************************
+static double nanoseconds(void)
+{
+   struct timespec now;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+   return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+//*****************************************************************************
+// Pulse shapes, each set up to spread over the range its own way.
+//
+// Parameters:
+//    shape  Filled in.
+//    lower  Lower boundary in us.
+//    upper  Upper boundary in us.
+//
+// Return: None.
+//*****************************************************************************
+static void makeGaussian(PulseShape* shape, UINT16 lower, UINT16 upper)
+{
+   shape->kind = PULSE_GAUSSIAN;
+   shape->period = (lower + upper) / 2.0;
+   shape->jitter = (upper - lower) / 6.0;
+}
+
+static void makePoisson(PulseShape* shape, UINT16 lower, UINT16 upper)
+{
+   shape->kind = PULSE_POISSON;
+   shape->period = (lower + upper) / 2.0;
+}
+
+static void makeBurst(PulseShape* shape, UINT16 lower, UINT16 upper)
+{
+   shape->kind = PULSE_BURST;
+   shape->burst = 4;
+   shape->gap = lower + (upper - lower) / 4.0 + 1.0;
+   shape->period = shape->gap * 5.0;
+}
+
+static void makeDrift(PulseShape* shape, UINT16 lower, UINT16 upper)
+{
+   shape->kind = PULSE_DRIFT;
+   shape->period = lower + 1.0;
+   shape->drift = (upper - lower) / (double)INTERVALS;
+}
+
+static void makeOutliers(PulseShape* shape, UINT16 lower, UINT16 upper)
+{
+   makeGaussian(shape, lower, upper);
+   shape->outliers = 0.05;
+   shape->scale = 0.3;
+}
+
+static const Shape shapes[] =
+{
+   { "gaussian", makeGaussian },
+   { "poisson",  makePoisson },
+   { "burst",    makeBurst },
+   { "drift",    makeDrift },
+   { "outliers", makeOutliers }
+};
+
+//*****************************************************************************
+// Checks the div kernel against the firmware's processTimerMeasurements.
+//
+// Parameters:
+//    setup   The range, with the firmware's bucket count.
+//    values  INTERVALS + 1 timer values.
+//    result  What the div kernel made of them.
+//    reps    Times to run the firmware's kernel for the timing.
+//
+// Return: Nanoseconds per interval, negative if the results differ.
+//*****************************************************************************
+static double checkFirmware(const Setup* setup, const UINT16* values,
+                            const Result* result, unsigned int reps)
+{
+   double start;
+   double elapsed;
+   unsigned int r;
+   unsigned int i;
+
+   for (i = 0; i <= INTERVALS; ++i)
+   {
+      timerValuesUs[i] = values[i];
+   }
+   intervalCount = INTERVALS;
+   outputMode = MODE_BATCH;
+
+   start = nanoseconds();
+   for (r = 0; r < reps; ++r)
+   {
+      processTimerMeasurements(setup->lower, setup->upper);
+   }
+   elapsed = nanoseconds() - start;
+
+   if (memcmp(histogram, result->histogram, FIRMWARE_BUCKETS * sizeof(UINT16)) != 0 ||
+       memcmp(minimumHistogramValueUs, result->minimum,
+              FIRMWARE_BUCKETS * sizeof(UINT16)) != 0 ||
+       belowRangeCount != result->below || aboveRangeCount != result->above)
+   {
+      return -1.0;
+   }
+
+   return elapsed / ((double)reps * INTERVALS);
+}
+
+//*****************************************************************************
+// Entry point.
+//
+// Parameters:
+//    argc, argv  The command line.
+//
+// Return: Exit status, 1 if a kernel disagreed with division.
+//*****************************************************************************
+int main(int argc, char** argv)
+{
+   static UINT16 values[INTERVALS + 1];
+   static Setup setup;
+   static Result reference;
+   static Result result;
+   unsigned int reps = DEFAULT_REPS;
+   unsigned int r;
+   unsigned int n;
+   unsigned int b;
+   unsigned int s;
+   unsigned int k;
+   unsigned long inside;
+   unsigned long cycles;
+   unsigned long mismatches = 0;
+   unsigned long checksum = 0;
+   double start;
+   double elapsed;
+   double firmwareNs;
+   PulseShape shape;
+   PulseGen gen;
+   int i;
+
+   for (i = 1; i < argc; ++i)
+   {
+      if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+      {
+         reps = (unsigned int)atoi(argv[++i]);
+      }
+      else
+      {
+         (void) fprintf(stderr, "usage: %s [--reps <n>]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   for (i = 1; i < 256; ++i)
+   {
+      highBit[i] = (UINT8)(highBit[i >> 1] + (i > 1));
+   }
+
+   (void) printf("%d intervals x %u reps, ns per interval on this host and"
+                 " estimated HCS12 cycles\n", INTERVALS, reps);
+   (void) printf("%-12s %4s %-9s", "range", "bkts", "shape");
+   for (k = 0; k < STRATEGIES; ++k)
+   {
+      (void) printf("  %5s ns  cyc", strategies[k].name);
+   }
+   (void) printf("  lut bytes  log bkts  firmware ns\n");
+
+   for (n = 0; n < sizeof(ranges) / sizeof(ranges[0]); ++n)
+   {
+      for (b = 0; b < sizeof(bucketCounts) / sizeof(bucketCounts[0]); ++b)
+      {
+         // the firmware turns down a range narrower than a microsecond a bucket.
+         if ((UINT16)(ranges[n][1] - ranges[n][0]) < bucketCounts[b])
+         {
+            continue;
+         }
+
+         prepare(&setup, ranges[n][0], ranges[n][1], bucketCounts[b]);
+
+         for (s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s)
+         {
+            PulseShapeDefaults(&shape);
+            shapes[s].make(&shape, setup.lower, setup.upper);
+            PulseGenInit(&gen, &shape, 1.0);
+            (void) PulseGenCaptures(&gen, values, INTERVALS + 1, 1.0);
+
+            (void) printf("%5u-%-6u %4u %-9s", setup.lower, setup.upper,
+                          setup.buckets, shapes[s].name);
+
+            for (k = 0; k < STRATEGIES; ++k)
+            {
+               start = nanoseconds();
+               for (r = 0; r < reps; ++r)
+               {
+                  runKernel(&setup, values, strategies[k].bin, &result);
+                  checksum += result.histogram[r % setup.buckets];
+               }
+               elapsed = nanoseconds() - start;
+
+               if (k == 0)
+               {
+                  reference = result;
+               }
+               else if (strategies[k].bin != binLog &&
+                        memcmp(&reference, &result, sizeof(result)) != 0)
+               {
+                  ++mismatches;
+                  (void) printf(" !");
+               }
+
+               inside = INTERVALS - result.below - result.above;
+               cycles = (unsigned long)INTERVALS * CYCLES_EVERY +
+                        (result.below + result.above) * CYCLES_OUTSIDE +
+                        inside * (CYCLES_INSIDE + strategies[k].cycles);
+               if (strategies[k].bin == binTable)
+               {
+                  cycles += inside * setup.lutShift * CYCLES_LUT_SHIFT;
+               }
+               else if (strategies[k].bin == binLog)
+               {
+                  cycles += result.extraCycles * CYCLES_LOG_SHIFT;
+               }
+
+               (void) printf("  %8.2f %4lu", elapsed / ((double)reps * INTERVALS),
+                             (cycles + INTERVALS / 2) / INTERVALS);
+            }
+
+            (void) printf("  %9u  %8u", setup.lutSize, setup.logBuckets);
+
+            if (setup.buckets == FIRMWARE_BUCKETS)
+            {
+               firmwareNs = checkFirmware(&setup, values, &reference, reps);
+               if (firmwareNs < 0.0)
+               {
+                  ++mismatches;
+                  (void) printf("  differs");
+               }
+               else
+               {
+                  (void) printf("  %11.2f", firmwareNs);
+               }
+            }
+            (void) printf("\n");
+         }
+      }
+   }
+
+   (void) printf("checksum %lu, %lu mismatches\n", checksum, mismatches);
+   return mismatches ? 1 : 0;
+}
@@ -0,0 +1,352 @@
+/******************************************************************************
+ * Capture throughput bench
+ *
+ * Description:
+ *
+ * Drives the firmware's OC1_isr from the ECT simulator with a steady train
+ * of edges and finds, for each timer configuration, the shortest period the
+ * capture keeps up with: the edges come in, the interrupt service routines
+ * run and are charged their modelled cost, and any edge that arrives while
+ * the last capture is still pending is counted as dropped. Each run also
+ * reports the worst capture latency OC1_isr measured, in bus cycles.
+ *
+ *    ectbench [--edges <n>] [--period <cycles> | --pulses <shape>]
+ *             [--cost <entry> <exit>] [--serial]
+ *
+ *    --edges   edges in each run, 1000 by default, what one capture holds
+ *    --period  report the drops at this period instead of searching
+ *    --pulses  report the drops for this train, see pulsegen.h
+ *    --cost    cycles charged to OC1_isr, see HalHostIsrCost
+ *    --serial  keep SCI0 busy both ways at 9600 baud while capturing, so
+ *              SCI0_isr competes with the capture the way it does when
+ *              the link is saturated
+ *
+ * Each configuration is a prescaler and a multiple of the capture cost.
+ * The prescaler sets how often the overflow interrupt gets in the way, the
+ * doubled cost stands in for a slower interrupt service routine.
+ *
+ *****************************************************************************/
+
+#define HAL_HOST_BACKEND
+
+// system includes
+#include <stdlib.h>
+#include <string.h>
+
+// project includes
+#include "hal.h"
+#include "profile.h"
+#include "pulsegen.h"
+#include "ring.h"
+
+// Definitions
+
+// As main.c has them.
+#define TRUE 1
+#define FALSE 0
+
+// Values timerValuesUs in main.c holds.
+#define MAX_EDGES 1001
+
+// Size of txBuffer in main.c.
+#define TX_BUFFER_SIZE 128
+
+// Longest period searched, one trip round TCNT at full speed.
+#define MAX_PERIOD_CYCLES 65535
+
+// The firmware's capture state, see main.c.
+extern Ring captureRing;
+extern volatile UINT16 captureValues;
+extern volatile UINT16 captureTarget;
+
+// The firmware's serial buffers, see main.c.
+extern volatile UINT8 txBuffer[];
+extern Ring txRing;
+extern Ring rxRing;
+
+// Configurations run.
+static const UINT8 prescaleShifts[] = { 0, 1, 3, 7 };
+static const UINT8 costMultipliers[] = { 1, 2 };
+
+// The cost OC1_isr is charged when the multiplier is 1.
+static HalHostIsrCost baseCaptureCost;
+
+// Set by --serial.
+static int serialLoad = 0;
+
+//*****************************************************************************
+// Tops the firmware's transmit buffer up and empties its receive buffer, so
+// SCI0_isr always has a character to send and room for the one it gets.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+static void loadSerial(void)
+{
+   while (!RING_FULL(txRing, TX_BUFFER_SIZE))
+   {
+      RING_PUT(txRing, txBuffer, TX_BUFFER_SIZE, 'U');
+   }
+   HAL_SCI_TRANSMIT_INTERRUPT_ON();
+   RING_SKIP(rxRing, RING_COUNT(rxRing));
+}
+
+//*****************************************************************************
+// Runs one train of edges through the firmware's capture.
+//
+// Parameters:
+//    prescaleShift  Timer prescaler as a power of two.
+//    source         Where the edges come from.
+//    context        Handed to source.
+//    edgeCount      Number of edges the firmware is to keep.
+//    stored         Where the number of values the firmware stored goes.
+//    latency        Where the worst capture latency goes, in bus cycles.
+//
+// Return: Number of edges dropped.
+//*****************************************************************************
+static unsigned long runEdges(UINT8 prescaleShift, EctEdgeSource source,
+                              void* context, unsigned long edgeCount,
+                              unsigned long* stored, unsigned long* latency)
+{
+   HalHostSetEdgeSource(source, context);
+   HalHostStartTimer(prescaleShift);
+   HalHostSetSerialLoad(serialLoad);
+
+   RING_RESET(captureRing);
+   captureTarget = (UINT16)edgeCount;
+   PROFILE_LATENCY_RESET();
+   captureValues = TRUE;
+
+   for (;;)
+   {
+      if (serialLoad)
+      {
+         loadSerial();
+      }
+      if (!HalHostDispatchInterrupts())
+      {
+         if (captureRing.head >= captureTarget || halHostEct.nextEdge == ECT_NO_EDGE)
+         {
+            break;
+         }
+         EctSimAdvance(&halHostEct, HalHostNextEvent());
+      }
+   }
+
+   captureValues = FALSE;
+   HalHostSetSerialLoad(0);
+   HAL_SCI_TRANSMIT_INTERRUPT_OFF();
+   *stored = captureRing.head;
+   *latency = (unsigned long)profileLatency << prescaleShift;
+   return halHostEct.dropped;
+}
+
+//*****************************************************************************
+// Runs a steady train of edges through the firmware's capture.
+//
+// Parameters:
+//    prescaleShift  Timer prescaler as a power of two.
+//    period         Bus cycles between edges.
+//    edgeCount      Number of edges.
+//    stored         Where the number of values the firmware stored goes.
+//    latency        Where the worst capture latency goes, in bus cycles.
+//
+// Return: Number of edges dropped.
+//*****************************************************************************
+static unsigned long runTrain(UINT8 prescaleShift, EctCycles period,
+                              unsigned long edgeCount, unsigned long* stored,
+                              unsigned long* latency)
+{
+   EctPeriodic edges;
+
+   EctPeriodicInit(&edges, period, edgeCount);
+   return runEdges(prescaleShift, EctPeriodicEdges, &edges, edgeCount, stored,
+                   latency);
+}
+
+//*****************************************************************************
+// Finds the shortest period at which no edge is dropped.
+//
+// Parameters:
+//    prescaleShift  Timer prescaler as a power of two.
+//    edgeCount      Number of edges in each run.
+//
+// Return: The period in bus cycles, 0 if even the longest one drops.
+//*****************************************************************************
+static EctCycles sustainablePeriod(UINT8 prescaleShift, unsigned long edgeCount)
+{
+   EctCycles low = 1;
+   EctCycles high = MAX_PERIOD_CYCLES;
+   EctCycles middle;
+   unsigned long stored;
+   unsigned long latency;
+
+   if (runTrain(prescaleShift, high, edgeCount, &stored, &latency) != 0)
+   {
+      return 0;
+   }
+
+   // Drops only go down as the period gets longer.
+   while (low < high)
+   {
+      middle = low + (high - low) / 2;
+      if (runTrain(prescaleShift, middle, edgeCount, &stored, &latency) == 0)
+      {
+         high = middle;
+      }
+      else
+      {
+         low = middle + 1;
+      }
+   }
+
+   return high;
+}
+
+//*****************************************************************************
+// Entry point.
+//
+// Parameters:
+//    argc, argv  The command line.
+//
+// Return: Exit status.
+//*****************************************************************************
+int main(int argc, char** argv)
+{
+   unsigned long edgeCount = MAX_EDGES - 1;
+   EctCycles fixedPeriod = 0;
+   PulseShape shape;
+   PulseGen pulses;
+   int shaped = 0;
+   EctCycles period;
+   unsigned long dropped;
+   unsigned long stored;
+   unsigned long latency;
+   unsigned int p;
+   unsigned int c;
+   int i;
+
+   PulseShapeDefaults(&shape);
+
+   for (i = 1; i < argc; ++i)
+   {
+      if (strcmp(argv[i], "--edges") == 0 && i + 1 < argc)
+      {
+         edgeCount = strtoul(argv[++i], NULL, 10);
+      }
+      else if (strcmp(argv[i], "--period") == 0 && i + 1 < argc)
+      {
+         fixedPeriod = strtoull(argv[++i], NULL, 10);
+      }
+      else if (strcmp(argv[i], "--pulses") == 0 && i + 1 < argc)
+      {
+         if (PulseShapeParse(&shape, argv[++i]) != 0)
+         {
+            (void) fprintf(stderr, "%s: bad pulse shape %s\n", argv[0], argv[i]);
+            return 2;
+         }
+         shaped = 1;
+      }
+      else if (strcmp(argv[i], "--cost") == 0 && i + 2 < argc)
+      {
+         halHostCaptureCost.entryCycles = (UINT16)strtoul(argv[++i], NULL, 10);
+         halHostCaptureCost.exitCycles = (UINT16)strtoul(argv[++i], NULL, 10);
+      }
+      else if (strcmp(argv[i], "--serial") == 0)
+      {
+         serialLoad = 1;
+      }
+      else
+      {
+         (void) fprintf(stderr,
+            "usage: %s [--edges <n>] [--period <cycles> | --pulses <shape>]"
+            " [--cost <entry> <exit>] [--serial]\n",
+            argv[0]);
+         return 2;
+      }
+   }
+
+   if (edgeCount == 0 || edgeCount > MAX_EDGES)
+   {
+      (void) fprintf(stderr, "%s: --edges must be 1 to %d\n", argv[0], MAX_EDGES);
+      return 2;
+   }
+
+   baseCaptureCost = halHostCaptureCost;
+
+   // The train runs until the firmware has all it wants, however many
+   // edges that takes.
+   shape.count = 0;
+
+   (void) printf("%lu edges, bus clock %lu Hz, OC1_isr %u + %u cycles\n",
+                 edgeCount, HAL_HOST_BUS_HZ,
+                 baseCaptureCost.entryCycles, baseCaptureCost.exitCycles);
+
+   if (serialLoad)
+   {
+      // the host version, it only sets up the model of the port.
+      InitializeSerialPort();
+      (void) printf("SCI0 loaded both ways at %lu baud\n", HAL_HOST_BAUD);
+   }
+
+   if (fixedPeriod || shaped)
+   {
+      (void) printf("prescale  cost  period  dropped  stored  latency\n");
+   }
+   else
+   {
+      (void) printf("prescale  cost  period  max rate Hz  dropped at 5/4 rate  latency\n");
+   }
+
+   for (p = 0; p < sizeof(prescaleShifts); ++p)
+   {
+      for (c = 0; c < sizeof(costMultipliers); ++c)
+      {
+         halHostCaptureCost.entryCycles =
+            (UINT16)(baseCaptureCost.entryCycles * costMultipliers[c]);
+         halHostCaptureCost.exitCycles =
+            (UINT16)(baseCaptureCost.exitCycles * costMultipliers[c]);
+
+         if (shaped)
+         {
+            PulseGenInit(&pulses, &shape, HAL_HOST_BUS_HZ / 1e6);
+            dropped = runEdges(prescaleShifts[p], PulseGenEdges, &pulses,
+                               edgeCount, &stored, &latency);
+            (void) printf("%8u  %3ux  %6s  %7lu  %6lu  %7lu\n",
+                          1u << prescaleShifts[p], costMultipliers[c],
+                          "shaped", dropped, stored, latency);
+            continue;
+         }
+
+         if (fixedPeriod)
+         {
+            dropped = runTrain(prescaleShifts[p], fixedPeriod, edgeCount, &stored,
+                               &latency);
+            (void) printf("%8u  %3ux  %6llu  %7lu  %6lu  %7lu\n",
+                          1u << prescaleShifts[p], costMultipliers[c],
+                          fixedPeriod, dropped, stored, latency);
+            continue;
+         }
+
+         period = sustainablePeriod(prescaleShifts[p], edgeCount);
+         if (period == 0)
+         {
+            (void) printf("%8u  %3ux  drops at every period\n",
+                          1u << prescaleShifts[p], costMultipliers[c]);
+            continue;
+         }
+
+         dropped = runTrain(prescaleShifts[p], period * 4 / 5, edgeCount, &stored,
+                            &latency);
+
+         // the latency is the one at the fastest rate that drops nothing.
+         (void) runTrain(prescaleShifts[p], period, edgeCount, &stored, &latency);
+         (void) printf("%8u  %3ux  %6llu  %11lu  %19lu  %7lu\n",
+                       1u << prescaleShifts[p], costMultipliers[c], period,
+                       (unsigned long)(HAL_HOST_BUS_HZ / period), dropped, latency);
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,336 @@
+/******************************************************************************
+ * ECT timer simulator
+ *
+ * Description:
+ *
+ * See ectsim.h. Events are processed in time order. On the same cycle an
+ * edge on IC1 comes before one on IC2, then the compare on OC3 and last an
+ * overflow.
+ *
+ *****************************************************************************/
+
+// system includes
+#include <stddef.h>
+
+// project includes
+#include "ectsim.h"
+
+// Definitions
+
+// Timer ticks in one trip round TCNT.
+#define TCNT_WRAP ((EctCycles) 65536)
+
+//*****************************************************************************
+// Value of TCNT at a given bus cycle.
+//
+// Parameters:
+//    sim   The simulator.
+//    when  The bus cycle.
+//
+// Return: The counter value.
+//*****************************************************************************
+static UINT16 tcntAt(const EctSim* sim, EctCycles when)
+{
+   return (UINT16)(when >> sim->prescaleShift);
+}
+
+//*****************************************************************************
+// Starts a train of edges at a fixed period.
+//
+// Parameters:
+//    periodic  The train.
+//    period    Bus cycles between edges, at least 1.
+//    count     Number of edges, 0 for a train that never ends.
+//
+// Return: None.
+//*****************************************************************************
+void EctPeriodicInit(EctPeriodic* periodic, EctCycles period,
+                     unsigned long count)
+{
+   periodic->period = period ? period : 1;
+   periodic->next = periodic->period;
+   periodic->remaining = count;
+   periodic->limited = (UINT8)(count != 0);
+}
+
+//*****************************************************************************
+// Hands out the next edge of a fixed period train.
+//
+// Parameters:
+//    context  The EctPeriodic.
+//
+// Return: Bus cycle of the edge, or ECT_NO_EDGE after the last one.
+//*****************************************************************************
+EctCycles EctPeriodicEdges(void* context)
+{
+   EctPeriodic* periodic = (EctPeriodic*)context;
+   EctCycles edge;
+
+   if (periodic->limited)
+   {
+      if (periodic->remaining == 0)
+      {
+         return ECT_NO_EDGE;
+      }
+      --periodic->remaining;
+   }
+
+   edge = periodic->next;
+   periodic->next += periodic->period;
+   return edge;
+}
+
+//*****************************************************************************
+// Resets the simulator to cycle 0 with TCNT at 0 and no flags set.
+//
+// Parameters:
+//    sim            The simulator.
+//    prescaleShift  Timer prescaler as a power of two, 0 to 7.
+//    edgeSource     Supplies the rising edges on IC1.
+//    edgeContext    Handed to edgeSource.
+//
+// Return: None.
+//*****************************************************************************
+void EctSimInit(EctSim* sim, UINT8 prescaleShift, EctEdgeSource edgeSource,
+                void* edgeContext)
+{
+   sim->prescaleShift = (UINT8)(prescaleShift & 7);
+   sim->fastFlagClear = 0;
+   sim->noOverwrite = 0;
+
+   sim->now = 0;
+   sim->nextOverflow = TCNT_WRAP << sim->prescaleShift;
+   sim->edgeSource = edgeSource;
+   sim->edgeContext = edgeContext;
+   sim->nextEdge = edgeSource ? edgeSource(edgeContext) : ECT_NO_EDGE;
+   sim->tc1 = 0;
+   sim->nextEdge2 = ECT_NO_EDGE;
+   sim->edgeSource2 = NULL;
+   sim->edgeContext2 = NULL;
+   sim->tc2 = 0;
+   sim->tc3 = 0;
+   sim->nextCompare3 = sim->nextOverflow;
+   sim->tflg1 = 0;
+   sim->tflg2 = 0;
+
+   sim->edges = 0;
+   sim->dropped = 0;
+   sim->overflows = 0;
+   sim->edges2 = 0;
+   sim->dropped2 = 0;
+   sim->compares3 = 0;
+}
+
+//*****************************************************************************
+// Sets where the edges on IC2 come from. The first one is taken from the
+// source right away, so this goes after EctSimInit and before the timer is
+// run.
+//
+// Parameters:
+//    sim          The simulator.
+//    edgeSource   Supplies the rising edges on IC2, NULL for none.
+//    edgeContext  Handed to edgeSource.
+//
+// Return: None.
+//*****************************************************************************
+void EctSimSetChannel2(EctSim* sim, EctEdgeSource edgeSource,
+                       void* edgeContext)
+{
+   sim->edgeSource2 = edgeSource;
+   sim->edgeContext2 = edgeContext;
+   sim->nextEdge2 = edgeSource ? edgeSource(edgeContext) : ECT_NO_EDGE;
+}
+
+//*****************************************************************************
+// Latches an edge into a capture register and sets its flag, or counts it
+// as dropped if the flag is still set.
+//
+// Parameters:
+//    sim      The simulator.
+//    when     Bus cycle of the edge.
+//    flag     ECT_C1F or ECT_C2F.
+//    capture  The capture register of the channel.
+//    dropped  Its dropped statistic.
+//
+// Return: None.
+//*****************************************************************************
+static void latchEdge(EctSim* sim, EctCycles when, UINT8 flag, UINT16* capture,
+                      unsigned long* dropped)
+{
+   if (sim->tflg1 & flag)
+   {
+      // The interrupt hasn't taken the last capture yet.
+      ++*dropped;
+      if (!sim->noOverwrite)
+      {
+         *capture = tcntAt(sim, when);
+      }
+   }
+   else
+   {
+      *capture = tcntAt(sim, when);
+      sim->tflg1 |= flag;
+   }
+}
+
+//*****************************************************************************
+// Runs the timer up to the given bus cycle.
+//
+// Parameters:
+//    sim    The simulator.
+//    until  The bus cycle to stop at.
+//
+// Return: None.
+//*****************************************************************************
+void EctSimAdvance(EctSim* sim, EctCycles until)
+{
+   while (EctSimNextEvent(sim) <= until)
+   {
+      if (sim->nextEdge <= sim->nextEdge2 && sim->nextEdge <= sim->nextCompare3 &&
+          sim->nextEdge <= sim->nextOverflow)
+      {
+         ++sim->edges;
+         latchEdge(sim, sim->nextEdge, ECT_C1F, &sim->tc1, &sim->dropped);
+         sim->nextEdge = sim->edgeSource(sim->edgeContext);
+      }
+      else if (sim->nextEdge2 <= sim->nextCompare3 &&
+               sim->nextEdge2 <= sim->nextOverflow)
+      {
+         ++sim->edges2;
+         latchEdge(sim, sim->nextEdge2, ECT_C2F, &sim->tc2, &sim->dropped2);
+         sim->nextEdge2 = sim->edgeSource2(sim->edgeContext2);
+      }
+      else if (sim->nextCompare3 <= sim->nextOverflow)
+      {
+         // TCNT gets back to TC3 a trip round later.
+         ++sim->compares3;
+         sim->tflg1 |= ECT_C3F;
+         sim->nextCompare3 += TCNT_WRAP << sim->prescaleShift;
+      }
+      else
+      {
+         ++sim->overflows;
+         sim->tflg2 |= ECT_TOF;
+         sim->nextOverflow += TCNT_WRAP << sim->prescaleShift;
+      }
+   }
+
+   if (until > sim->now)
+   {
+      sim->now = until;
+   }
+}
+
+//*****************************************************************************
+// Bus cycle of the next edge, on either channel, compare or overflow,
+// whichever comes first.
+//
+// Parameters:
+//    sim  The simulator.
+//
+// Return: The bus cycle.
+//*****************************************************************************
+EctCycles EctSimNextEvent(const EctSim* sim)
+{
+   EctCycles next = sim->nextEdge < sim->nextOverflow ? sim->nextEdge : sim->nextOverflow;
+
+   if (sim->nextCompare3 < next)
+   {
+      next = sim->nextCompare3;
+   }
+   return sim->nextEdge2 < next ? sim->nextEdge2 : next;
+}
+
+//*****************************************************************************
+// Reads TCNT.
+//
+// Parameters:
+//    sim  The simulator.
+//
+// Return: The counter value now.
+//*****************************************************************************
+UINT16 EctSimReadTcnt(const EctSim* sim)
+{
+   return tcntAt(sim, sim->now);
+}
+
+//*****************************************************************************
+// Reads TC1. With fast flag clear on this also clears C1F.
+//
+// Parameters:
+//    sim  The simulator.
+//
+// Return: The last captured value.
+//*****************************************************************************
+UINT16 EctSimReadTc1(EctSim* sim)
+{
+   if (sim->fastFlagClear)
+   {
+      sim->tflg1 &= (UINT8)~ECT_C1F;
+   }
+   return sim->tc1;
+}
+
+//*****************************************************************************
+// Reads TC2. With fast flag clear on this also clears C2F.
+//
+// Parameters:
+//    sim  The simulator.
+//
+// Return: The last captured value.
+//*****************************************************************************
+UINT16 EctSimReadTc2(EctSim* sim)
+{
+   if (sim->fastFlagClear)
+   {
+      sim->tflg1 &= (UINT8)~ECT_C2F;
+   }
+   return sim->tc2;
+}
+
+//*****************************************************************************
+// Writes TC3. The compare comes the next time TCNT gets to the value, a
+// whole trip round from now if it is there already.
+//
+// Parameters:
+//    sim    The simulator.
+//    value  The value written.
+//
+// Return: None.
+//*****************************************************************************
+void EctSimWriteTc3(EctSim* sim, UINT16 value)
+{
+   EctCycles tick = sim->now >> sim->prescaleShift;
+   EctCycles ahead = (UINT16)(value - (UINT16)tick);
+
+   sim->tc3 = value;
+   sim->nextCompare3 = (tick + (ahead ? ahead : TCNT_WRAP)) << sim->prescaleShift;
+}
+
+//*****************************************************************************
+// Writes TFLG1. Writing a one clears the flag, writing a zero leaves it.
+//
+// Parameters:
+//    sim    The simulator.
+//    value  The value written.
+//
+// Return: None.
+//*****************************************************************************
+void EctSimWriteTflg1(EctSim* sim, UINT8 value)
+{
+   sim->tflg1 &= (UINT8)~value;
+}
+
+//*****************************************************************************
+// Writes TFLG2. Writing a one clears the flag, writing a zero leaves it.
+//
+// Parameters:
+//    sim    The simulator.
+//    value  The value written.
+//
+// Return: None.
+//*****************************************************************************
+void EctSimWriteTflg2(EctSim* sim, UINT8 value)
+{
+   sim->tflg2 &= (UINT8)~value;
+}
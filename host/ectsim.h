@@ -0,0 +1,125 @@
+/******************************************************************************
+ * ECT timer simulator
+ *
+ * Description:
+ *
+ * A bus cycle model of the parts of the HCS12 Enhanced Capture Timer the
+ * firmware uses:
+ *
+ *    TCNT   free running 16-bit counter, bus clock divided by the prescaler
+ *    TC1    input capture channel 1, latches TCNT on each rising edge
+ *    TC2    input capture channel 2, the same for a second train of edges
+ *    TC3    output compare channel 3, sets C3F each time TCNT gets to it
+ *    TFLG1  C1F and C2F are set by a capture and cleared by writing a one
+ *           to them, or by reading TC1 or TC2 when fast flag clear (TFFCA)
+ *           is on. C3F is set by a compare and cleared by writing a one
+ *    TFLG2  TOF is set when TCNT wraps and cleared by writing a one to it
+ *
+ * The edges come from an EctEdgeSource, which hands out the bus cycle time
+ * of each rising edge in turn, one source for each channel. An edge that
+ * arrives while the channel's flag is still set is lost: the capture
+ * register is overwritten with the new value and the one the interrupt
+ * hadn't read yet is gone, or with ICOVW set the new edge is ignored. Either
+ * way it's counted in the dropped statistic.
+ *
+ * The simulator knows nothing about interrupts or the CPU. The host HAL
+ * (hal_host.c) runs the interrupt service routines when the flags are set
+ * and charges their cost by advancing the simulator.
+ *
+ *****************************************************************************/
+
+#ifndef ECTSIM_H
+#define ECTSIM_H
+
+#include "types.h"
+
+// Time in bus cycles.
+typedef unsigned long long EctCycles;
+
+// Returned by an EctEdgeSource when there are no more edges.
+#define ECT_NO_EDGE (~(EctCycles)0)
+
+// Flag bits, the same as in TFLG1 and TFLG2.
+#define ECT_C1F 0x02
+#define ECT_C2F 0x04
+#define ECT_C3F 0x08
+#define ECT_TOF 0x80
+
+// Supplies the bus cycle time of the next rising edge, or ECT_NO_EDGE.
+// Times have to be increasing.
+typedef EctCycles (*EctEdgeSource)(void* context);
+
+typedef struct
+{
+   // Configuration.
+   UINT8 prescaleShift;       // TSCR2 PR2:0, the timer runs at bus / 2^shift
+   UINT8 fastFlagClear;       // TSCR1 TFFCA, reading TC1 clears C1F
+   UINT8 noOverwrite;         // ICOVW NOVW1, a pending capture isn't replaced
+
+   // State.
+   EctCycles now;             // current bus cycle
+   EctCycles nextEdge;        // next rising edge on IC1
+   EctCycles nextOverflow;    // next time TCNT wraps
+   EctEdgeSource edgeSource;
+   void* edgeContext;
+   UINT16 tc1;
+   EctCycles nextEdge2;       // next rising edge on IC2
+   EctEdgeSource edgeSource2;
+   void* edgeContext2;
+   UINT16 tc2;
+   EctCycles nextCompare3;    // next time TCNT gets to TC3
+   UINT16 tc3;
+   UINT8 tflg1;
+   UINT8 tflg2;
+
+   // Statistics.
+   unsigned long edges;       // rising edges seen
+   unsigned long dropped;     // edges lost to a capture still pending
+   unsigned long overflows;   // times TCNT wrapped
+   unsigned long edges2;      // the same two for IC2
+   unsigned long dropped2;
+   unsigned long compares3;   // times TCNT got to TC3
+} EctSim;
+
+// State of EctPeriodicEdges.
+typedef struct
+{
+   EctCycles next;            // bus cycle of the next edge
+   EctCycles period;          // bus cycles between edges
+   unsigned long remaining;   // edges still to come, 0 for no limit
+   UINT8 limited;             // non-zero when remaining counts down
+} EctPeriodic;
+
+// Starts a train of edges, the first one period cycles in.
+void EctPeriodicInit(EctPeriodic* periodic, EctCycles period,
+                     unsigned long count);
+
+// An EctEdgeSource for an EctPeriodic.
+EctCycles EctPeriodicEdges(void* context);
+
+// Resets the simulator to cycle 0 with TCNT at 0 and no flags set. IC2
+// has no edges until EctSimSetChannel2 gives it some, and TC3 is 0.
+void EctSimInit(EctSim* sim, UINT8 prescaleShift, EctEdgeSource edgeSource,
+                void* edgeContext);
+
+// Sets where the edges on IC2 come from, NULL for none.
+void EctSimSetChannel2(EctSim* sim, EctEdgeSource edgeSource,
+                       void* edgeContext);
+
+// Runs the timer up to the given bus cycle, latching every edge and
+// setting the flags on the way. Going backwards does nothing.
+void EctSimAdvance(EctSim* sim, EctCycles until);
+
+// Bus cycle of the next edge, on either channel, compare or overflow,
+// whichever comes first.
+EctCycles EctSimNextEvent(const EctSim* sim);
+
+// Register access.
+UINT16 EctSimReadTcnt(const EctSim* sim);
+UINT16 EctSimReadTc1(EctSim* sim);
+UINT16 EctSimReadTc2(EctSim* sim);
+void EctSimWriteTc3(EctSim* sim, UINT16 value);
+void EctSimWriteTflg1(EctSim* sim, UINT8 value);
+void EctSimWriteTflg2(EctSim* sim, UINT8 value);
+
+#endif // ECTSIM_H
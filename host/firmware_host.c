@@ -0,0 +1,137 @@
+/******************************************************************************
+ * Host build of the firmware
+ *
+ * Description:
+ *
+ * Runs the firmware on a workstation, with SCI0 on stdin and stdout and a
+ * train of edges on input capture channel 1.
+ *
+ *    firmware_host [--period <us>] [--pulses <shape>] [--skew <spec>]
+ *                  [--fast] [--pty] [--baud <rate>]
+ *
+ *    --period  a steady train this many microseconds apart, 1000 by default
+ *    --pulses  any other train, see pulsegen.h
+ *    --skew    edges on channel 2 as well, following the ones on channel 1:
+ *              <delayUs>[,<jitterUs>[,<missing>]], missing being the
+ *              fraction of them left out
+ *    --fast    don't pace the firmware against the real clock
+ *    --pty     put SCI0 on a pseudo terminal instead, its path goes to
+ *              stderr for a terminal program or script to open
+ *    --baud    bits per second SCI0 is paced at, 9600 like the board by
+ *              default, 0 for no pacing
+ *
+ *****************************************************************************/
+
+#define HAL_HOST_BACKEND
+
+// system includes
+#include <stdlib.h>
+#include <string.h>
+
+// project includes
+#include "hal.h"
+#include "pulsegen.h"
+
+// The firmware's main(), renamed by hal_host.h.
+extern void HalHostFirmwareMain(void);
+
+//*****************************************************************************
+// Entry point of the host build.
+//
+// Parameters:
+//    argc, argv  The command line.
+//
+// Return: Exit status.
+//*****************************************************************************
+int main(int argc, char** argv)
+{
+   static PulseGen edges;
+   static PulseFollower partner;
+   PulseShape shape;
+   double delay = 0.0;
+   double jitter = 0.0;
+   double missing = 0.0;
+   int skew = 0;
+   const char* pty;
+   char* end;
+   unsigned long baud;
+   int i;
+
+   PulseShapeDefaults(&shape);
+
+   for (i = 1; i < argc; ++i)
+   {
+      if (strcmp(argv[i], "--fast") == 0)
+      {
+         HalHostSetPacing(0);
+      }
+      else if (strcmp(argv[i], "--period") == 0 && i + 1 < argc)
+      {
+         shape.kind = PULSE_FIXED;
+         shape.period = strtod(argv[++i], &end);
+         if (*end != '\0' || shape.period <= 0.0)
+         {
+            (void) fprintf(stderr, "%s: bad period %s\n", argv[0], argv[i]);
+            return 2;
+         }
+      }
+      else if (strcmp(argv[i], "--pulses") == 0 && i + 1 < argc)
+      {
+         if (PulseShapeParse(&shape, argv[++i]) != 0)
+         {
+            (void) fprintf(stderr, "%s: bad pulse shape %s\n", argv[0], argv[i]);
+            return 2;
+         }
+      }
+      else if (strcmp(argv[i], "--skew") == 0 && i + 1 < argc)
+      {
+         if (sscanf(argv[++i], "%lf,%lf,%lf", &delay, &jitter, &missing) < 1 ||
+             jitter < 0.0 || missing < 0.0 || missing >= 1.0)
+         {
+            (void) fprintf(stderr, "%s: bad skew %s\n", argv[0], argv[i]);
+            return 2;
+         }
+         skew = 1;
+      }
+      else if (strcmp(argv[i], "--pty") == 0)
+      {
+         pty = HalHostOpenPty();
+         if (pty == NULL)
+         {
+            perror("pseudo terminal");
+            return 1;
+         }
+         (void) fprintf(stderr, "SCI0 on %s\n", pty);
+      }
+      else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc)
+      {
+         baud = strtoul(argv[++i], &end, 10);
+         if (*end != '\0')
+         {
+            (void) fprintf(stderr, "%s: bad baud rate %s\n", argv[0], argv[i]);
+            return 2;
+         }
+         HalHostSetBaudRate(baud);
+      }
+      else
+      {
+         (void) fprintf(stderr,
+            "usage: %s [--period <us>] [--pulses <shape>] [--skew <spec>]"
+            " [--fast] [--pty] [--baud <rate>]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   PulseGenInit(&edges, &shape, HAL_HOST_BUS_HZ / 1e6);
+   HalHostSetEdgeSource(PulseGenEdges, &edges);
+   if (skew)
+   {
+      PulseFollowerInit(&partner, &shape, delay, jitter, missing, HAL_HOST_BUS_HZ / 1e6);
+      HalHostSetEdgeSource2(PulseFollowerEdges, &partner);
+   }
+
+   HalHostFirmwareMain();
+
+   (void) fflush(stdout);
+   return 0;
+}
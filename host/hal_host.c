@@ -0,0 +1,780 @@
+/******************************************************************************
+ * Hardware abstraction layer, Linux host backend
+ *
+ * Description:
+ *
+ * See hal_host.h. Time is the ECT simulator's, counted in bus cycles. It
+ * moves forward when the firmware sleeps, to the next event, while an
+ * interrupt service routine runs, by its modelled cost, and by a few cycles
+ * every time the timer is read so code that polls it sees it move.
+ * Processing between sleeps takes no time at all, which is what you want
+ * when profiling it.
+ *
+ * The events are:
+ *    a rising edge on input capture channel 1, from the edge source
+ *    a rising edge on channel 2, from its own source, while the firmware
+ *    has its interrupt on
+ *    the timer getting to the output compare on channel 3, while the
+ *    firmware has its interrupt on
+ *    the timer overflow
+ *    a character on the serial port, delivered through SCI0_isr
+ *    the transmit data register freeing up, while SCI0_isr has the
+ *    transmit interrupt on
+ *
+ * The serial port is stdin and stdout, or the master side of a pseudo
+ * terminal after HalHostOpenPty(). Set to a baud rate, it keeps the pace of
+ * SCI0: a character takes a frame of ten bits to send or receive, the
+ * transmit data register is free again once the one before it has moved
+ * into the shift register, and characters are taken in no faster than they
+ * could arrive on the wire. The firmware sleeps while its transmit buffer
+ * is full, so the other interrupts go on being serviced while it waits.
+ *
+ * With pacing on, virtual time is held to the real clock, so the firmware
+ * runs at the speed it would on the board and a person can type at it.
+ * Without it the edges come as fast as the firmware can take them, which
+ * suits piped input and profiling.
+ *
+ * End of file on the input ends the program, the next time the firmware
+ * sleeps with nothing left to send.
+ *
+ *****************************************************************************/
+
+#define _XOPEN_SOURCE 700
+#define HAL_HOST_BACKEND
+
+// system includes
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// project includes
+#include "hal.h"
+
+// Definitions
+
+// Cycles a read of TCNT takes, an LDD extended.
+#define TIMER_READ_CYCLES 3
+
+// A start bit, 8 data bits and a stop bit, each 16 cycles of the baud rate
+// divider.
+#define SCI_FRAME_BITS    10
+#define SCI_BIT_SAMPLES   16
+
+// The vector table: the firmware's interrupt service routines.
+extern void OC1_isr(void);
+extern void IC2_isr(void);
+extern void OC3_isr(void);
+extern void TOF_isr(void);
+extern void SCI0_isr(void);
+
+// The firmware's output routine, printf goes through it like on the target.
+extern void TERMIO_PutChar(INT8 ch);
+
+// The modelled registers.
+EctSim halHostEct;
+UINT8 halHostSciReceived = 0;
+UINT16 halHostPageMemory[HAL_HOST_PAGES][HAL_PAGE_WINDOW_WORDS];
+UINT8 halHostPage = HAL_HOST_FIRST_PAGE;
+static UINT8 sciData = 0;
+
+// What the interrupt service routines cost, counted from the instructions
+// CodeWarrior generates for them. Entry includes the 9 cycles of stacking
+// and the vector fetch, exit is the RTI. OC1_isr's exit also has the 14
+// cycles of its latency probe, see PROFILE_LATENCY, and the 15 of its
+// glitch filter. IC2_isr's is estimated from its source: the tests, the
+// store into its ring and the RTI, and OC3_isr's the same way.
+HalHostIsrCost halHostCaptureCost = { 38, 37 };
+HalHostIsrCost halHostCapture2Cost = { 31, 38 };
+HalHostIsrCost halHostCompare3Cost = { 24, 34 };
+HalHostIsrCost halHostOverflowCost = { 21, 8 };
+HalHostIsrCost halHostReceiveCost = { 45, 8 };
+
+// The transmit half of SCI0_isr, estimated the same way: it gets past the
+// receive test before it writes, and turns the interrupt off on the way
+// out once the buffer is empty.
+HalHostIsrCost halHostTransmitCost = { 44, 14 };
+
+// Interrupt enables, set by InitializeTimer and InitializeSerialPort.
+static int captureInterruptEnabled = 0;
+static int overflowInterruptEnabled = 0;
+static int receiveInterruptEnabled = 0;
+
+// Turned on and off by the firmware as it has something to send, while it
+// measures skew and while a capture has a duration.
+static int transmitInterruptEnabled = 0;
+static int capture2InterruptEnabled = 0;
+static int compare3InterruptEnabled = 0;
+
+// Set by HalHostSetSerialLoad.
+static int serialLoad = 0;
+
+// Where the edges come from, set by the host program.
+static EctEdgeSource edgeSource = NULL;
+static void* edgeContext = NULL;
+static EctEdgeSource edgeSource2 = NULL;
+static void* edgeContext2 = NULL;
+
+// Real time pacing.
+static int paced = 1;
+static struct timespec startTime;
+
+// The serial port. frameCycles is 0 when it isn't paced at the baud rate.
+static unsigned long baudRate = HAL_HOST_BAUD;
+static int sciInput = STDIN_FILENO;
+static FILE* sciOutput = NULL;
+static int ptySlave = -1;
+static EctCycles frameCycles = 0;
+static EctCycles transmitLoad = 0;    // when the data register is free again
+static EctCycles transmitEnd = 0;     // when the shift register is empty
+static EctCycles receiveFree = 0;     // when the next character can arrive
+static int inputEnded = 0;
+
+//*****************************************************************************
+// Works out how many bus cycles of real time have gone by since the timer
+// was started.
+//
+// Parameters: None.
+//
+// Return: Elapsed real time in bus cycles.
+//*****************************************************************************
+static EctCycles realCycles(void)
+{
+   struct timespec now;
+   long long nanoseconds;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+   nanoseconds = (long long)(now.tv_sec - startTime.tv_sec) * 1000000000LL +
+                 (now.tv_nsec - startTime.tv_nsec);
+   return (EctCycles)nanoseconds * HAL_HOST_BUS_HZ / 1000000000ULL;
+}
+
+//*****************************************************************************
+// Where the firmware's output goes.
+//
+// Parameters: None.
+//
+// Return: The stream.
+//*****************************************************************************
+static FILE* output(void)
+{
+   return (sciOutput != NULL) ? sciOutput : stdout;
+}
+
+//*****************************************************************************
+// Holds virtual time back until the real clock has caught up with it, when
+// paced.
+//
+// Parameters:
+//    until  Bus cycle to wait for.
+//
+// Return: None.
+//*****************************************************************************
+static void waitForRealTime(EctCycles until)
+{
+   struct timespec delay;
+   EctCycles real;
+   unsigned long long nanoseconds;
+
+   if (!paced)
+   {
+      return;
+   }
+
+   real = realCycles();
+   if (until > real)
+   {
+      nanoseconds = (until - real) * 1000000000ULL / HAL_HOST_BUS_HZ;
+      delay.tv_sec = (time_t)(nanoseconds / 1000000000ULL);
+      delay.tv_nsec = (long)(nanoseconds % 1000000000ULL);
+      (void) nanosleep(&delay, NULL);
+   }
+}
+
+//*****************************************************************************
+// Waits for a character on the serial port, until the given virtual time when paced or
+// not at all when running fast.
+//
+// Parameters:
+//    deadline  Bus cycle of the next timer event.
+//    ch        Where the character is stored.
+//
+// Return: Non-zero if a character was read.
+//*****************************************************************************
+static int waitForInput(EctCycles deadline, UINT8* ch)
+{
+   fd_set readable;
+   struct timeval timeout;
+   EctCycles real = 0;
+   unsigned long long microseconds;
+   ssize_t count;
+
+   timeout.tv_sec = 0;
+   timeout.tv_usec = 0;
+
+   if (paced)
+   {
+      real = realCycles();
+      if (deadline > real)
+      {
+         microseconds = (deadline - real) * 1000000ULL / HAL_HOST_BUS_HZ;
+         timeout.tv_sec = (time_t)(microseconds / 1000000ULL);
+         timeout.tv_usec = (suseconds_t)(microseconds % 1000000ULL);
+      }
+   }
+
+   FD_ZERO(&readable);
+   FD_SET(sciInput, &readable);
+   if (select(sciInput + 1, &readable, NULL, NULL, &timeout) <= 0)
+   {
+      return 0;
+   }
+
+   do
+   {
+      count = read(sciInput, ch, 1);
+   }
+   while (count < 0 && errno == EINTR);
+
+   if (count <= 0)
+   {
+      // End of the input, that's the end of the session once the firmware
+      // is done with what it has.
+      inputEnded = 1;
+      return 0;
+   }
+
+   // The character came in at the current real time, if that's later.
+   if (paced)
+   {
+      real = realCycles();
+      EctSimAdvance(&halHostEct, real < deadline ? real : deadline);
+   }
+
+   return 1;
+}
+
+//*****************************************************************************
+// Runs an interrupt service routine and charges its cost to the timer.
+//
+// Parameters:
+//    isr   The interrupt service routine.
+//    cost  What it costs.
+//
+// Return: None.
+//*****************************************************************************
+static void runIsr(void (*isr)(void), const HalHostIsrCost* cost)
+{
+   EctSimAdvance(&halHostEct, halHostEct.now + cost->entryCycles);
+   isr();
+   EctSimAdvance(&halHostEct, halHostEct.now + cost->exitCycles);
+}
+
+//*****************************************************************************
+// Runs SCI0_isr for a received character, a free transmit data register or
+// both. A call that does both is charged both halves in full, which errs on
+// the slow side.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+static void runSci(void)
+{
+   HalHostIsrCost cost = halHostTransmitCost;
+
+   if (halHostSciReceived)
+   {
+      cost = halHostReceiveCost;
+      if (transmitInterruptEnabled && halHostEct.now >= transmitLoad)
+      {
+         cost.exitCycles = (UINT16)(cost.exitCycles + halHostTransmitCost.entryCycles +
+                                    halHostTransmitCost.exitCycles);
+      }
+   }
+
+   runIsr(SCI0_isr, &cost);
+}
+
+//*****************************************************************************
+// Turns real time pacing on or off.
+//
+// Parameters:
+//    on  Non-zero to hold virtual time to the real clock.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostSetPacing(int on)
+{
+   paced = on;
+}
+
+//*****************************************************************************
+// Sets where the edges on input capture channel 1 come from. Takes effect
+// when the timer is started.
+//
+// Parameters:
+//    source   Hands out the bus cycle of each edge, NULL for none.
+//    context  Handed to source.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostSetEdgeSource(EctEdgeSource source, void* context)
+{
+   edgeSource = source;
+   edgeContext = context;
+}
+
+//*****************************************************************************
+// Sets where the edges on input capture channel 2 come from, the same way.
+//
+// Parameters:
+//    source   Hands out the bus cycle of each edge, NULL for none.
+//    context  Handed to source.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostSetEdgeSource2(EctEdgeSource source, void* context)
+{
+   edgeSource2 = source;
+   edgeContext2 = context;
+}
+
+//*****************************************************************************
+// Sets the baud rate the serial port is paced at once InitializeSerialPort
+// has run, HAL_HOST_BAUD by default. 0 turns the pacing off, characters then
+// take no time at all.
+//
+// Parameters:
+//    baud  Bits per second.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostSetBaudRate(unsigned long baud)
+{
+   baudRate = baud;
+}
+
+//*****************************************************************************
+// Keeps SCI0 busy both ways for the benches, once InitializeSerialPort has
+// run: a character comes in every frame, right behind the one before, and
+// what the firmware sends is thrown away. The firmware's transmit buffer
+// is the bench's to keep full.
+//
+// Parameters:
+//    on  Non-zero to load the port.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostSetSerialLoad(int on)
+{
+   serialLoad = on;
+   receiveFree = halHostEct.now;
+}
+
+//*****************************************************************************
+// Moves the serial port onto a new pseudo terminal, in raw mode so the
+// characters go through as they are. The slave side is held open as well,
+// so the port stays up while terminal programs come and go on it.
+//
+// Parameters: None.
+//
+// Return: Path of the slave side, NULL if it couldn't be set up.
+//*****************************************************************************
+const char* HalHostOpenPty(void)
+{
+   struct termios settings;
+   const char* name;
+   int master;
+
+   master = posix_openpt(O_RDWR | O_NOCTTY);
+   if (master < 0)
+   {
+      return NULL;
+   }
+
+   name = (grantpt(master) == 0 && unlockpt(master) == 0) ? ptsname(master) : NULL;
+   if (name != NULL)
+   {
+      ptySlave = open(name, O_RDWR | O_NOCTTY);
+   }
+
+   if (ptySlave < 0 || tcgetattr(ptySlave, &settings) != 0)
+   {
+      (void) close(master);
+      return NULL;
+   }
+
+   settings.c_iflag &= ~(tcflag_t)(IGNBRK | BRKINT | PARMRK | ISTRIP |
+                                   INLCR | IGNCR | ICRNL | IXON);
+   settings.c_oflag &= ~(tcflag_t)OPOST;
+   settings.c_lflag &= ~(tcflag_t)(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+   settings.c_cflag &= ~(tcflag_t)(CSIZE | PARENB);
+   settings.c_cflag |= CS8;
+   (void) tcsetattr(ptySlave, TCSANOW, &settings);
+
+   sciOutput = fdopen(master, "w");
+   if (sciOutput == NULL)
+   {
+      (void) close(master);
+      return NULL;
+   }
+
+   sciInput = master;
+   return name;
+}
+
+//*****************************************************************************
+// Starts the timer from cycle 0 with the capture and overflow interrupts on.
+//
+// Parameters:
+//    prescaleShift  Timer prescaler as a power of two.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostStartTimer(UINT8 prescaleShift)
+{
+   (void) clock_gettime(CLOCK_MONOTONIC, &startTime);
+   EctSimInit(&halHostEct, prescaleShift, edgeSource, edgeContext);
+   EctSimSetChannel2(&halHostEct, edgeSource2, edgeContext2);
+   transmitLoad = 0;
+   transmitEnd = 0;
+   receiveFree = 0;
+   captureInterruptEnabled = 1;
+   overflowInterruptEnabled = 1;
+}
+
+//*****************************************************************************
+// Host version of InitializeSerialPort. SCI0 is stdin and stdout unless
+// HalHostOpenPty() has moved it.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void InitializeSerialPort(void)
+{
+   unsigned long divider;
+
+   // The frame takes what it would with SCI0BD set for the baud rate.
+   frameCycles = 0;
+   if (baudRate != 0)
+   {
+      divider = (HAL_HOST_BUS_HZ / SCI_BIT_SAMPLES + baudRate / 2) / baudRate;
+      frameCycles = (EctCycles)(divider ? divider : 1) * SCI_BIT_SAMPLES *
+                    SCI_FRAME_BITS;
+   }
+
+   receiveInterruptEnabled = 1;
+}
+
+//*****************************************************************************
+// Host version of InitializeTimer. Starts the timer at the prescaler the
+// target uses.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void InitializeTimer(void)
+{
+   HalHostStartTimer(HAL_HOST_PRESCALE_SHIFT);
+}
+
+//*****************************************************************************
+// Runs the timer interrupts whose flags are set, and the transmit interrupt
+// when it is on and the data register is free. IC1 is promoted so it goes
+// first, and the rest in the order of their vector addresses, IC2, OC3, the
+// overflow and SCI0, as the interrupt controller would take them.
+//
+// Parameters: None.
+//
+// Return: How many interrupt service routines ran.
+//*****************************************************************************
+int HalHostDispatchInterrupts(void)
+{
+   int serviced = 0;
+
+   if (captureInterruptEnabled && (halHostEct.tflg1 & ECT_C1F))
+   {
+      runIsr(OC1_isr, &halHostCaptureCost);
+      ++serviced;
+   }
+
+   if (capture2InterruptEnabled && (halHostEct.tflg1 & ECT_C2F))
+   {
+      runIsr(IC2_isr, &halHostCapture2Cost);
+      ++serviced;
+   }
+
+   if (compare3InterruptEnabled && (halHostEct.tflg1 & ECT_C3F))
+   {
+      runIsr(OC3_isr, &halHostCompare3Cost);
+      ++serviced;
+   }
+
+   if (overflowInterruptEnabled && (halHostEct.tflg2 & ECT_TOF))
+   {
+      runIsr(TOF_isr, &halHostOverflowCost);
+      ++serviced;
+   }
+
+   if (serialLoad && receiveInterruptEnabled && halHostEct.now >= receiveFree)
+   {
+      sciData = 'U';
+      halHostSciReceived = 1;
+      receiveFree += frameCycles;
+   }
+
+   if (halHostSciReceived ||
+       (transmitInterruptEnabled && halHostEct.now >= transmitLoad))
+   {
+      runSci();
+      ++serviced;
+   }
+
+   return serviced;
+}
+
+//*****************************************************************************
+// Reads the free running counter, which takes a few cycles.
+//
+// Parameters: None.
+//
+// Return: TCNT.
+//*****************************************************************************
+UINT16 HalHostReadTimer(void)
+{
+   EctSimAdvance(&halHostEct, halHostEct.now + TIMER_READ_CYCLES);
+   return EctSimReadTcnt(&halHostEct);
+}
+
+//*****************************************************************************
+// Fetches the received character, which clears the receive flag.
+//
+// Parameters: None.
+//
+// Return: The character.
+//*****************************************************************************
+UINT8 HalHostSciRead(void)
+{
+   halHostSciReceived = 0;
+   return sciData;
+}
+
+//*****************************************************************************
+// Sends a character. With the port paced it goes into the shift register
+// when the one before it has gone out, and the data register is busy until
+// then.
+//
+// Parameters:
+//    ch  The character.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostSciWrite(UINT8 ch)
+{
+   if (frameCycles != 0)
+   {
+      transmitLoad = (transmitEnd > halHostEct.now) ? transmitEnd : halHostEct.now;
+      transmitEnd = transmitLoad + frameCycles;
+   }
+
+   if (!serialLoad)
+   {
+      (void) fputc(ch, output());
+   }
+}
+
+//*****************************************************************************
+// Works out when the next interrupt is due: the next timer event, the
+// transmit data register freeing up while the transmit interrupt is on, or
+// the next character of the serial load.
+//
+// Parameters: None.
+//
+// Return: Bus cycle of the next event.
+//*****************************************************************************
+EctCycles HalHostNextEvent(void)
+{
+   EctCycles next = EctSimNextEvent(&halHostEct);
+
+   if (transmitInterruptEnabled && transmitLoad < next)
+   {
+      next = transmitLoad;
+   }
+   if (serialLoad && receiveInterruptEnabled && receiveFree < next)
+   {
+      next = receiveFree;
+   }
+
+   return next;
+}
+
+//*****************************************************************************
+// printf for the firmware. Formats into a buffer and sends it one character
+// at a time through TERMIO_PutChar, like the target's library does.
+//
+// Parameters:
+//    format  printf format string, followed by its arguments.
+//
+// Return: Number of characters written.
+//*****************************************************************************
+int HalHostPrintf(const char* format, ...)
+{
+   char buffer[256];
+   va_list args;
+   int length;
+   int i;
+
+   va_start(args, format);
+   length = vsnprintf(buffer, sizeof(buffer), format, args);
+   va_end(args);
+
+   if (length > (int)sizeof(buffer) - 1)
+   {
+      length = (int)sizeof(buffer) - 1;
+   }
+
+   for (i = 0; i < length; ++i)
+   {
+      TERMIO_PutChar(buffer[i]);
+   }
+
+   return length;
+}
+
+//*****************************************************************************
+// Waits for the next event, or the given time if that comes first, and runs
+// the interrupt service routine of the event.
+//
+// Parameters:
+//    limit  Bus cycle to stop at.
+//
+// Return: None.
+//*****************************************************************************
+static void sleepUntil(EctCycles limit)
+{
+   EctCycles next;
+   UINT8 ch;
+
+   // Flags that came up while the firmware was busy are taken first, the
+   // same as when it unmasks them on the target.
+   if (HalHostDispatchInterrupts())
+   {
+      return;
+   }
+
+   next = HalHostNextEvent();
+   if (limit < next)
+   {
+      next = limit;
+   }
+
+   (void) fflush(output());
+
+   // A character can't come in before the last one has finished arriving.
+   if (receiveInterruptEnabled && !inputEnded && receiveFree > halHostEct.now)
+   {
+      if (receiveFree < next)
+      {
+         next = receiveFree;
+      }
+      waitForRealTime(next);
+      EctSimAdvance(&halHostEct, next);
+      (void) HalHostDispatchInterrupts();
+      return;
+   }
+
+   if (receiveInterruptEnabled && !inputEnded && waitForInput(next, &ch))
+   {
+      // Terminals and scripts end their lines with a line feed, the
+      // firmware wants the carriage return a terminal program would send.
+      sciData = (ch == '\n') ? (UINT8)'\r' : ch;
+      halHostSciReceived = 1;
+      receiveFree = halHostEct.now + frameCycles;
+      runSci();
+      return;
+   }
+
+   EctSimAdvance(&halHostEct, next);
+   (void) HalHostDispatchInterrupts();
+}
+
+//*****************************************************************************
+// Reads the transmit data register empty flag.
+//
+// Parameters: None.
+//
+// Return: Non-zero if the next character can be written.
+//*****************************************************************************
+int HalHostSciTransmitReady(void)
+{
+   return halHostEct.now >= transmitLoad;
+}
+
+//*****************************************************************************
+// Turns the transmit interrupt on or off. While it is on, SCI0_isr runs
+// each time the data register is free.
+//
+// Parameters:
+//    on  Non-zero to turn it on.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostSciTransmitInterrupt(int on)
+{
+   transmitInterruptEnabled = on;
+}
+
+//*****************************************************************************
+// Turns the input capture channel 2 interrupt on or off. A capture that
+// came in while it was off is still flagged when it is turned on, the same
+// as on the target.
+//
+// Parameters:
+//    on  Non-zero to turn it on.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostCapture2Interrupt(int on)
+{
+   capture2InterruptEnabled = on;
+}
+
+//*****************************************************************************
+// Turns the output compare channel 3 interrupt on or off, the same way.
+//
+// Parameters:
+//    on  Non-zero to turn it on.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostCompare3Interrupt(int on)
+{
+   compare3InterruptEnabled = on;
+}
+
+//*****************************************************************************
+// Waits for the next event and runs its interrupt service routine. This is
+// where all the interrupts happen in the host build.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void HalHostSleepUntilInterrupt(void)
+{
+   if (inputEnded && !transmitInterruptEnabled)
+   {
+      (void) fflush(output());
+      exit(0);
+   }
+
+   sleepUntil(ECT_NO_EDGE);
+}
@@ -0,0 +1,155 @@
+/******************************************************************************
+ * Hardware abstraction layer, Linux host backend
+ *
+ * Description:
+ *
+ * Lets the firmware build and run unchanged under gcc on a workstation, so
+ * the capture, histogram and output code can be profiled and debugged
+ * without a board. Selected by defining HAL_HOST, see host/Makefile.
+ *
+ * The timer is the ECT simulator in ectsim.c, run in bus cycles. Interrupts
+ * are never taken asynchronously: the interrupt service routines are called
+ * from inside HAL_SLEEP_UNTIL_INTERRUPT(), which is the only place the
+ * firmware waits. That makes masking interrupts a no-op here. Each call of
+ * an interrupt service routine is charged the cycles it would take on the
+ * target, so edges that come in while one runs are latched, or lost, the
+ * way they would be on the board.
+ *
+ * Paged memory is an array of pages the size of the PPAGE window, all of
+ * them writable, and the window is a pointer to the page that is mapped.
+ *
+ * SCI0 is mapped onto stdin and stdout, or a pseudo terminal, and can be
+ * paced at its baud rate. The firmware's main() is renamed so
+ * the host programs can provide the real one, and printf is routed through
+ * TERMIO_PutChar the same way the target library does it.
+ *
+ *****************************************************************************/
+
+#ifndef HAL_HOST_H
+#define HAL_HOST_H
+
+#include <stdio.h>
+#include "types.h"
+#include "ectsim.h"
+
+// Bus clock of the board, the rate the simulator's cycles are paced at.
+#define HAL_HOST_BUS_HZ 2000000UL
+
+// Prescaler InitializeTimer sets, as a power of two.
+#define HAL_HOST_PRESCALE_SHIFT 1
+
+// Baud rate InitializeSerialPort sets.
+#define HAL_HOST_BAUD 9600UL
+
+// Pages of paged memory, numbered from HAL_HOST_FIRST_PAGE like the
+// DT256's 0x30 to 0x3F.
+#define HAL_HOST_FIRST_PAGE 0x30
+#define HAL_HOST_PAGES 16
+
+// Modelled cost of an interrupt in bus cycles. entryCycles runs from the
+// flag being taken to the register access that reads the data and clears
+// it, exitCycles from there to the end of the RTI.
+typedef struct
+{
+   UINT16 entryCycles;
+   UINT16 exitCycles;
+} HalHostIsrCost;
+
+// The simulated timer and the costs charged for its interrupts.
+extern EctSim halHostEct;
+extern HalHostIsrCost halHostCaptureCost;
+extern HalHostIsrCost halHostCapture2Cost;
+extern HalHostIsrCost halHostCompare3Cost;
+extern HalHostIsrCost halHostOverflowCost;
+extern HalHostIsrCost halHostReceiveCost;
+extern HalHostIsrCost halHostTransmitCost;
+
+extern UINT8 halHostSciReceived;
+
+// Paged memory and the page mapped into the window.
+extern UINT16 halHostPageMemory[HAL_HOST_PAGES][0x2000];
+extern UINT8 halHostPage;
+
+// Set up by the host program before the firmware starts.
+void HalHostSetPacing(int paced);
+void HalHostSetEdgeSource(EctEdgeSource source, void* context);
+void HalHostSetEdgeSource2(EctEdgeSource source, void* context);
+void HalHostSetBaudRate(unsigned long baud);
+
+// Keeps SCI0 busy both ways, for the benches.
+void HalHostSetSerialLoad(int on);
+
+// Moves SCI0 onto a new pseudo terminal. Returns the path of the side to
+// open with a terminal program, NULL if it failed.
+const char* HalHostOpenPty(void);
+
+// Starts the timer with the given prescaler, as InitializeTimer does.
+void HalHostStartTimer(UINT8 prescaleShift);
+
+// Runs the timer interrupts whose flags are set and the transmit interrupt
+// when it is due, highest priority first. Returns how many ran.
+int HalHostDispatchInterrupts(void);
+
+// Bus cycle the next interrupt is due at.
+EctCycles HalHostNextEvent(void);
+
+UINT16 HalHostReadTimer(void);
+UINT8 HalHostSciRead(void);
+void HalHostSciWrite(UINT8 ch);
+void HalHostCapture2Interrupt(int on);
+void HalHostCompare3Interrupt(int on);
+int HalHostSciTransmitReady(void);
+void HalHostSciTransmitInterrupt(int on);
+void HalHostSleepUntilInterrupt(void);
+int HalHostPrintf(const char* format, ...);
+
+#define HAL_READ_TIMER()             HalHostReadTimer()
+#define HAL_READ_CAPTURE1()          EctSimReadTc1(&halHostEct)
+#define HAL_CLEAR_CAPTURE1_FLAG()    EctSimWriteTflg1(&halHostEct, ECT_C1F)
+#define HAL_READ_CAPTURE2()          EctSimReadTc2(&halHostEct)
+#define HAL_CLEAR_CAPTURE2_FLAG()    EctSimWriteTflg1(&halHostEct, ECT_C2F)
+#define HAL_CAPTURE2_INTERRUPT_ON()  HalHostCapture2Interrupt(1)
+#define HAL_CAPTURE2_INTERRUPT_OFF() HalHostCapture2Interrupt(0)
+#define HAL_SET_COMPARE3(value)      EctSimWriteTc3(&halHostEct, (value))
+#define HAL_CLEAR_COMPARE3_FLAG()    EctSimWriteTflg1(&halHostEct, ECT_C3F)
+#define HAL_COMPARE3_INTERRUPT_ON()  HalHostCompare3Interrupt(1)
+#define HAL_COMPARE3_INTERRUPT_OFF() HalHostCompare3Interrupt(0)
+#define HAL_CLEAR_OVERFLOW_FLAG()    EctSimWriteTflg2(&halHostEct, ECT_TOF)
+#define HAL_OVERFLOW_PENDING()       (halHostEct.tflg2 & ECT_TOF)
+#define HAL_TIMER_PRESCALE_SHIFT     HAL_HOST_PRESCALE_SHIFT
+#define HAL_BUS_CLOCK_HZ             HAL_HOST_BUS_HZ
+#define HAL_READ_EDGE_COUNT()        ((UINT8)halHostEct.edges)
+
+// The simulated edges have no width for a delay counter to filter, so there
+// isn't one and the firmware's software filter does all the work.
+#define HAL_CAPTURE_DELAY_STEPS          0
+#define HAL_CAPTURE_DELAY_CYCLES(step)   (128UL << (step))
+#define HAL_SET_CAPTURE_DELAY(step)      ((void)(step))
+
+#define HAL_SCI_RECEIVED()           (halHostSciReceived)
+#define HAL_SCI_READ()               HalHostSciRead()
+#define HAL_SCI_TRANSMIT_READY()     HalHostSciTransmitReady()
+#define HAL_SCI_WRITE(ch)            HalHostSciWrite((UINT8)(ch))
+#define HAL_SCI_TRANSMIT_INTERRUPT_ON()   HalHostSciTransmitInterrupt(1)
+#define HAL_SCI_TRANSMIT_INTERRUPT_OFF()  HalHostSciTransmitInterrupt(0)
+
+#define HAL_ENABLE_INTERRUPTS()      ((void)0)
+#define HAL_DISABLE_INTERRUPTS()     ((void)0)
+#define HAL_SLEEP_UNTIL_INTERRUPT()  HalHostSleepUntilInterrupt()
+
+#define HAL_ISR(vector, name)        void name(void)
+
+#define HAL_PAGE_WINDOW_START        0x8000u
+#define HAL_PAGE_WINDOW_WORDS        0x2000u
+#define HAL_PAGE_WINDOW()            \
+   (halHostPageMemory[(UINT8)(halHostPage - HAL_HOST_FIRST_PAGE) % HAL_HOST_PAGES])
+#define HAL_PAGE_GET()               (halHostPage)
+#define HAL_PAGE_SET(page)           (halHostPage = (UINT8)(page))
+
+// The host programs define HAL_HOST_BACKEND so they can use the real ones.
+#ifndef HAL_HOST_BACKEND
+#define main    HalHostFirmwareMain
+#define printf  HalHostPrintf
+#endif
+
+#endif // HAL_HOST_H
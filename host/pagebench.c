@@ -0,0 +1,931 @@
+/******************************************************************************
+ * Paged data access bench
+ *
+ * Description:
+ *
+ * Checks the model of the datapage.c routines in pagesim.c against the
+ * memory maps, exhaustively, lists what each routine costs, and estimates
+ * what a memory layout pays for putting its objects in paged memory.
+ *
+ *    pagebench [--layout <file>]
+ *
+ * The checks, which have to pass for the rest to mean anything:
+ *
+ *    HCS12   for every -Cp combination, every offset and a spread of pages,
+ *            each load and store reaches the bytes the memory map says it
+ *            should, _SET_PAGE sets the register the map says, and every
+ *            other page register is left as it was
+ *    HCS12X  with and without -MapRAM, every one of the 2^24 global
+ *            addresses that has a logical equivalent converts to the one
+ *            the map gives and back to itself, and every logical address
+ *            converts to the global address the map gives
+ *
+ * The maps are written out from the tables in datapage.c and don't share
+ * any code with the model.
+ *
+ * The cost table gives the fewest and most bus cycles of each routine over
+ * all the addresses the checks ran through, with the JSR and RTS, in the
+ * version each -Cp combination builds.
+ *
+ * The layout estimate takes one object per line:
+ *
+ *    <name> <address> <elements> <bytes per element> <accesses per element>
+ *
+ * with the address the 24 bit logical one, page in the top byte, e.g.
+ * 0x308000 for the start of page 0x30 in the PPAGE window, and # starting
+ * a comment. Each object is walked from its first element to its last as
+ * many times as it has accesses per element, and for each access the bench
+ * gives the cycles it costs as a near access, through the _LOAD_FAR_ and
+ * _STORE_FAR_ routines of a -CpPPAGE build (what the firmware is built
+ * with), through a FarCursor, and as an HCS12X global access, then what
+ * all the accesses cost over the near ones in milliseconds of bus time.
+ * Without --layout it uses the firmware's own capture buffers.
+ *
+ *****************************************************************************/
+
+#define HAL_HOST_BACKEND
+
+// system includes
+#include <stdlib.h>
+#include <string.h>
+
+// project includes
+#include "hal.h"
+#include "pagesim.h"
+
+// Definitions
+
+// Cycles of the accesses the layout estimate compares, estimated from
+// the code CodeWarrior generates for them at the default optimisation.
+#define CYCLES_NEAR            3  // LDD 0,X, per word
+#define CYCLES_FAR_SETUP       6  // LDAB and LDY of the far pointer
+#define CYCLES_CURSOR         15  // FAR_CURSOR_READ: end compare, LDD 2,X+, next
+#define CYCLES_CURSOR_OPEN    60  // FarCursorOpen and FarCursorClose
+#define CYCLES_CURSOR_PAGE    30  // FarCursorNextPage
+#define CYCLES_GPAGE           4  // MOVB #page,GPAGE
+#define CYCLES_GLOBAL          4  // GLDD, per word
+
+// Pages the HCS12 checks run every offset with: the first and last, the
+// ones the firmware uses and a couple with odd bits.
+static const UINT8 checkPages[] = { 0x00, 0x01, 0x30, 0x3F, 0x5A, 0xFF };
+
+// What the page registers hold before each routine runs, all different
+// from each other and from the pages checked.
+#define BACKGROUND_EPAGE 0x21
+#define BACKGROUND_DPAGE 0x42
+#define BACKGROUND_PPAGE 0x3C
+
+#define MAX_LINE 256
+#define MAX_NAME 24
+
+// The routines in the cost table.
+enum
+{
+   ROUTINE_GET_PAGE_REG,
+   ROUTINE_SET_PAGE,
+   ROUTINE_LOAD_FAR_8,
+   ROUTINE_LOAD_FAR_16,
+   ROUTINE_LOAD_FAR_24,
+   ROUTINE_LOAD_FAR_32,
+   ROUTINE_STORE_FAR_8,
+   ROUTINE_STORE_FAR_16,
+   ROUTINE_STORE_FAR_24,
+   ROUTINE_STORE_FAR_32,
+   ROUTINES
+};
+
+static const char* const routineNames[ROUTINES] =
+{
+   "_GET_PAGE_REG", "_SET_PAGE",
+   "_LOAD_FAR_8", "_LOAD_FAR_16", "_LOAD_FAR_24", "_LOAD_FAR_32",
+   "_STORE_FAR_8", "_STORE_FAR_16", "_STORE_FAR_24", "_STORE_FAR_32"
+};
+
+// Fewest and most cycles seen.
+typedef struct
+{
+   unsigned long least;
+   unsigned long most;
+} CycleRange;
+
+// An area of the HCS12X logical map, see datapage.c. Paged areas repeat
+// for every value of their page register.
+typedef struct
+{
+   UINT16 low;
+   UINT16 high;
+   int paged;
+   UINT32 global;         // global address of low, on page 0 if paged
+} MapArea;
+
+static const MapArea hcs12xMap[] =
+{
+   { 0x0000, 0x07FF, 0, 0x000000 },  // registers
+   { 0x0800, 0x0BFF, 1, 0x100000 },  // EPAGE
+   { 0x0C00, 0x0FFF, 0, 0x13FC00 },  // EEPROM
+   { 0x1000, 0x1FFF, 1, 0x000000 },  // RPAGE
+   { 0x2000, 0x3FFF, 0, 0x0FE000 },  // RAM
+   { 0x4000, 0x7FFF, 0, 0x7F4000 },  // flash
+   { 0x8000, 0xBFFF, 1, 0x400000 },  // PPAGE
+   { 0xC000, 0xFFFF, 0, 0x7FC000 }   // flash
+};
+
+// The same with RAMHM set.
+static const MapArea hcs12xeMap[] =
+{
+   { 0x0000, 0x07FF, 0, 0x000000 },
+   { 0x0800, 0x0BFF, 1, 0x100000 },
+   { 0x0C00, 0x0FFF, 0, 0x13FC00 },
+   { 0x1000, 0x1FFF, 1, 0x000000 },
+   { 0x2000, 0x3FFF, 0, 0x0FA000 },
+   { 0x4000, 0x7FFF, 0, 0x0FC000 },
+   { 0x8000, 0xBFFF, 1, 0x400000 },
+   { 0xC000, 0xFFFF, 0, 0x7FC000 }
+};
+
+#define MAP_AREAS (sizeof(hcs12xMap) / sizeof(hcs12xMap[0]))
+
+// The RPAGE area, where page 0 isn't allowed.
+#define RPAGE_AREA 3
+
+// An object of a layout.
+typedef struct
+{
+   char name[MAX_NAME];
+   UINT32 address;
+   unsigned long elements;
+   unsigned int bytes;
+   unsigned long accesses;
+} LayoutObject;
+
+// The firmware's capture buffers, see main.c: the near ring of timer values,
+// the same in paged memory with CAPTURE_PAGED and the histogram. The timer
+// values are written by the capture and read by the processing and by
+// TRACE, each histogram bucket takes an update for every 10 intervals.
+static const LayoutObject firmwareLayout[] =
+{
+   { "timerValuesUs", 0x002000, 1024, 2, 3 },
+   { "paged capture", 0x308000, 65535, 2, 3 },
+   { "histogram", 0x002800, 100, 2, 10 }
+};
+
+static UINT8* memory;
+static CycleRange costs[PAGESIM_ALL + 1][ROUTINES];
+static CycleRange conversionCosts[2][2];
+
+static unsigned long failures = 0;
+
+//*****************************************************************************
+// Reports a check that failed, the first few of them anyway.
+//
+// Parameters:
+//    what     What was checked.
+//    address  Where.
+//    got      What the model gave.
+//    wanted   What the map says.
+//
+// Return: None.
+//*****************************************************************************
+static void fail(const char* what, unsigned long address, unsigned long got,
+                 unsigned long wanted)
+{
+   if (failures < 20)
+   {
+      (void) printf("FAIL %s at %06lX: %06lX, should be %06lX\n", what, address,
+                    got, wanted);
+   }
+   ++failures;
+}
+
+//*****************************************************************************
+// Adds one run of a routine to its cycle range.
+//
+// Parameters:
+//    range   The range.
+//    cycles  The run.
+//
+// Return: None.
+//*****************************************************************************
+static void addCycles(CycleRange* range, unsigned long cycles)
+{
+   if (range->most == 0 || cycles < range->least)
+   {
+      range->least = cycles;
+   }
+   if (cycles > range->most)
+   {
+      range->most = cycles;
+   }
+}
+
+//*****************************************************************************
+// What a byte of memory starts out as, different for every address in a
+// page and from one page to the next.
+//
+// Parameters:
+//    physical  Index into the memory.
+//
+// Return: The byte.
+//*****************************************************************************
+static UINT8 pattern(unsigned long physical)
+{
+   return (UINT8)((physical * 2654435761UL) >> 13);
+}
+
+//*****************************************************************************
+// The HCS12 window an offset is in, from the memory map.
+//
+// Parameters:
+//    offset  The offset.
+//
+// Return: PAGESIM_ register, 0 for none.
+//*****************************************************************************
+static UINT8 windowOf(UINT16 offset)
+{
+   if (offset >= 0x0400 && offset < 0x0800)
+   {
+      return PAGESIM_EPAGE;
+   }
+   if (offset >= 0x7000 && offset < 0x8000)
+   {
+      return PAGESIM_DPAGE;
+   }
+   if (offset >= 0x8000 && offset < 0xC000)
+   {
+      return PAGESIM_PPAGE;
+   }
+   return 0;
+}
+
+//*****************************************************************************
+// Where a byte is on the HCS12 with the page registers at the background
+// values, except the one an access sets.
+//
+// Parameters:
+//    set     PAGESIM_ register the access sets, 0 for none.
+//    page    What it's set to.
+//    offset  The byte.
+//
+// Return: Index into the memory.
+//*****************************************************************************
+static unsigned long expectedPhysical(UINT8 set, UINT8 page, UINT16 offset)
+{
+   UINT8 window = windowOf(offset);
+   UINT8 value;
+
+   switch (window)
+   {
+   case PAGESIM_EPAGE:
+      value = (set == window) ? page : BACKGROUND_EPAGE;
+      return PAGESIM_EPAGE_MEMORY + value * 0x400UL + (offset - 0x0400u);
+   case PAGESIM_DPAGE:
+      value = (set == window) ? page : BACKGROUND_DPAGE;
+      return PAGESIM_DPAGE_MEMORY + value * 0x1000UL + (offset - 0x7000u);
+   case PAGESIM_PPAGE:
+      value = (set == window) ? page : BACKGROUND_PPAGE;
+      return PAGESIM_PPAGE_MEMORY + value * 0x4000UL + (offset - 0x8000u);
+   default:
+      return offset;
+   }
+}
+
+//*****************************************************************************
+// Runs one load or store routine at one address and checks it.
+//
+// Parameters:
+//    sim      The model, with the background page registers.
+//    routine  ROUTINE_LOAD_ or ROUTINE_STORE_.
+//    set      The register the routine should set, 0 for none.
+//    address  Page and offset.
+//
+// Return: None.
+//*****************************************************************************
+static void checkAccess(PageSim* sim, int routine, UINT8 set, UINT32 address)
+{
+   UINT8 page = (UINT8)(address >> 16);
+   UINT16 offset = (UINT16)address;
+   unsigned int size = (unsigned int)(routine - ROUTINE_LOAD_FAR_8) % 4 + 1;
+   int store = routine >= ROUTINE_STORE_FAR_8;
+   unsigned long physical[4];
+   UINT32 wanted = 0;
+   UINT32 got = 0;
+   unsigned long start;
+   unsigned int i;
+
+   for (i = 0; i < size; ++i)
+   {
+      physical[i] = expectedPhysical(set, page, (UINT16)(offset + i));
+      // stores write the complement, so a byte left alone shows.
+      wanted = (wanted << 8) | (UINT8)(pattern(physical[i]) ^ (store ? 0xFF : 0));
+   }
+
+   start = sim->cycles;
+   switch (routine)
+   {
+   case ROUTINE_LOAD_FAR_8:   got = PageSimLoadFar8(sim, address); break;
+   case ROUTINE_LOAD_FAR_16:  got = PageSimLoadFar16(sim, address); break;
+   case ROUTINE_LOAD_FAR_24:  got = PageSimLoadFar24(sim, address); break;
+   case ROUTINE_LOAD_FAR_32:  got = PageSimLoadFar32(sim, address); break;
+   case ROUTINE_STORE_FAR_8:  PageSimStoreFar8(sim, address, (UINT8)wanted); break;
+   case ROUTINE_STORE_FAR_16: PageSimStoreFar16(sim, address, (UINT16)wanted); break;
+   case ROUTINE_STORE_FAR_24: PageSimStoreFar24(sim, address, wanted); break;
+   default:                   PageSimStoreFar32(sim, address, wanted); break;
+   }
+   addCycles(&costs[sim->pages][routine], sim->cycles - start);
+
+   if (store)
+   {
+      for (i = 0; i < size; ++i)
+      {
+         got = (got << 8) | memory[physical[i]];
+         memory[physical[i]] = pattern(physical[i]);
+      }
+   }
+
+   if (got != wanted)
+   {
+      fail(routineNames[routine], address, got, wanted);
+   }
+   if (sim->epage != BACKGROUND_EPAGE || sim->dpage != BACKGROUND_DPAGE ||
+       sim->ppage != BACKGROUND_PPAGE)
+   {
+      fail(routineNames[routine], address,
+           ((unsigned long)sim->epage << 16) | (sim->dpage << 8) | sim->ppage,
+           ((unsigned long)BACKGROUND_EPAGE << 16) | (BACKGROUND_DPAGE << 8) |
+              BACKGROUND_PPAGE);
+      sim->epage = BACKGROUND_EPAGE;
+      sim->dpage = BACKGROUND_DPAGE;
+      sim->ppage = BACKGROUND_PPAGE;
+   }
+}
+
+//*****************************************************************************
+// Checks every HCS12 routine in the version one -Cp combination builds.
+//
+// Parameters:
+//    pages  PAGESIM_ registers given with -Cp.
+//
+// Return: None.
+//*****************************************************************************
+static void checkHcs12(UINT8 pages)
+{
+   PageSim sim;
+   UINT32 address;
+   UINT8 several = (UINT8)((pages & (pages - 1)) != 0);
+   UINT8 set;
+   UINT8 reg;
+   unsigned long start;
+   unsigned long got;
+   unsigned long wanted;
+   unsigned int p;
+   unsigned long offset;
+   int routine;
+
+   PageSimInit(&sim, pages, memory);
+   sim.epage = BACKGROUND_EPAGE;
+   sim.dpage = BACKGROUND_DPAGE;
+   sim.ppage = BACKGROUND_PPAGE;
+
+   for (p = 0; p < sizeof(checkPages); ++p)
+   {
+      for (offset = 0; offset <= 0xFFFF; ++offset)
+      {
+         address = ((UINT32)checkPages[p] << 16) | (UINT32)offset;
+
+         // with several registers the one the window needs, if it's
+         // given, otherwise the one there is.
+         set = several ? (UINT8)(windowOf((UINT16)offset) & pages) : pages;
+
+         if (several)
+         {
+            start = sim.cycles;
+            reg = PageSimGetPageReg(&sim, (UINT16)offset);
+            addCycles(&costs[pages][ROUTINE_GET_PAGE_REG], sim.cycles - start);
+            if (reg != set)
+            {
+               fail("_GET_PAGE_REG", address, reg, set);
+            }
+         }
+
+         start = sim.cycles;
+         PageSimSetPage(&sim, address);
+         addCycles(&costs[pages][ROUTINE_SET_PAGE], sim.cycles - start);
+         wanted = ((unsigned long)((set == PAGESIM_EPAGE) ? checkPages[p] : BACKGROUND_EPAGE) << 16) |
+                  ((unsigned long)((set == PAGESIM_DPAGE) ? checkPages[p] : BACKGROUND_DPAGE) << 8) |
+                  ((set == PAGESIM_PPAGE) ? checkPages[p] : BACKGROUND_PPAGE);
+         got = ((unsigned long)sim.epage << 16) | ((unsigned long)sim.dpage << 8) | sim.ppage;
+         if (got != wanted)
+         {
+            fail("_SET_PAGE", address, got, wanted);
+         }
+         sim.epage = BACKGROUND_EPAGE;
+         sim.dpage = BACKGROUND_DPAGE;
+         sim.ppage = BACKGROUND_PPAGE;
+
+         for (routine = ROUTINE_LOAD_FAR_8; routine < ROUTINES; ++routine)
+         {
+            checkAccess(&sim, routine, set, address);
+         }
+      }
+   }
+}
+
+//*****************************************************************************
+// The HCS12X global address of a logical one, from the map.
+//
+// Parameters:
+//    map      The map.
+//    logical  Page and offset.
+//
+// Return: The global address.
+//*****************************************************************************
+static UINT32 mapToGlobal(const MapArea* map, UINT32 logical)
+{
+   UINT16 offset = (UINT16)logical;
+   UINT32 size;
+   unsigned int i;
+
+   for (i = 0; offset > map[i].high; ++i)
+   {
+   }
+
+   size = (UINT32)(map[i].high - map[i].low) + 1;
+   return map[i].global + (map[i].paged ? (logical >> 16) * size : 0) +
+          (offset - map[i].low);
+}
+
+//*****************************************************************************
+// The HCS12X logical address of a global one, from the map: the one that
+// isn't paged if there is one.
+//
+// Parameters:
+//    map      The map.
+//    global   The global address.
+//    logical  Set to page and offset.
+//
+// Return: Non-zero if the global address has a logical one.
+//*****************************************************************************
+static int mapToLogical(const MapArea* map, UINT32 global, UINT32* logical)
+{
+   UINT32 size;
+   UINT32 page;
+   unsigned int i;
+   int paged;
+
+   for (paged = 0; paged <= 1; ++paged)
+   {
+      for (i = 0; i < MAP_AREAS; ++i)
+      {
+         size = (UINT32)(map[i].high - map[i].low) + 1;
+         if (map[i].paged != paged || global < map[i].global ||
+             global - map[i].global >= (paged ? size * 256 : size))
+         {
+            continue;
+         }
+
+         page = (global - map[i].global) / size;
+         if (paged && i == RPAGE_AREA && page == 0)
+         {
+            continue;
+         }
+         *logical = (page << 16) | (map[i].low + (global - map[i].global) % size);
+         return 1;
+      }
+   }
+   return 0;
+}
+
+//*****************************************************************************
+// Checks both HCS12X conversions over all 2^24 addresses.
+//
+// Parameters:
+//    ramhm  Non-zero for the HCS12XE RAM mapping.
+//
+// Return: Number of global addresses that have no logical one.
+//*****************************************************************************
+static unsigned long checkHcs12x(UINT8 ramhm)
+{
+   const MapArea* map = ramhm ? hcs12xeMap : hcs12xMap;
+   PageSimX sim;
+   UINT32 address;
+   UINT32 logical;
+   UINT32 wanted;
+   UINT32 global;
+   unsigned long start;
+   unsigned long unmapped = 0;
+
+   sim.ramhm = ramhm;
+   sim.cycles = 0;
+
+   for (address = 0; address <= 0xFFFFFF; ++address)
+   {
+      start = sim.cycles;
+      logical = PageSimXGlobalToLogical(&sim, address);
+      addCycles(&conversionCosts[ramhm][0], sim.cycles - start);
+
+      if (!mapToLogical(map, address, &wanted))
+      {
+         ++unmapped;
+      }
+      else
+      {
+         if (logical != wanted)
+         {
+            fail(ramhm ? "_CONV_GLOBAL_TO_LOGICAL -MapRAM" : "_CONV_GLOBAL_TO_LOGICAL",
+                 address, logical, wanted);
+         }
+         global = PageSimXLogicalToGlobal(&sim, logical);
+         if (global != address)
+         {
+            fail(ramhm ? "round trip -MapRAM" : "round trip", address, global, address);
+         }
+      }
+
+      // the same number as a logical address.
+      start = sim.cycles;
+      global = PageSimXLogicalToGlobal(&sim, address);
+      addCycles(&conversionCosts[ramhm][1], sim.cycles - start);
+      wanted = mapToGlobal(map, address);
+      if (global != wanted)
+      {
+         fail(ramhm ? "_CONV_LOGICAL_TO_GLOBAL -MapRAM" : "_CONV_LOGICAL_TO_GLOBAL",
+              address, global, wanted);
+      }
+   }
+
+   return unmapped;
+}
+
+//*****************************************************************************
+// Writes the names of the page registers in a -Cp combination.
+//
+// Parameters:
+//    pages  PAGESIM_ registers.
+//
+// Return: None.
+//*****************************************************************************
+static void printPages(UINT8 pages)
+{
+   char name[4];
+   int length = 0;
+
+   if (pages & PAGESIM_EPAGE)
+   {
+      name[length++] = 'E';
+   }
+   if (pages & PAGESIM_DPAGE)
+   {
+      name[length++] = 'D';
+   }
+   if (pages & PAGESIM_PPAGE)
+   {
+      name[length++] = 'P';
+   }
+   name[length] = '\0';
+   (void) printf("  %7s", name);
+}
+
+//*****************************************************************************
+// Writes a cycle range, a dash for a routine that wasn't run.
+//
+// Parameters:
+//    range  The range.
+//
+// Return: None.
+//*****************************************************************************
+static void printRange(const CycleRange* range)
+{
+   char text[48];
+
+   if (range->most == 0)
+   {
+      (void) printf("  %7s", "-");
+      return;
+   }
+   if (range->least == range->most)
+   {
+      (void) snprintf(text, sizeof(text), "%lu", range->most);
+   }
+   else
+   {
+      (void) snprintf(text, sizeof(text), "%lu-%lu", range->least, range->most);
+   }
+   (void) printf("  %7s", text);
+}
+
+//*****************************************************************************
+// Writes the cost table.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+static void printCosts(void)
+{
+   UINT8 pages;
+   int routine;
+
+   (void) printf("\nHCS12 bus cycles with JSR and RTS, by -Cp page registers\n");
+   (void) printf("%-16s", "routine");
+   for (pages = 1; pages <= PAGESIM_ALL; ++pages)
+   {
+      printPages(pages);
+   }
+   (void) printf("\n");
+
+   for (routine = 0; routine < ROUTINES; ++routine)
+   {
+      (void) printf("%-16s", routineNames[routine]);
+      for (pages = 1; pages <= PAGESIM_ALL; ++pages)
+      {
+         printRange(&costs[pages][routine]);
+      }
+      (void) printf("\n");
+   }
+
+   (void) printf("\nHCS12X bus cycles with JSR and RTS\n");
+   (void) printf("%-24s  %7s  %7s\n", "routine", "", "-MapRAM");
+   (void) printf("%-24s", "_CONV_GLOBAL_TO_LOGICAL");
+   printRange(&conversionCosts[0][0]);
+   printRange(&conversionCosts[1][0]);
+   (void) printf("\n%-24s", "_CONV_LOGICAL_TO_GLOBAL");
+   printRange(&conversionCosts[0][1]);
+   printRange(&conversionCosts[1][1]);
+   (void) printf("\n");
+}
+
+//*****************************************************************************
+// The logical address of the element after one, following the PPAGE window
+// onto the next page.
+//
+// Parameters:
+//    address  The element.
+//    bytes    Its size.
+//
+// Return: The next one.
+//*****************************************************************************
+static UINT32 nextElement(UINT32 address, unsigned int bytes)
+{
+   UINT16 offset = (UINT16)address;
+
+   if (windowOf(offset) == PAGESIM_PPAGE &&
+       (unsigned long)offset + bytes > PAGESIM_PPAGE_HIGH)
+   {
+      return (address & 0xFF0000UL) + 0x010000UL + PAGESIM_PPAGE_LOW +
+             (offset + bytes - PAGESIM_PPAGE_HIGH - 1);
+   }
+   return (address & 0xFF0000UL) | (UINT16)(offset + bytes);
+}
+
+//*****************************************************************************
+// Estimates what one object costs and writes its line.
+//
+// Parameters:
+//    object  The object.
+//    extra   Adds the cycles its accesses cost over near ones: far
+//            routines, cursor, global.
+//
+// Return: 0 if it could be estimated, -1 if not.
+//*****************************************************************************
+static int estimateObject(const LayoutObject* object, double extra[3])
+{
+   PageSim sim;
+   PageSimX simX;
+   UINT32 address = object->address;
+   UINT32 value;
+   unsigned long far = 0;
+   unsigned long pagesCrossed = 0;
+   unsigned long i;
+   double accesses = (double)object->elements * object->accesses;
+   double perAccess[4];
+   double words;
+
+   if (object->bytes < 1 || object->bytes > 4 || object->elements == 0 ||
+       (address >> 16 != 0 && windowOf((UINT16)address) == 0))
+   {
+      return -1;
+   }
+
+   PageSimInit(&sim, PAGESIM_PPAGE, memory);
+   simX.ramhm = 0;
+   simX.cycles = 0;
+
+   // a load and a store of every element, the accesses are taken to be
+   // half of each.
+   for (i = 0; i < object->elements; ++i)
+   {
+      value = 0;
+      switch (object->bytes)
+      {
+      case 1:
+         value = PageSimLoadFar8(&sim, address);
+         PageSimStoreFar8(&sim, address, (UINT8)value);
+         break;
+      case 2:
+         value = PageSimLoadFar16(&sim, address);
+         PageSimStoreFar16(&sim, address, (UINT16)value);
+         break;
+      case 3:
+         value = PageSimLoadFar24(&sim, address);
+         PageSimStoreFar24(&sim, address, value);
+         break;
+      default:
+         value = PageSimLoadFar32(&sim, address);
+         PageSimStoreFar32(&sim, address, value);
+         break;
+      }
+      far += CYCLES_FAR_SETUP * 2;
+      if ((nextElement(address, object->bytes) ^ address) & 0xFF0000UL)
+      {
+         ++pagesCrossed;
+      }
+      address = nextElement(address, object->bytes);
+   }
+   far += sim.cycles;
+
+   // the HCS12X converts the pointer once and sets GPAGE for each access.
+   (void) PageSimXLogicalToGlobal(&simX, object->address);
+
+   words = (double)((object->bytes + 1) / 2);
+   perAccess[0] = CYCLES_NEAR * words;
+   perAccess[1] = (double)far / (2.0 * object->elements);
+   perAccess[3] = CYCLES_GPAGE + CYCLES_GLOBAL * words +
+                  (double)simX.cycles / object->elements;
+
+   (void) printf("%-16s %06lX %6lu %5u %4lu  %5.1f  %5.1f", object->name,
+                 (unsigned long)object->address, object->elements, object->bytes,
+                 object->accesses, perAccess[0], perAccess[1]);
+
+   extra[0] += (perAccess[1] - perAccess[0]) * accesses;
+
+   // the cursor walks words.
+   if (object->bytes == 2)
+   {
+      perAccess[2] = CYCLES_CURSOR + (CYCLES_CURSOR_OPEN +
+                     (double)pagesCrossed * CYCLES_CURSOR_PAGE) / object->elements;
+      extra[1] += (perAccess[2] - perAccess[0]) * accesses;
+      (void) printf("  %6.1f", perAccess[2]);
+   }
+   else
+   {
+      (void) printf("  %6s", "-");
+   }
+
+   extra[2] += (perAccess[3] - perAccess[0]) * accesses;
+   (void) printf("  %6.1f  %8.2f\n", perAccess[3],
+                 (perAccess[1] - perAccess[0]) * accesses * 1000.0 / HAL_BUS_CLOCK_HZ);
+
+   return 0;
+}
+
+//*****************************************************************************
+// Reads a layout and estimates what it costs.
+//
+// Parameters:
+//    name  The layout file, NULL for the firmware's own.
+//
+// Return: 0 if it could all be read, -1 if not.
+//*****************************************************************************
+static int estimateLayout(const char* name)
+{
+   FILE* file = NULL;
+   char line[MAX_LINE];
+   unsigned long lineNumber = 0;
+   LayoutObject object;
+   double extra[3] = { 0, 0, 0 };
+   unsigned int i = 0;
+   int bad = 0;
+   char* hash;
+   unsigned long address;
+
+   if (name != NULL)
+   {
+      file = fopen(name, "r");
+      if (file == NULL)
+      {
+         perror(name);
+         return -1;
+      }
+   }
+
+   (void) printf("\nLayout %s, cycles per access and extra ms over near\n",
+                 name ? name : "of the firmware");
+   (void) printf("%-16s %6s %6s %5s %4s  %5s  %5s  %6s  %6s  %8s\n", "object",
+                 "addr", "elems", "bytes", "acc", "near", "far", "cursor",
+                 "global", "far ms");
+
+   for (;;)
+   {
+      if (file == NULL)
+      {
+         if (i == sizeof(firmwareLayout) / sizeof(firmwareLayout[0]))
+         {
+            break;
+         }
+         object = firmwareLayout[i++];
+      }
+      else
+      {
+         if (fgets(line, sizeof(line), file) == NULL)
+         {
+            break;
+         }
+         ++lineNumber;
+         hash = strchr(line, '#');
+         if (hash != NULL)
+         {
+            *hash = '\0';
+         }
+         if (strspn(line, " \t\r\n") == strlen(line))
+         {
+            continue;
+         }
+         if (sscanf(line, "%23s %lx %lu %u %lu", object.name, &address,
+                    &object.elements, &object.bytes, &object.accesses) != 5 ||
+             address > 0xFFFFFF)
+         {
+            (void) fprintf(stderr, "%s:%lu: not an object\n", name, lineNumber);
+            bad = 1;
+            continue;
+         }
+         object.address = (UINT32)address;
+      }
+
+      if (estimateObject(&object, extra) != 0)
+      {
+         (void) fprintf(stderr, "%s: %s can't be estimated\n",
+                        name ? name : "layout", object.name);
+         bad = 1;
+      }
+   }
+
+   if (file != NULL)
+   {
+      (void) fclose(file);
+   }
+
+   (void) printf("extra ms over near: far routines %.2f, cursor %.2f,"
+                 " global %.2f\n",
+                 extra[0] * 1000.0 / HAL_BUS_CLOCK_HZ,
+                 extra[1] * 1000.0 / HAL_BUS_CLOCK_HZ,
+                 extra[2] * 1000.0 / HAL_BUS_CLOCK_HZ);
+
+   return bad ? -1 : 0;
+}
+
+//*****************************************************************************
+// Entry point.
+//
+// Parameters:
+//    argc, argv  The command line.
+//
+// Return: Exit status, 1 if a check failed or the layout couldn't be read.
+//*****************************************************************************
+int main(int argc, char** argv)
+{
+   const char* layout = NULL;
+   unsigned long physical;
+   unsigned long unmapped[2];
+   UINT8 pages;
+   int status;
+
+   if (argc == 3 && strcmp(argv[1], "--layout") == 0)
+   {
+      layout = argv[2];
+   }
+   else if (argc != 1)
+   {
+      (void) fprintf(stderr, "usage: %s [--layout <file>]\n", argv[0]);
+      return 2;
+   }
+
+   memory = malloc(PAGESIM_MEMORY);
+   if (memory == NULL)
+   {
+      perror(argv[0]);
+      return 1;
+   }
+   for (physical = 0; physical < PAGESIM_MEMORY; ++physical)
+   {
+      memory[physical] = pattern(physical);
+   }
+
+   for (pages = 1; pages <= PAGESIM_ALL; ++pages)
+   {
+      checkHcs12(pages);
+   }
+   (void) printf("HCS12 routines: %u -Cp combinations x %u pages x 65536 offsets\n",
+                 PAGESIM_ALL, (unsigned int)sizeof(checkPages));
+
+   unmapped[0] = checkHcs12x(0);
+   unmapped[1] = checkHcs12x(1);
+   (void) printf("HCS12X conversions: 2 x 16777216 addresses, %lu and %lu global"
+                 " ones with no logical address\n", unmapped[0], unmapped[1]);
+   (void) printf("%lu checks failed\n", failures);
+
+   printCosts();
+   status = estimateLayout(layout);
+
+   free(memory);
+   return (failures != 0 || status != 0) ? 1 : 0;
+}
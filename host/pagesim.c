@@ -0,0 +1,787 @@
+/******************************************************************************
+ * Paged data access model
+ *
+ * Description:
+ *
+ * See pagesim.h. _GET_PAGE_REG and the two conversions are followed
+ * instruction by instruction. The load and store routines all have the
+ * same shape, save the page register, set it, access, restore it, so they
+ * share one model and differ only in their cycle counts, which are listed
+ * per routine below.
+ *
+ *****************************************************************************/
+
+// system includes
+#include <stddef.h>
+
+// project includes
+#include "pagesim.h"
+
+// Definitions
+
+// Bus cycles of the instructions the routines use, from the CPU12 and
+// CPU12X reference manuals.
+#define CY_INHERENT     1   // TFR, EXG, LSLD, LSRD, ROLB, SEC, CLRB, TSTB, ORCC
+#define CY_INHERENT_X   2   // LSLX, LSRX, RORX, prefixed on the CPU12X
+#define CY_IMM8         1   // CMPB #, LDAA #, LDAB #, ORAB #, EORB #
+#define CY_IMM16        2   // CPX #, CPY #, LDX #
+#define CY_IMM16_X      3   // BITX #, ANDX #, SUBX #, prefixed on the CPU12X
+#define CY_BRANCH       3   // Bcc taken
+#define CY_NO_BRANCH    1   // Bcc not taken
+#define CY_LOAD         3   // LDAA 0,X, LDY 0,Y, LDAA ext, LDAB 4,SP
+#define CY_STORE        2   // STAB 0,X, STX 0,Y, STAB 0,SP
+#define CY_STORE_EXT    3   // STAB ext
+#define CY_EOR          3   // EORB 0,SP
+#define CY_LEA          2   // LEAX, LEAS
+#define CY_MUL          3
+#define CY_MOVB         4   // MOVB idx,idx
+#define CY_MOVB_EXT     5   // MOVB idx,ext
+#define CY_MOVW         5   // MOVW idx,idx
+#define CY_PUSH         2
+#define CY_PULL         3
+#define CY_JSR          4
+#define CY_RTS          5
+
+// Cycles of a load or store routine outside _GET_PAGE_REG, the JSR that
+// calls it, its RTS and the BEQ after _GET_PAGE_REG included: the path
+// through a page register, the path for an address no page register
+// controls, and the version built for a single page register.
+typedef struct
+{
+   UINT8 paged;
+   UINT8 unpaged;
+   UINT8 single;
+} RoutineCost;
+
+// _SET_PAGE
+//    PSHX, JSR _GET_PAGE_REG, BEQ, STAB 0,X, PULX, RTS
+//    STAB ext, RTS
+static const RoutineCost setPageCost =
+{
+   CY_JSR + CY_PUSH + CY_NO_BRANCH + CY_STORE + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_BRANCH + CY_PULL + CY_RTS,
+   CY_JSR + CY_STORE_EXT + CY_RTS
+};
+
+// _LOAD_FAR_8, _LOAD_FAR_16
+//    PSHX, JSR _GET_PAGE_REG, BEQ, PSHA, LDAA 0,X, STAB 0,X, LDAB 0,Y
+//    (LDY 0,Y), STAA 0,X, PULA, PULX, RTS
+//    or BEQ, LDAB 0,Y, PULX, RTS
+//    PSHA, LDAA ext, STAB ext, LDAB 0,Y, STAA ext, PULA, RTS
+static const RoutineCost loadFar8Cost =
+{
+   CY_JSR + CY_PUSH + CY_NO_BRANCH + CY_PUSH + CY_LOAD + CY_STORE +
+      CY_LOAD + CY_STORE + CY_PULL + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_BRANCH + CY_LOAD + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_LOAD + CY_STORE_EXT + CY_LOAD + CY_STORE_EXT +
+      CY_PULL + CY_RTS
+};
+
+// _LOAD_FAR_24, the same with LDAB 0,Y and LDY 1,Y.
+static const RoutineCost loadFar24Cost =
+{
+   CY_JSR + CY_PUSH + CY_NO_BRANCH + CY_PUSH + CY_LOAD + CY_STORE +
+      2 * CY_LOAD + CY_STORE + CY_PULL + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_BRANCH + 2 * CY_LOAD + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_LOAD + CY_STORE_EXT + 2 * CY_LOAD + CY_STORE_EXT +
+      CY_PULL + CY_RTS
+};
+
+// _LOAD_FAR_32
+//    PSHX, JSR _GET_PAGE_REG, BEQ, LDAA 0,X, PSHA, STAB 0,X, LDD 2,Y,
+//    LDY 0,Y, MOVB 1,SP+,0,X, PULX, RTS
+//    or BEQ, LDD 2,Y, LDY 0,Y, PULX, RTS
+//    LDAA ext, PSHA, STAB ext, LDD 2,Y, LDY 0,Y, MOVB 1,SP+,ext, RTS
+static const RoutineCost loadFar32Cost =
+{
+   CY_JSR + CY_PUSH + CY_NO_BRANCH + CY_LOAD + CY_PUSH + CY_STORE +
+      2 * CY_LOAD + CY_MOVB + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_BRANCH + 2 * CY_LOAD + CY_PULL + CY_RTS,
+   CY_JSR + CY_LOAD + CY_PUSH + CY_STORE_EXT + 2 * CY_LOAD + CY_MOVB_EXT +
+      CY_RTS
+};
+
+// _STORE_FAR_8
+//    PSHX, JSR _GET_PAGE_REG, BEQ, PSHB, LDAB 0,X, MOVB 0,SP,0,X,
+//    STAA 0,Y, STAB 0,X, PULB, PULX, RTS
+//    or BEQ, STAA 0,Y, PULX, RTS
+//    PSHB, LDAB ext, MOVB 0,SP,ext, STAA 0,Y, STAB ext, PULB, RTS
+static const RoutineCost storeFar8Cost =
+{
+   CY_JSR + CY_PUSH + CY_NO_BRANCH + CY_PUSH + CY_LOAD + CY_MOVB +
+      CY_STORE + CY_STORE + CY_PULL + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_BRANCH + CY_STORE + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_LOAD + CY_MOVB_EXT + CY_STORE + CY_STORE_EXT +
+      CY_PULL + CY_RTS
+};
+
+// _STORE_FAR_16
+//    PSHX, JSR _GET_PAGE_REG, BEQ, PSHA, LDAA 0,X, STAB 0,X,
+//    MOVW 1,SP,0,Y, STAA 0,X, PULA, PULX, RTS
+//    or BEQ, STX 0,Y, PULX, RTS
+//    PSHA, LDAA ext, STAB ext, STX 0,Y, STAA ext, PULA, RTS
+static const RoutineCost storeFar16Cost =
+{
+   CY_JSR + CY_PUSH + CY_NO_BRANCH + CY_PUSH + CY_LOAD + CY_STORE +
+      CY_MOVW + CY_STORE + CY_PULL + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_BRANCH + CY_STORE + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_LOAD + CY_STORE_EXT + CY_STORE + CY_STORE_EXT +
+      CY_PULL + CY_RTS
+};
+
+// _STORE_FAR_24, the same with MOVW 1,SP,1,Y and MOVB 0,SP,0,Y, or STX
+// 1,Y and STAA 0,Y, or MOVB 0,SP,0,Y and STX 1,Y.
+static const RoutineCost storeFar24Cost =
+{
+   CY_JSR + CY_PUSH + CY_NO_BRANCH + CY_PUSH + CY_LOAD + CY_STORE +
+      CY_MOVW + CY_MOVB + CY_STORE + CY_PULL + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_BRANCH + 2 * CY_STORE + CY_PULL + CY_RTS,
+   CY_JSR + CY_PUSH + CY_LOAD + CY_STORE_EXT + CY_MOVB + CY_STORE +
+      CY_STORE_EXT + CY_PULL + CY_RTS
+};
+
+// _STORE_FAR_32, the page is on the stack and the return address is moved
+// up over it on the way out.
+//    PSHX, JSR _GET_PAGE_REG, BEQ, PSHD, LDAA 0,X, MOVB 6,SP,0,X,
+//    MOVW 2,SP,0,Y, MOVW 0,SP,2,Y, STAA 0,X, PULD, BRA, PULX,
+//    MOVW 0,SP,1,+SP, RTS
+//    or BEQ, MOVW 0,SP,0,Y, STD 2,Y, PULX, MOVW 0,SP,1,+SP, RTS
+//    PSHD, LDAA ext, LDAB 4,SP, STAB ext, STX 0,Y, MOVW 0,SP,2,Y,
+//    STAA ext, PULD, MOVW 0,SP,1,+SP, RTS
+static const RoutineCost storeFar32Cost =
+{
+   CY_JSR + CY_PUSH + CY_NO_BRANCH + CY_PUSH + CY_LOAD + CY_MOVB +
+      2 * CY_MOVW + CY_STORE + CY_PULL + CY_BRANCH + CY_PULL + CY_MOVW +
+      CY_RTS,
+   CY_JSR + CY_PUSH + CY_BRANCH + CY_MOVW + CY_STORE + CY_PULL + CY_MOVW +
+      CY_RTS,
+   CY_JSR + CY_PUSH + CY_LOAD + CY_LOAD + CY_STORE_EXT + CY_STORE + CY_MOVW +
+      CY_STORE_EXT + CY_PULL + CY_MOVW + CY_RTS
+};
+
+//*****************************************************************************
+// Charges a conditional branch.
+//
+// Parameters:
+//    cycles  The count to charge.
+//    taken   Whether the branch is taken.
+//
+// Return: taken.
+//*****************************************************************************
+static int branch(unsigned long* cycles, int taken)
+{
+   *cycles += taken ? CY_BRANCH : CY_NO_BRANCH;
+   return taken;
+}
+
+//*****************************************************************************
+// The page registers given with -Cp. With none, datapage.c builds for all
+// of them.
+//
+// Parameters:
+//    sim  The model.
+//
+// Return: PAGESIM_ bits.
+//*****************************************************************************
+static UINT8 configured(const PageSim* sim)
+{
+   return sim->pages ? sim->pages : PAGESIM_ALL;
+}
+
+//*****************************************************************************
+// Whether datapage.c is built with USE_SEVERAL_PAGES, which is when it has
+// to find the page register at run time.
+//
+// Parameters:
+//    sim  The model.
+//
+// Return: Non-zero for more than one page register.
+//*****************************************************************************
+static int several(const PageSim* sim)
+{
+   UINT8 pages = configured(sim);
+
+   return (pages & (pages - 1)) != 0;
+}
+
+//*****************************************************************************
+// A page register.
+//
+// Parameters:
+//    sim  The model.
+//    reg  PAGESIM_ register.
+//
+// Return: The register.
+//*****************************************************************************
+static UINT8* pageRegister(PageSim* sim, UINT8 reg)
+{
+   switch (reg)
+   {
+   case PAGESIM_EPAGE:
+      return &sim->epage;
+   case PAGESIM_DPAGE:
+      return &sim->dpage;
+   default:
+      return &sim->ppage;
+   }
+}
+
+//*****************************************************************************
+// Sets up an HCS12.
+//
+// Parameters:
+//    sim     The model.
+//    pages   PAGESIM_ registers given with -Cp, 0 for none.
+//    memory  PAGESIM_MEMORY bytes.
+//
+// Return: None.
+//*****************************************************************************
+void PageSimInit(PageSim* sim, UINT8 pages, UINT8* memory)
+{
+   sim->pages = pages;
+   sim->epage = 0;
+   sim->dpage = 0;
+   sim->ppage = 0;
+   sim->memory = memory;
+   sim->cycles = 0;
+}
+
+//*****************************************************************************
+// Decodes a logical offset with the page registers as they are.
+//
+// Parameters:
+//    sim     The model.
+//    offset  The offset.
+//
+// Return: Index into the memory.
+//*****************************************************************************
+unsigned long PageSimPhysical(const PageSim* sim, UINT16 offset)
+{
+   if (offset >= PAGESIM_EPAGE_LOW && offset <= PAGESIM_EPAGE_HIGH)
+   {
+      return PAGESIM_EPAGE_MEMORY + sim->epage * 0x400UL +
+             (offset - PAGESIM_EPAGE_LOW);
+   }
+   if (offset >= PAGESIM_DPAGE_LOW && offset <= PAGESIM_DPAGE_HIGH)
+   {
+      return PAGESIM_DPAGE_MEMORY + sim->dpage * 0x1000UL +
+             (offset - PAGESIM_DPAGE_LOW);
+   }
+   if (offset >= PAGESIM_PPAGE_LOW && offset <= PAGESIM_PPAGE_HIGH)
+   {
+      return PAGESIM_PPAGE_MEMORY + sim->ppage * 0x4000UL +
+             (offset - PAGESIM_PPAGE_LOW);
+   }
+   return offset;
+}
+
+//*****************************************************************************
+// L_NOPAGE of _GET_PAGE_REG: ORCC #0x04.
+//
+// Parameters:
+//    sim  The model.
+//
+// Return: 0, no register.
+//*****************************************************************************
+static UINT8 noPage(PageSim* sim)
+{
+   sim->cycles += CY_INHERENT;
+   return 0;
+}
+
+//*****************************************************************************
+// FOUND_ of _GET_PAGE_REG: LDX #register.
+//
+// Parameters:
+//    sim  The model.
+//    reg  PAGESIM_ register.
+//
+// Return: reg.
+//*****************************************************************************
+static UINT8 found(PageSim* sim, UINT8 reg)
+{
+   sim->cycles += CY_IMM16;
+   return reg;
+}
+
+//*****************************************************************************
+// L_EPAGE of _GET_PAGE_REG, both bounds of the EPAGE window.
+//
+// Parameters:
+//    sim     The model.
+//    offset  The offset in Y.
+//
+// Return: PAGESIM_EPAGE or 0.
+//*****************************************************************************
+static UINT8 epageWindow(PageSim* sim, UINT16 offset)
+{
+   sim->cycles += CY_IMM16;                               // CPY #EPAGE_LOW_BOUND
+   if (branch(&sim->cycles, offset < PAGESIM_EPAGE_LOW))  // BLO L_NOPAGE
+   {
+      return noPage(sim);
+   }
+   sim->cycles += CY_IMM16;                               // CPY #EPAGE_HIGH_BOUND
+   if (branch(&sim->cycles, offset > PAGESIM_EPAGE_HIGH)) // BHI L_NOPAGE
+   {
+      return noPage(sim);
+   }
+   return found(sim, PAGESIM_EPAGE);
+}
+
+//*****************************************************************************
+// L_PPAGE of _GET_PAGE_REG, the upper bound of the PPAGE window.
+//
+// Parameters:
+//    sim     The model.
+//    offset  The offset in Y, at least PPAGE_LOW_BOUND.
+//
+// Return: PAGESIM_PPAGE or 0.
+//*****************************************************************************
+static UINT8 ppageWindow(PageSim* sim, UINT16 offset)
+{
+   sim->cycles += CY_IMM16;                               // CPY #PPAGE_HIGH_BOUND
+   if (branch(&sim->cycles, offset > PAGESIM_PPAGE_HIGH)) // BHI L_NOPAGE
+   {
+      return noPage(sim);
+   }
+   return found(sim, PAGESIM_PPAGE);
+}
+
+//*****************************************************************************
+// _GET_PAGE_REG, in the version the -Cp options select.
+//
+// Parameters:
+//    sim     The model.
+//    offset  The offset in Y.
+//
+// Return: PAGESIM_ register, 0 for none.
+//*****************************************************************************
+UINT8 PageSimGetPageReg(PageSim* sim, UINT16 offset)
+{
+   UINT8 pages = configured(sim);
+   UINT8 reg;
+
+   sim->cycles += CY_JSR;
+
+   if (pages & PAGESIM_DPAGE)
+   {
+      sim->cycles += CY_IMM16;                            // CPY #DPAGE_LOW_BOUND
+      if (branch(&sim->cycles, offset < PAGESIM_DPAGE_LOW))
+      {
+         reg = (pages & PAGESIM_EPAGE) ? epageWindow(sim, offset) : noPage(sim);
+      }
+      else
+      {
+         sim->cycles += CY_IMM16;                         // CPY #DPAGE_HIGH_BOUND
+         if (branch(&sim->cycles, offset > PAGESIM_DPAGE_HIGH))
+         {
+            reg = (pages & PAGESIM_PPAGE) ? ppageWindow(sim, offset) : noPage(sim);
+         }
+         else
+         {
+            reg = found(sim, PAGESIM_DPAGE);
+         }
+      }
+   }
+   else if (pages & PAGESIM_PPAGE)
+   {
+      sim->cycles += CY_IMM16;                            // CPY #PPAGE_LOW_BOUND
+      if (branch(&sim->cycles, offset < PAGESIM_PPAGE_LOW))
+      {
+         reg = (pages & PAGESIM_EPAGE) ? epageWindow(sim, offset) : noPage(sim);
+      }
+      else
+      {
+         reg = ppageWindow(sim, offset);
+      }
+   }
+   else
+   {
+      reg = epageWindow(sim, offset);
+   }
+
+   sim->cycles += CY_RTS;
+   return reg;
+}
+
+//*****************************************************************************
+// Picks the page register for an access and charges the routine: through
+// _GET_PAGE_REG with several page registers, the one there is otherwise.
+//
+// Parameters:
+//    sim     The model.
+//    offset  The offset in Y.
+//    cost    The routine's cycles.
+//
+// Return: PAGESIM_ register to set, 0 for none.
+//*****************************************************************************
+static UINT8 enter(PageSim* sim, UINT16 offset, const RoutineCost* cost)
+{
+   UINT8 reg;
+
+   if (!several(sim))
+   {
+      sim->cycles += cost->single;
+      return configured(sim);
+   }
+
+   reg = PageSimGetPageReg(sim, offset);
+   sim->cycles += reg ? cost->paged : cost->unpaged;
+   return reg;
+}
+
+//*****************************************************************************
+// A load or store routine: sets the page register, moves the bytes with it
+// set and puts it back.
+//
+// Parameters:
+//    sim      The model.
+//    address  Page and offset.
+//    size     Bytes, 1 to 4.
+//    store    Non-zero to store value, zero to load.
+//    value    What's stored.
+//    cost     The routine's cycles.
+//
+// Return: What was loaded, or value.
+//*****************************************************************************
+static UINT32 farAccess(PageSim* sim, UINT32 address, UINT8 size, int store,
+                        UINT32 value, const RoutineCost* cost)
+{
+   UINT16 offset = (UINT16)address;
+   UINT8 reg;
+   UINT8* page = NULL;
+   UINT8 saved = 0;
+   UINT32 loaded = 0;
+   UINT8 i;
+   unsigned long physical;
+
+   reg = enter(sim, offset, cost);
+   if (reg)
+   {
+      page = pageRegister(sim, reg);
+      saved = *page;
+      *page = (UINT8)(address >> 16);
+   }
+
+   for (i = 0; i < size; ++i)
+   {
+      physical = PageSimPhysical(sim, (UINT16)(offset + i));
+      if (store)
+      {
+         sim->memory[physical] = (UINT8)(value >> (8 * (size - 1 - i)));
+      }
+      else
+      {
+         loaded = (loaded << 8) | sim->memory[physical];
+      }
+   }
+
+   if (reg)
+   {
+      *page = saved;
+   }
+
+   return store ? value : loaded;
+}
+
+//*****************************************************************************
+// _SET_PAGE: sets the page register for an address and leaves it set.
+//
+// Parameters:
+//    sim      The model.
+//    address  Page and offset.
+//
+// Return: None.
+//*****************************************************************************
+void PageSimSetPage(PageSim* sim, UINT32 address)
+{
+   UINT8 reg;
+
+   reg = enter(sim, (UINT16)address, &setPageCost);
+   if (reg)
+   {
+      *pageRegister(sim, reg) = (UINT8)(address >> 16);
+   }
+}
+
+//*****************************************************************************
+// The load routines.
+//
+// Parameters:
+//    sim      The model.
+//    address  Page and offset.
+//
+// Return: What's there, big endian.
+//*****************************************************************************
+UINT8 PageSimLoadFar8(PageSim* sim, UINT32 address)
+{
+   return (UINT8)farAccess(sim, address, 1, 0, 0, &loadFar8Cost);
+}
+
+UINT16 PageSimLoadFar16(PageSim* sim, UINT32 address)
+{
+   return (UINT16)farAccess(sim, address, 2, 0, 0, &loadFar8Cost);
+}
+
+UINT32 PageSimLoadFar24(PageSim* sim, UINT32 address)
+{
+   return farAccess(sim, address, 3, 0, 0, &loadFar24Cost);
+}
+
+UINT32 PageSimLoadFar32(PageSim* sim, UINT32 address)
+{
+   return farAccess(sim, address, 4, 0, 0, &loadFar32Cost);
+}
+
+//*****************************************************************************
+// The store routines.
+//
+// Parameters:
+//    sim      The model.
+//    address  Page and offset.
+//    value    What to store, big endian.
+//
+// Return: None.
+//*****************************************************************************
+void PageSimStoreFar8(PageSim* sim, UINT32 address, UINT8 value)
+{
+   (void) farAccess(sim, address, 1, 1, value, &storeFar8Cost);
+}
+
+void PageSimStoreFar16(PageSim* sim, UINT32 address, UINT16 value)
+{
+   (void) farAccess(sim, address, 2, 1, value, &storeFar16Cost);
+}
+
+void PageSimStoreFar24(PageSim* sim, UINT32 address, UINT32 value)
+{
+   (void) farAccess(sim, address, 3, 1, value, &storeFar24Cost);
+}
+
+void PageSimStoreFar32(PageSim* sim, UINT32 address, UINT32 value)
+{
+   (void) farAccess(sim, address, 4, 1, value, &storeFar32Cost);
+}
+
+//*****************************************************************************
+// Puts a page and an offset together.
+//
+// Parameters:
+//    page    B.
+//    offset  X.
+//
+// Return: The 24 bit address.
+//*****************************************************************************
+static UINT32 farAddress(UINT8 page, UINT16 offset)
+{
+   return ((UINT32)page << 16) | offset;
+}
+
+//*****************************************************************************
+// _CONV_GLOBAL_TO_LOGICAL.
+//
+// Parameters:
+//    sim     The model.
+//    global  The global address in B:X.
+//
+// Return: The logical address in B:X.
+//*****************************************************************************
+UINT32 PageSimXGlobalToLogical(PageSimX* sim, UINT32 global)
+{
+   unsigned long* cycles = &sim->cycles;
+   UINT8 b = (UINT8)(global >> 16);
+   UINT16 x = (UINT16)global;
+   UINT16 top;
+   int unpaged;
+   int ram;
+
+   *cycles += CY_JSR + CY_IMM8;                           // CMPB #0x40
+   if (!branch(cycles, b < 0x40))                         // BLO Below400000
+   {
+      *cycles += CY_IMM8;                                 // CMPB #0x7F
+      if (!branch(cycles, b != 0x7F))                     // BNE PAGED_FLASH_AREA
+      {
+         if (!sim->ramhm)
+         {
+            *cycles += CY_IMM16_X;                        // BITX #0x4000
+            unpaged = !branch(cycles, (x & 0x4000) == 0); // BEQ PAGED_FLASH_AREA
+         }
+         else
+         {
+            *cycles += CY_IMM16;                          // CPX #0xC000
+            unpaged = !branch(cycles, x < 0xC000);        // BLO PAGED_FLASH_AREA
+         }
+         if (unpaged)
+         {
+            *cycles += CY_INHERENT + CY_RTS;              // CLRB, RTS
+            return x;
+         }
+      }
+
+      // LSLX, ROLB, LSLX, ROLB: the page is bits 14 to 21.
+      *cycles += 2 * CY_INHERENT_X + 2 * CY_INHERENT;
+      b = (UINT8)((b << 2) | (x >> 14));
+      x = (UINT16)(x << 2);
+      // LSRX, SEC, RORX: the offset goes back to 0x8000..0xBFFF.
+      *cycles += 2 * CY_INHERENT_X + CY_INHERENT + CY_RTS;
+      x = (UINT16)(0x8000u | (x >> 2));
+      return farAddress(b, x);
+   }
+
+   *cycles += CY_IMM8;                                    // CMPB #0x10
+   if (!branch(cycles, b < 0x10))                         // BLO Below100000
+   {
+      *cycles += CY_IMM8;                                 // CMPB #0x13
+      if (!branch(cycles, b < 0x13))                      // BLO Below13FC00
+      {
+         *cycles += CY_IMM16;                             // CPX #0xFC00
+         if (!branch(cycles, x < 0xFC00))                 // BLO Below13FC00
+         {
+            *cycles += CY_LEA + CY_INHERENT + CY_RTS;     // LEAX 0x1000,X, CLRB
+            return (UINT16)(x + 0x1000u);
+         }
+      }
+
+      // PSHA, TFR XH,A, EXG A,B, LSRD, LSRD, PULA, ANDX #0x03FF, LEAX.
+      *cycles += CY_PUSH + 4 * CY_INHERENT + CY_PULL + CY_IMM16_X + CY_LEA +
+                 CY_RTS;
+      b = (UINT8)((((UINT16)b << 8) | (x >> 8)) >> 2);
+      return farAddress(b, (UINT16)((x & 0x03FFu) + 0x0800u));
+   }
+
+   *cycles += CY_INHERENT;                                // TSTB
+   ram = branch(cycles, b != 0);                          // BNE RAM_AREA
+   if (!ram)
+   {
+      *cycles += CY_IMM16;                                // CPX #0x1000
+      ram = !branch(cycles, x < 0x1000);                  // BLO Below001000
+   }
+   if (!ram)
+   {
+      *cycles += CY_INHERENT + CY_RTS;                    // CLRB
+      return x;
+   }
+
+   *cycles += CY_IMM8;                                    // CMPB #0x0F
+   if (!branch(cycles, b != 0x0F))                        // BNE PagedRAM_AREA
+   {
+      top = sim->ramhm ? 0xA000u : 0xE000u;
+      *cycles += CY_IMM16;                                // CPX #0xE000
+      if (!branch(cycles, x < top))                       // BLO PagedRAM_AREA
+      {
+         *cycles += CY_IMM16_X + CY_INHERENT + CY_RTS;    // SUBX, CLRB
+         return (UINT16)(x - (top - 0x2000u));
+      }
+   }
+
+   // PSHA, TFR XH,A, EXG A,B, LSRD x4, PULA, ANDX #0x0FFF, LEAX.
+   *cycles += CY_PUSH + 6 * CY_INHERENT + CY_PULL + CY_IMM16_X + CY_LEA +
+              CY_RTS;
+   b = (UINT8)((((UINT16)b << 8) | (x >> 8)) >> 4);
+   return farAddress(b, (UINT16)((x & 0x0FFFu) + 0x1000u));
+}
+
+//*****************************************************************************
+// _CONV_LOGICAL_TO_GLOBAL. The offset is shifted left a bit at a time to
+// find its area, the page is only used in the paged ones.
+//
+// Parameters:
+//    sim      The model.
+//    logical  The logical address in B:X.
+//
+// Return: The global address in B:X.
+//*****************************************************************************
+UINT32 PageSimXLogicalToGlobal(PageSimX* sim, UINT32 logical)
+{
+   unsigned long* cycles = &sim->cycles;
+   UINT8 page = (UINT8)(logical >> 16);
+   UINT16 x = (UINT16)logical;
+   UINT16 product;
+   UINT8 b;
+   UINT8 carry;
+
+   // PSHA, PSHX, PSHB, TFR X,D, LSLD, BCC Below8000
+   *cycles += CY_JSR + 3 * CY_PUSH + 2 * CY_INHERENT;
+   if (!branch(cycles, (x & 0x8000u) == 0))
+   {
+      *cycles += CY_INHERENT;                             // LSLD
+      if (!branch(cycles, (x & 0x4000u) == 0))            // BCC BelowC000
+      {
+         // PULB, LDAB #0x7F, PULX, PULA
+         *cycles += CY_PULL + CY_IMM8 + 2 * CY_PULL + CY_RTS;
+         return farAddress(0x7F, x);
+      }
+
+      // TFR D,X, PULB, SEC, RORB, RORX, LSRB, RORX, LEAS 2,SP, PULA
+      *cycles += CY_INHERENT + CY_PULL + 3 * CY_INHERENT + 2 * CY_INHERENT_X +
+                 CY_LEA + CY_PULL + CY_RTS;
+      x = (UINT16)(x << 2);
+      carry = (UINT8)(page & 1u);
+      b = (UINT8)(0x80u | (page >> 1));
+      x = (UINT16)((carry << 15) | (x >> 1));
+      carry = (UINT8)(b & 1u);
+      b = (UINT8)(b >> 1);
+      x = (UINT16)((carry << 15) | (x >> 1));
+      return farAddress(b, x);
+   }
+
+   *cycles += CY_INHERENT;                                // LSLD
+   if (!branch(cycles, (x & 0x4000u) == 0))               // BCC Below4000
+   {
+      // PULB, PULX, LDAB #0x7F or LEAX and LDAB #0x0F, PULA
+      *cycles += 2 * CY_PULL + CY_IMM8 + CY_PULL + CY_RTS;
+      if (!sim->ramhm)
+      {
+         return farAddress(0x7F, x);
+      }
+      *cycles += CY_LEA;
+      return farAddress(0x0F, (UINT16)(x + (0xC000u - 0x4000u)));
+   }
+
+   *cycles += CY_INHERENT;                                // LSLD
+   if (!branch(cycles, (x & 0x2000u) == 0))               // BCC Below2000
+   {
+      // PULB, PULX, LEAX, LDAB #0x0F, PULA
+      *cycles += 2 * CY_PULL + CY_LEA + CY_IMM8 + CY_PULL + CY_RTS;
+      return farAddress(0x0F, (UINT16)(x + ((sim->ramhm ? 0xA000u : 0xE000u) -
+                                            0x2000u)));
+   }
+
+   *cycles += CY_INHERENT;                                // LSLD
+   if (!branch(cycles, (x & 0x1000u) == 0))               // BCC Below1000
+   {
+      // PULB, LDAA #0x10, MUL, EORB 0,SP, EORB #0x10, STAB 0,SP,
+      // TFR A,B, PULX, PULA
+      *cycles += CY_PULL + CY_IMM8 + CY_MUL + CY_EOR + CY_IMM8 + CY_STORE +
+                 CY_INHERENT + 2 * CY_PULL + CY_RTS;
+      product = (UINT16)(page * 0x10u);
+      x = (UINT16)(((((product & 0xFFu) ^ (x >> 8) ^ 0x10u) & 0xFFu) << 8) |
+                   (x & 0xFFu));
+      return farAddress((UINT8)(product >> 8), x);
+   }
+
+   *cycles += CY_INHERENT;                                // LSLD
+   if (branch(cycles, (x & 0x0800u) == 0))                // BCC Below0800
+   {
+      // PULB, PULX, PULA, CLRB
+      *cycles += 3 * CY_PULL + CY_INHERENT + CY_RTS;
+      return x;
+   }
+
+   *cycles += CY_INHERENT;                                // LSLD
+   if (!branch(cycles, (x & 0x0400u) == 0))               // BCC Below0C00
+   {
+      // PULB, LDAB #0x13, PULX, LEAX 0xF000,X, PULA
+      *cycles += CY_PULL + CY_IMM8 + CY_PULL + CY_LEA + CY_PULL + CY_RTS;
+      return farAddress(0x13, (UINT16)(x + 0xF000u));
+   }
+
+   // PULB, LDAA #0x04, MUL, EORB 0,SP, EORB #0x08, STAB 0,SP, TFR A,B,
+   // ORAB #0x10, PULX, PULA
+   *cycles += CY_PULL + CY_IMM8 + CY_MUL + CY_EOR + CY_IMM8 + CY_STORE +
+              CY_INHERENT + CY_IMM8 + 2 * CY_PULL + CY_RTS;
+   product = (UINT16)(page * 0x04u);
+   x = (UINT16)(((((product & 0xFFu) ^ (x >> 8) ^ 0x08u) & 0xFFu) << 8) |
+                (x & 0xFFu));
+   return farAddress((UINT8)((product >> 8) | 0x10u), x);
+}
@@ -0,0 +1,104 @@
+/******************************************************************************
+ * Paged data access model
+ *
+ * Description:
+ *
+ * A C model of the runtime routines in datapage.c, so what they do to an
+ * address and what they cost can be checked on the host:
+ *
+ *    HCS12   _GET_PAGE_REG, _SET_PAGE, _LOAD_FAR_8/16/24/32 and
+ *            _STORE_FAR_8/16/24/32, for every combination of the -Cp
+ *            page registers, working on a model of the logical memory
+ *            behind the EPAGE, DPAGE and PPAGE windows
+ *    HCS12X  _CONV_GLOBAL_TO_LOGICAL and _CONV_LOGICAL_TO_GLOBAL, with
+ *            and without the HCS12XE RAM mapping (-MapRAM)
+ *
+ * Each model follows its routine branch for branch, so the same inputs
+ * take the same path, and charges the bus cycles of every instruction on
+ * the path, the JSR that calls the routine and its RTS included. The cycle
+ * counts are from the instruction tables of the CPU12 and CPU12X reference
+ * manuals and have not been measured on silicon.
+ *
+ * A far address is the page in bits 16 to 23 and the offset in bits 0 to
+ * 15, as the routines get them in B and Y (or X).
+ *
+ *****************************************************************************/
+
+#ifndef PAGESIM_H
+#define PAGESIM_H
+
+#include "types.h"
+
+// The HCS12 page registers, as bits for the -Cp options.
+#define PAGESIM_EPAGE 0x01
+#define PAGESIM_DPAGE 0x02
+#define PAGESIM_PPAGE 0x04
+#define PAGESIM_ALL   (PAGESIM_EPAGE | PAGESIM_DPAGE | PAGESIM_PPAGE)
+
+// The windows, as datapage.c has them.
+#define PAGESIM_EPAGE_LOW   0x0400u
+#define PAGESIM_EPAGE_HIGH  0x07FFu
+#define PAGESIM_DPAGE_LOW   0x7000u
+#define PAGESIM_DPAGE_HIGH  0x7FFFu
+#define PAGESIM_PPAGE_LOW   0x8000u
+#define PAGESIM_PPAGE_HIGH  0xBFFFu
+
+// Memory behind the HCS12 logical addresses: the 64K that isn't paged,
+// then all 256 pages of each window in turn.
+#define PAGESIM_EPAGE_MEMORY  0x010000UL
+#define PAGESIM_DPAGE_MEMORY  0x050000UL
+#define PAGESIM_PPAGE_MEMORY  0x150000UL
+#define PAGESIM_MEMORY        0x550000UL
+
+typedef struct
+{
+   // Configuration.
+   UINT8 pages;               // PAGESIM_ registers given with -Cp, 0 for none
+
+   // State.
+   UINT8 epage;
+   UINT8 dpage;
+   UINT8 ppage;
+   UINT8* memory;             // PAGESIM_MEMORY bytes
+
+   // Statistics.
+   unsigned long cycles;      // bus cycles the routines have taken
+} PageSim;
+
+typedef struct
+{
+   // Configuration.
+   UINT8 ramhm;               // HCS12XE RAM mapping, compiled with -MapRAM
+
+   // Statistics.
+   unsigned long cycles;
+} PageSimX;
+
+// Sets up an HCS12 with the page registers at 0. The memory is the
+// caller's.
+void PageSimInit(PageSim* sim, UINT8 pages, UINT8* memory);
+
+// Where in the memory a logical offset is with the page registers as they
+// are, the way the hardware decodes it.
+unsigned long PageSimPhysical(const PageSim* sim, UINT16 offset);
+
+// The register _GET_PAGE_REG picks for an offset, 0 for none. Only used
+// when more than one register is given, or none.
+UINT8 PageSimGetPageReg(PageSim* sim, UINT16 offset);
+
+// The routines. Values are big endian in memory, as on the target.
+void PageSimSetPage(PageSim* sim, UINT32 address);
+UINT8 PageSimLoadFar8(PageSim* sim, UINT32 address);
+UINT16 PageSimLoadFar16(PageSim* sim, UINT32 address);
+UINT32 PageSimLoadFar24(PageSim* sim, UINT32 address);
+UINT32 PageSimLoadFar32(PageSim* sim, UINT32 address);
+void PageSimStoreFar8(PageSim* sim, UINT32 address, UINT8 value);
+void PageSimStoreFar16(PageSim* sim, UINT32 address, UINT16 value);
+void PageSimStoreFar24(PageSim* sim, UINT32 address, UINT32 value);
+void PageSimStoreFar32(PageSim* sim, UINT32 address, UINT32 value);
+
+// The HCS12X conversions, one 24 bit address to the other.
+UINT32 PageSimXGlobalToLogical(PageSimX* sim, UINT32 global);
+UINT32 PageSimXLogicalToGlobal(PageSimX* sim, UINT32 logical);
+
+#endif // PAGESIM_H
@@ -0,0 +1,1738 @@
+/******************************************************************************
+ * Code placement report
+ *
+ * Description:
+ *
+ * Reads the firmware sources the way the target compiler sees them and
+ * checks the placement scheme of hal.h: everything the capture, the binning
+ * and the output run through has to be near and in non-banked flash, and
+ * has to keep to near calls and near data while it runs.
+ *
+ *    placement [-D<name> ...] file.c ...
+ *
+ * The segments are followed through the CODE_SEG, DATA_SEG, push and pop
+ * pragmas, in the sources and in the local headers they include, so
+ * hal_isr_begin.h, hal_hot_begin.h and hal_cold_begin.h are seen for what
+ * they do. #ifdef and #ifndef are evaluated with HAL_HOST undefined and
+ * the -D names defined, the way the target build would have them.
+ *
+ * Every function is listed with its segment. For a hot one, a function in
+ * a near segment, each call site and variable reference in its body is
+ * counted, with the macros it uses expanded:
+ *
+ *    NEAR      calls of near functions, JSR/RTS, and of the runtime
+ *              routines the compiler calls for the 32 bit *, / and %, and
+ *              for shifting a 32 bit value by a variable count. non_bank.sgm
+ *              keeps those in NON_BANKED, the way datapage.c has them. An
+ *              operand is 32 bit when it has a long variable or a cast to a
+ *              long type in it. A 32 bit field or a macro that stands for one
+ *              isn't seen.
+ *    FAR       calls of functions that are banked, or near but declared
+ *              without the pragma, which the compiler makes CALL/RTC
+ *    LIBRARY   calls of functions that aren't in the sources, like memset.
+ *              The banked model links the banked ANSI library, which is
+ *              called with CALL.
+ *    FAR DATA  references to variables in a far data segment or declared
+ *              __far, and __far pointers, each a trip through datapage.c
+ *
+ * Exit status 1 when a hot function makes a far or library call or touches
+ * far data, or when any function is declared in another kind of segment
+ * than it is defined in, since its callers would call it the wrong way.
+ *
+ *****************************************************************************/
+
+// system includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// Definitions
+
+#define MAX_NAME      64
+#define MAX_PATH      256
+#define MAX_DEFINES   256
+#define MAX_STACK     16
+#define MAX_INCLUDE   16
+#define MAX_EXPAND    16
+#define MAX_PARAMS    8
+
+// A segment as far as the calls and the data accesses go.
+typedef struct
+{
+   char name[MAX_NAME];       // segment name, DEFAULT for the default
+   int near;                  // __NEAR_SEG or __SHORT_SEG, JSR/RTS
+   int banked;                // not NON_BANKED
+} Segment;
+
+// What a pragma push saves.
+typedef struct
+{
+   Segment code;
+   int farData;
+} Placement;
+
+// A preprocessing token, or a whole directive line.
+typedef struct
+{
+   char* text;
+   int line;
+   int directive;
+} Token;
+
+typedef struct
+{
+   Token* tokens;
+   int count;
+   int size;
+} TokenList;
+
+// What a hot function's body refers to. Resolved once all files are read.
+typedef struct
+{
+   char name[MAX_NAME];
+   int line;
+   int call;                  // followed by (
+   int farPointer;            // a __far in the body
+   int runtime;               // 32 bit arithmetic the runtime does
+} Reference;
+
+typedef struct
+{
+   char name[MAX_NAME];
+   char file[MAX_PATH];
+   int unit;                  // translation unit it's defined in, in order
+   int line;
+   int defined;
+   int isr;                   // defined through a macro with interrupt in it
+   Segment segment;           // where it's defined
+   int declaredNear;          // 1 or 0 as declared, -1 while undeclared
+   int declarationConflict;   // declared both near and far
+   char declarationFile[MAX_PATH];
+   int declarationLine;       // a declaration that disagrees
+   Reference* references;
+   int referenceCount;
+   char (*wideNames)[MAX_NAME];  // long parameters and locals
+   int wideCount;
+} Function;
+
+typedef struct
+{
+   char name[MAX_NAME];
+   int farData;
+   int wide;                  // long
+} Variable;
+
+// A typedef name, so a cast to it is seen for one.
+typedef struct
+{
+   char name[MAX_NAME];
+   int wide;                  // long
+} TypeName;
+
+typedef struct
+{
+   char name[MAX_NAME];
+   int functionLike;
+   char params[MAX_PARAMS][MAX_NAME];
+   int paramCount;
+   TokenList body;
+} Macro;
+
+// Everything that's been read.
+static Function* functions = NULL;
+static int functionCount = 0;
+static Variable* variables = NULL;
+static int variableCount = 0;
+static TypeName* typeNames = NULL;
+static int typeNameCount = 0;
+
+// The translation unit being read.
+static Macro* macros = NULL;
+static int macroCount = 0;
+static char defines[MAX_DEFINES][MAX_NAME];
+static int defineCount = 0;
+static Placement current;
+static Placement stack[MAX_STACK];
+static int stackDepth = 0;
+static int includeDepth = 0;
+static int unit = 0;
+
+// The -D names, defined at the start of every translation unit.
+static char* commandDefines[MAX_DEFINES];
+static int commandDefineCount = 0;
+
+static int problems = 0;
+
+static const char* const keywords[] =
+{
+   "if", "else", "while", "for", "do", "switch", "case", "default", "return",
+   "break", "continue", "goto", "sizeof", "void", "char", "short", "int",
+   "long", "signed", "unsigned", "float", "double", "const", "volatile",
+   "static", "extern", "struct", "union", "enum", "typedef", "register",
+   "auto", "interrupt", "__far", "__near", "asm", "__asm", NULL
+};
+
+//*****************************************************************************
+// Allocates or gives up.
+//
+// Parameters:
+//    pointer  What to grow, NULL for a new block.
+//    size     Bytes wanted.
+//
+// Return: The block.
+//*****************************************************************************
+static void* grow(void* pointer, size_t size)
+{
+   pointer = realloc(pointer, size);
+   if (pointer == NULL)
+   {
+      (void) fprintf(stderr, "placement: out of memory\n");
+      exit(2);
+   }
+   return pointer;
+}
+
+//*****************************************************************************
+// Copies a name, cut short if it has to be.
+//
+// Parameters:
+//    to    Destination, MAX_NAME bytes.
+//    from  The name.
+//
+// Return: None.
+//*****************************************************************************
+static void copyName(char* to, const char* from)
+{
+   (void) snprintf(to, MAX_NAME, "%s", from);
+}
+
+static int isIdentifier(const char* text)
+{
+   return isalpha((unsigned char)text[0]) || text[0] == '_';
+}
+
+static int isKeyword(const char* text)
+{
+   int i;
+
+   for (i = 0; keywords[i] != NULL; ++i)
+   {
+      if (strcmp(text, keywords[i]) == 0)
+      {
+         return 1;
+      }
+   }
+   return 0;
+}
+
+//*****************************************************************************
+// Adds a token to a list.
+//
+// Parameters:
+//    list       The list.
+//    text       The token, copied.
+//    line       Line it's on.
+//    directive  Non-zero for a directive line.
+//
+// Return: None.
+//*****************************************************************************
+static void addToken(TokenList* list, const char* text, int line, int directive)
+{
+   if (list->count == list->size)
+   {
+      list->size = list->size ? list->size * 2 : 256;
+      list->tokens = grow(list->tokens, list->size * sizeof(Token));
+   }
+   list->tokens[list->count].text = grow(NULL, strlen(text) + 1);
+   strcpy(list->tokens[list->count].text, text);
+   list->tokens[list->count].line = line;
+   list->tokens[list->count].directive = directive;
+   ++list->count;
+}
+
+static void freeTokens(TokenList* list)
+{
+   int i;
+
+   for (i = 0; i < list->count; ++i)
+   {
+      free(list->tokens[i].text);
+   }
+   free(list->tokens);
+   memset(list, 0, sizeof(*list));
+}
+
+//*****************************************************************************
+// Splits C source into tokens. Comments go, string and character literals
+// and numbers become a single placeholder token, and a directive becomes
+// one token holding the line without its #, continuations joined.
+//
+// Parameters:
+//    text  The source.
+//    list  Where the tokens go.
+//
+// Return: None.
+//*****************************************************************************
+static void tokenize(const char* text, TokenList* list)
+{
+   const char* p = text;
+   int line = 1;
+   int lineStart = 1;
+   char buffer[1024];
+   size_t length;
+   char quote;
+
+   while (*p != '\0')
+   {
+      if (*p == '\n')
+      {
+         ++line;
+         lineStart = 1;
+         ++p;
+      }
+      else if (isspace((unsigned char)*p))
+      {
+         ++p;
+      }
+      else if (p[0] == '/' && p[1] == '/')
+      {
+         while (*p != '\0' && *p != '\n')
+         {
+            ++p;
+         }
+      }
+      else if (p[0] == '/' && p[1] == '*')
+      {
+         for (p += 2; *p != '\0' && !(p[0] == '*' && p[1] == '/'); ++p)
+         {
+            line += (*p == '\n');
+         }
+         p += (*p != '\0') ? 2 : 0;
+      }
+      else if (*p == '#' && lineStart)
+      {
+         int start = line;
+
+         length = 0;
+         for (++p; *p != '\0' && *p != '\n'; ++p)
+         {
+            if (p[0] == '\\' && p[1] == '\n')
+            {
+               ++p;
+               ++line;
+               continue;
+            }
+            if (p[0] == '/' && p[1] == '/')
+            {
+               while (*p != '\0' && *p != '\n')
+               {
+                  ++p;
+               }
+               break;
+            }
+            if (p[0] == '/' && p[1] == '*')
+            {
+               for (p += 2; *p != '\0' && !(p[0] == '*' && p[1] == '/'); ++p)
+               {
+                  line += (*p == '\n');
+               }
+               if (*p == '\0')
+               {
+                  break;
+               }
+               ++p;
+               continue;
+            }
+            if (length < sizeof(buffer) - 1)
+            {
+               buffer[length++] = *p;
+            }
+         }
+         buffer[length] = '\0';
+         addToken(list, buffer, start, 1);
+      }
+      else
+      {
+         lineStart = 0;
+         if (isIdentifier(p))
+         {
+            length = 0;
+            while (isalnum((unsigned char)*p) || *p == '_')
+            {
+               if (length < MAX_NAME - 1)
+               {
+                  buffer[length++] = *p;
+               }
+               ++p;
+            }
+            buffer[length] = '\0';
+            addToken(list, buffer, line, 0);
+         }
+         else if (isdigit((unsigned char)*p))
+         {
+            while (isalnum((unsigned char)*p) || *p == '.')
+            {
+               ++p;
+            }
+            addToken(list, "0", line, 0);
+         }
+         else if (*p == '"' || *p == '\'')
+         {
+            quote = *p++;
+            while (*p != '\0' && *p != quote && *p != '\n')
+            {
+               p += (p[0] == '\\' && p[1] != '\0') ? 2 : 1;
+            }
+            p += (*p == quote);
+            addToken(list, "\"", line, 0);
+         }
+         else if (p[0] == '-' && p[1] == '>')
+         {
+            addToken(list, "->", line, 0);
+            p += 2;
+         }
+         else
+         {
+            buffer[0] = *p++;
+            buffer[1] = '\0';
+            addToken(list, buffer, line, 0);
+         }
+      }
+   }
+}
+
+//*****************************************************************************
+// Reads a whole file.
+//
+// Parameters:
+//    path  The file.
+//
+// Return: Its text, NULL if it can't be read.
+//*****************************************************************************
+static char* readFile(const char* path)
+{
+   FILE* file = fopen(path, "rb");
+   char* text;
+   long size;
+
+   if (file == NULL)
+   {
+      return NULL;
+   }
+   (void) fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   (void) fseek(file, 0, SEEK_SET);
+   text = grow(NULL, (size_t)size + 1);
+   size = (long)fread(text, 1, (size_t)size, file);
+   text[size] = '\0';
+   (void) fclose(file);
+   return text;
+}
+
+//*****************************************************************************
+// The preprocessor's view of the names.
+//*****************************************************************************
+static int isDefined(const char* name)
+{
+   int i;
+
+   for (i = 0; i < defineCount; ++i)
+   {
+      if (strcmp(defines[i], name) == 0)
+      {
+         return 1;
+      }
+   }
+   return 0;
+}
+
+static void define(const char* name)
+{
+   if (!isDefined(name) && defineCount < MAX_DEFINES)
+   {
+      copyName(defines[defineCount++], name);
+   }
+}
+
+static void undefine(const char* name)
+{
+   int i;
+
+   for (i = 0; i < defineCount; ++i)
+   {
+      if (strcmp(defines[i], name) == 0)
+      {
+         strcpy(defines[i], defines[--defineCount]);
+         return;
+      }
+   }
+}
+
+static Macro* findMacro(const char* name)
+{
+   int i;
+
+   for (i = 0; i < macroCount; ++i)
+   {
+      if (strcmp(macros[i].name, name) == 0)
+      {
+         return &macros[i];
+      }
+   }
+   return NULL;
+}
+
+//*****************************************************************************
+// Records a #define, the text after the word define.
+//
+// Parameters:
+//    text  Name, parameters and body.
+//
+// Return: None.
+//*****************************************************************************
+static void recordMacro(const char* text)
+{
+   char name[MAX_NAME];
+   Macro* macro;
+   const char* p = text;
+   size_t length = 0;
+
+   while (isspace((unsigned char)*p))
+   {
+      ++p;
+   }
+   while ((isalnum((unsigned char)*p) || *p == '_') && length < MAX_NAME - 1)
+   {
+      name[length++] = *p++;
+   }
+   name[length] = '\0';
+   if (length == 0)
+   {
+      return;
+   }
+   define(name);
+
+   macro = findMacro(name);
+   if (macro == NULL)
+   {
+      macros = grow(macros, (macroCount + 1) * sizeof(Macro));
+      macro = &macros[macroCount++];
+      memset(macro, 0, sizeof(*macro));
+      copyName(macro->name, name);
+   }
+   else
+   {
+      freeTokens(&macro->body);
+      macro->paramCount = 0;
+   }
+
+   // only a ( straight after the name makes it function-like.
+   macro->functionLike = (*p == '(');
+   if (macro->functionLike)
+   {
+      ++p;
+      while (*p != '\0' && *p != ')')
+      {
+         while (isspace((unsigned char)*p) || *p == ',')
+         {
+            ++p;
+         }
+         length = 0;
+         while ((isalnum((unsigned char)*p) || *p == '_') && length < MAX_NAME - 1)
+         {
+            name[length++] = *p++;
+         }
+         name[length] = '\0';
+         if (length > 0 && macro->paramCount < MAX_PARAMS)
+         {
+            copyName(macro->params[macro->paramCount++], name);
+         }
+         if (length == 0 && *p != ')' && *p != '\0')
+         {
+            ++p;    // ... and anything else
+         }
+      }
+      p += (*p == ')');
+   }
+   tokenize(p, &macro->body);
+}
+
+//*****************************************************************************
+// Works out a segment from the words of a CODE_SEG or DATA_SEG pragma.
+//
+// Parameters:
+//    text     What follows CODE_SEG or DATA_SEG.
+//    segment  The segment.
+//
+// Return: Non-zero if a far data qualifier was among the words.
+//*****************************************************************************
+static int parseSegment(const char* text, Segment* segment)
+{
+   char word[MAX_NAME];
+   int farData = 0;
+   int offset;
+
+   memset(segment, 0, sizeof(*segment));
+   copyName(segment->name, "DEFAULT");
+
+   while (sscanf(text, "%63s%n", word, &offset) == 1)
+   {
+      text += offset;
+      if (strcmp(word, "__NEAR_SEG") == 0 || strcmp(word, "__SHORT_SEG") == 0)
+      {
+         segment->near = 1;
+      }
+      else if (strcmp(word, "__FAR_SEG") == 0 || strcmp(word, "__PPAGE_SEG") == 0 ||
+               strcmp(word, "__EPAGE_SEG") == 0 || strcmp(word, "__RPAGE_SEG") == 0 ||
+               strcmp(word, "__GPAGE_SEG") == 0 || strcmp(word, "__DPAGE_SEG") == 0)
+      {
+         farData = 1;
+      }
+      else if (word[0] != '_')
+      {
+         copyName(segment->name, word);
+      }
+   }
+
+   segment->banked = strcmp(segment->name, "NON_BANKED") != 0;
+   return farData;
+}
+
+static void parseFile(const char* path);
+
+//*****************************************************************************
+// Acts on a directive in a live part of the source.
+//
+// Parameters:
+//    text  The directive without its #.
+//    path  File it's in, for the includes.
+//
+// Return: None.
+//*****************************************************************************
+static void directive(const char* text, const char* path)
+{
+   char word[MAX_NAME];
+   char name[MAX_PATH];
+   char include[2 * MAX_PATH];
+   Segment segment;
+   const char* slash;
+   int offset;
+
+   if (sscanf(text, " %63s%n", word, &offset) != 1)
+   {
+      return;
+   }
+   text += offset;
+
+   if (strcmp(word, "define") == 0)
+   {
+      recordMacro(text);
+   }
+   else if (strcmp(word, "undef") == 0 && sscanf(text, " %63s", word) == 1)
+   {
+      undefine(word);
+   }
+   else if (strcmp(word, "include") == 0 && sscanf(text, " \"%255[^\"]\"", name) == 1)
+   {
+      // local headers are looked for next to the file including them.
+      slash = strrchr(path, '/');
+      (void) snprintf(include, sizeof(include), "%.*s%s",
+                      slash ? (int)(slash - path + 1) : 0, path, name);
+      if (includeDepth < MAX_INCLUDE)
+      {
+         ++includeDepth;
+         parseFile(include);
+         --includeDepth;
+      }
+   }
+   else if (strcmp(word, "pragma") == 0 && sscanf(text, " %63s%n", word, &offset) == 1)
+   {
+      text += offset;
+      if (strcmp(word, "push") == 0 && stackDepth < MAX_STACK)
+      {
+         stack[stackDepth++] = current;
+      }
+      else if (strcmp(word, "pop") == 0 && stackDepth > 0)
+      {
+         current = stack[--stackDepth];
+      }
+      else if (strcmp(word, "CODE_SEG") == 0)
+      {
+         (void) parseSegment(text, &current.code);
+      }
+      else if (strcmp(word, "DATA_SEG") == 0)
+      {
+         current.farData = parseSegment(text, &segment);
+      }
+   }
+}
+
+//*****************************************************************************
+// Evaluates the condition of a conditional directive.
+//
+// Parameters:
+//    text  The directive without its #.
+//
+// Return: 1 for true, 0 for false, -1 if it isn't a condition.
+//*****************************************************************************
+static int condition(const char* text)
+{
+   char word[MAX_NAME];
+   char name[MAX_NAME];
+   int offset;
+
+   if (sscanf(text, " %63s%n", word, &offset) != 1)
+   {
+      return -1;
+   }
+   text += offset;
+
+   if (strcmp(word, "ifdef") == 0 && sscanf(text, " %63s", name) == 1)
+   {
+      return isDefined(name);
+   }
+   if (strcmp(word, "ifndef") == 0 && sscanf(text, " %63s", name) == 1)
+   {
+      return !isDefined(name);
+   }
+   if (strcmp(word, "if") == 0 || strcmp(word, "elif") == 0)
+   {
+      if (sscanf(text, " defined ( %63[A-Za-z0-9_] )", name) == 1 ||
+          sscanf(text, " defined %63[A-Za-z0-9_]", name) == 1)
+      {
+         return isDefined(name);
+      }
+      if (sscanf(text, " ! defined ( %63[A-Za-z0-9_] )", name) == 1 ||
+          sscanf(text, " !defined ( %63[A-Za-z0-9_] )", name) == 1)
+      {
+         return !isDefined(name);
+      }
+      return atoi(text) != 0;
+   }
+   return -1;
+}
+
+//*****************************************************************************
+// Looks a function up, adding it if it's new.
+//
+// Parameters:
+//    name  The function.
+//
+// Return: Its entry.
+//*****************************************************************************
+static Function* findFunction(const char* name)
+{
+   Function* function;
+   int i;
+
+   for (i = 0; i < functionCount; ++i)
+   {
+      if (strcmp(functions[i].name, name) == 0)
+      {
+         return &functions[i];
+      }
+   }
+
+   functions = grow(functions, (functionCount + 1) * sizeof(Function));
+   function = &functions[functionCount++];
+   memset(function, 0, sizeof(*function));
+   copyName(function->name, name);
+   function->declaredNear = -1;
+   return function;
+}
+
+static Function* lookupFunction(const char* name)
+{
+   int i;
+
+   for (i = 0; i < functionCount; ++i)
+   {
+      if (strcmp(functions[i].name, name) == 0)
+      {
+         return &functions[i];
+      }
+   }
+   return NULL;
+}
+
+static Variable* lookupVariable(const char* name)
+{
+   int i;
+
+   for (i = 0; i < variableCount; ++i)
+   {
+      if (strcmp(variables[i].name, name) == 0)
+      {
+         return &variables[i];
+      }
+   }
+   return NULL;
+}
+
+static TypeName* lookupTypeName(const char* name)
+{
+   int i;
+
+   for (i = 0; i < typeNameCount; ++i)
+   {
+      if (strcmp(typeNames[i].name, name) == 0)
+      {
+         return &typeNames[i];
+      }
+   }
+   return NULL;
+}
+
+static int isLongType(const char* text)
+{
+   const TypeName* type = lookupTypeName(text);
+
+   return strcmp(text, "long") == 0 || (type != NULL && type->wide);
+}
+
+static int isTypeWord(const char* text)
+{
+   return isKeyword(text) || lookupTypeName(text) != NULL || strcmp(text, "*") == 0;
+}
+
+static void addWideName(Function* function, const char* name)
+{
+   function->wideNames = grow(function->wideNames,
+                              (function->wideCount + 1) * sizeof(*function->wideNames));
+   copyName(function->wideNames[function->wideCount++], name);
+}
+
+//*****************************************************************************
+// Tells whether a name in a function's body is a long variable, one of its
+// own or a global one.
+//
+// Parameters:
+//    function  The function.
+//    name      The name.
+//
+// Return: 1 if it is.
+//*****************************************************************************
+static int isWideName(const Function* function, const char* name)
+{
+   const Variable* variable;
+   int i;
+
+   for (i = 0; i < function->wideCount; ++i)
+   {
+      if (strcmp(function->wideNames[i], name) == 0)
+      {
+         return 1;
+      }
+   }
+   variable = lookupVariable(name);
+   return variable != NULL && variable->wide;
+}
+
+//*****************************************************************************
+// Tells what one operand of an arithmetic operator is. It is 32 bit when it
+// has a long variable in it, or a cast to a long type along with a variable
+// or a call, so the compiler can't work it out beforehand. What a sizeof
+// takes is a constant.
+//
+// Parameters:
+//    function  The function.
+//    tokens    The operand, the casts in front of it included.
+//    count     How many.
+//    variable  Set to 1 if it isn't a constant.
+//
+// Return: 1 if it is 32 bit.
+//*****************************************************************************
+static int isWideOperand(const Function* function, const Token* tokens, int count,
+                         int* variable)
+{
+   const char* text;
+   int longType = 0;
+   int wide = 0;
+   int depth;
+   int i;
+
+   *variable = 0;
+   for (i = 0; i < count; ++i)
+   {
+      text = tokens[i].text;
+      if (strcmp(text, "sizeof") == 0)
+      {
+         depth = 0;
+         do
+         {
+            ++i;
+            depth += (i < count && strcmp(tokens[i].text, "(") == 0);
+            depth -= (i < count && strcmp(tokens[i].text, ")") == 0);
+         } while (i < count && depth > 0);
+         continue;
+      }
+      if (i > 0 && (strcmp(tokens[i - 1].text, ".") == 0 ||
+                    strcmp(tokens[i - 1].text, "->") == 0))
+      {
+         continue;
+      }
+      if (isLongType(text))
+      {
+         longType = 1;
+      }
+      else if (isIdentifier(text) && !isTypeWord(text) && findMacro(text) == NULL)
+      {
+         wide |= isWideName(function, text);
+         *variable = 1;
+      }
+   }
+   return wide || (longType && *variable);
+}
+
+//*****************************************************************************
+// Tells whether the operator at a token is one the compiler does with a
+// runtime routine: a *, / or % with a 32 bit operand, or a << or >> of a 32
+// bit value by a variable count. The operands run out to the nearest
+// operator that binds less tightly, or to a bracket that isn't theirs.
+//
+// Parameters:
+//    function  The function.
+//    tokens    The tokens the operator is in.
+//    count     How many.
+//    at        The operator, the first < or > of a shift.
+//
+// Return: 1 if it is.
+//*****************************************************************************
+static int isRuntimeOperation(const Function* function, const Token* tokens, int count,
+                              int at)
+{
+   const char* text = tokens[at].text;
+   const char* stops;
+   int shift = (text[0] == '<' || text[0] == '>');
+   int leftVariable;
+   int rightVariable;
+   int left;
+   int right;
+   int depth = 0;
+   int start;
+   int end;
+
+   // a shift takes in the + and - on either side of it.
+   stops = shift ? ",;=<>&|^?:{}" : ",;=+-<>&|^?:{}";
+
+   for (start = at; start > 0; --start)
+   {
+      text = tokens[start - 1].text;
+      if (strcmp(text, ")") == 0 || strcmp(text, "]") == 0)
+      {
+         ++depth;
+      }
+      else if (strcmp(text, "(") == 0 || strcmp(text, "[") == 0)
+      {
+         if (depth-- == 0)
+         {
+            break;
+         }
+      }
+      else if (depth == 0 && text[1] == '\0' && strchr(stops, text[0]) != NULL)
+      {
+         break;
+      }
+   }
+
+   // past the = of a compound assignment.
+   end = at + 1 + shift;
+   end += (end < count && strcmp(tokens[end].text, "=") == 0);
+   right = end;
+   for (depth = 0; end < count; ++end)
+   {
+      text = tokens[end].text;
+      if (strcmp(text, "(") == 0 || strcmp(text, "[") == 0)
+      {
+         ++depth;
+      }
+      else if (strcmp(text, ")") == 0 || strcmp(text, "]") == 0)
+      {
+         if (depth-- == 0)
+         {
+            break;
+         }
+      }
+      else if (depth == 0 && text[1] == '\0' && strchr(stops, text[0]) != NULL)
+      {
+         break;
+      }
+      else if (depth == 0 && !shift &&
+               (strcmp(text, "*") == 0 || strcmp(text, "/") == 0 ||
+                strcmp(text, "%") == 0))
+      {
+         break;
+      }
+   }
+
+   left = isWideOperand(function, &tokens[start], at - start, &leftVariable);
+   right = isWideOperand(function, &tokens[right], end - right, &rightVariable);
+   return shift ? (left && rightVariable) : (left || right);
+}
+
+//*****************************************************************************
+// Notes the segment a function is declared or defined in.
+//
+// Parameters:
+//    function  The function.
+//    near      Whether the segment is near.
+//    path      Where, for the report.
+//    line
+//
+// Return: None.
+//*****************************************************************************
+static void declare(Function* function, int near, const char* path, int line)
+{
+   if (function->declaredNear == -1)
+   {
+      function->declaredNear = near;
+   }
+   else if (function->declaredNear != near && !function->declarationConflict)
+   {
+      function->declarationConflict = 1;
+      (void) snprintf(function->declarationFile, MAX_PATH, "%s", path);
+      function->declarationLine = line;
+   }
+}
+
+static void addReference(Function* function, const char* name, int line,
+                         int call, int farPointer, int runtime)
+{
+   Reference* reference;
+
+   function->references = grow(function->references,
+                               (function->referenceCount + 1) * sizeof(Reference));
+   reference = &function->references[function->referenceCount++];
+   copyName(reference->name, name);
+   reference->line = line;
+   reference->call = call;
+   reference->farPointer = farPointer;
+   reference->runtime = runtime;
+}
+
+//*****************************************************************************
+// Collects what a run of tokens in a function body refers to, expanding the
+// macros as it goes.
+//
+// Parameters:
+//    function  The function.
+//    tokens    The tokens.
+//    count     How many.
+//    line      Line to charge the references to, 0 to take the tokens'.
+//    macro     Macro being expanded, its parameters are skipped. NULL for none.
+//    depth     Expansion depth.
+//
+// Return: None.
+//*****************************************************************************
+static void scanBody(Function* function, const Token* tokens, int count,
+                     int line, const Macro* macro, int depth)
+{
+   const Macro* expansion;
+   const char* text;
+   int where;
+   int call;
+   int binary;
+   int shift;
+   int i;
+   int j;
+   int parameter;
+
+   for (i = 0; i < count; ++i)
+   {
+      text = tokens[i].text;
+      where = line ? line : tokens[i].line;
+      if (tokens[i].directive)
+      {
+         continue;
+      }
+      if (strcmp(text, "__far") == 0)
+      {
+         addReference(function, text, where, 0, 1, 0);
+         continue;
+      }
+      binary = (i > 0 && ((isIdentifier(tokens[i - 1].text) &&
+                           !isTypeWord(tokens[i - 1].text)) ||
+                          strcmp(tokens[i - 1].text, "0") == 0 ||
+                          strcmp(tokens[i - 1].text, ")") == 0 ||
+                          strcmp(tokens[i - 1].text, "]") == 0));
+      shift = (i + 1 < count && (text[0] == '<' || text[0] == '>') &&
+               text[1] == '\0' && strcmp(tokens[i + 1].text, text) == 0);
+      if ((shift || strcmp(text, "/") == 0 || strcmp(text, "%") == 0 ||
+           (binary && strcmp(text, "*") == 0)) &&
+          isRuntimeOperation(function, tokens, count, i))
+      {
+         addReference(function, text, where, 0, 0, 1);
+         i += shift;
+         continue;
+      }
+      if (macro == NULL && isLongType(text))
+      {
+         // a long local, after the qualifiers and the stars.
+         for (j = i + 1; j < count && isTypeWord(tokens[j].text); ++j)
+         {
+         }
+         if (j + 1 < count && isIdentifier(tokens[j].text) &&
+             strchr("=;,[)", tokens[j + 1].text[0]) != NULL)
+         {
+            addWideName(function, tokens[j].text);
+         }
+      }
+      if (!isIdentifier(text) || isKeyword(text) ||
+          (i > 0 && (strcmp(tokens[i - 1].text, ".") == 0 ||
+                     strcmp(tokens[i - 1].text, "->") == 0)))
+      {
+         continue;
+      }
+
+      parameter = 0;
+      for (j = 0; macro != NULL && j < macro->paramCount; ++j)
+      {
+         parameter |= (strcmp(text, macro->params[j]) == 0);
+      }
+      if (parameter)
+      {
+         continue;
+      }
+
+      call = (i + 1 < count && strcmp(tokens[i + 1].text, "(") == 0);
+      expansion = findMacro(text);
+      if (expansion != NULL && (call || !expansion->functionLike))
+      {
+         // the arguments are scanned all the same, as the tokens after it.
+         if (depth < MAX_EXPAND && expansion != macro)
+         {
+            scanBody(function, expansion->body.tokens, expansion->body.count,
+                     where, expansion, depth + 1);
+         }
+         continue;
+      }
+      addReference(function, text, where, call, 0, 0);
+   }
+}
+
+//*****************************************************************************
+// Works out what a top level statement declares.
+//
+// Parameters:
+//    tokens  The statement, without its ; or body.
+//    count   How many.
+//    path    File it's in.
+//
+// Return: None.
+//*****************************************************************************
+static void declaration(const Token* tokens, int count, const char* path)
+{
+   Variable* variable;
+   TypeName* type;
+   const char* name;
+   const char* next;
+   int depth = 0;
+   int initializer = 0;
+   int farData = current.farData;
+   int wide = 0;
+   int i;
+
+   if (count == 0)
+   {
+      return;
+   }
+
+   for (i = 0; i < count; ++i)
+   {
+      farData |= (strcmp(tokens[i].text, "__far") == 0);
+   }
+   for (i = 0; i < count && strcmp(tokens[i].text, "=") != 0; ++i)
+   {
+      wide |= isLongType(tokens[i].text);
+   }
+
+   if (strcmp(tokens[0].text, "typedef") == 0)
+   {
+      // the name is the last word, a struct's body has been left out.
+      name = tokens[count - 1].text;
+      if (isIdentifier(name) && !isKeyword(name))
+      {
+         type = lookupTypeName(name);
+         if (type == NULL)
+         {
+            typeNames = grow(typeNames, (typeNameCount + 1) * sizeof(TypeName));
+            type = &typeNames[typeNameCount++];
+            copyName(type->name, name);
+            type->wide = 0;
+         }
+         type->wide |= wide;
+      }
+      return;
+   }
+
+   for (i = 0; i < count; ++i)
+   {
+      name = tokens[i].text;
+      next = (i + 1 < count) ? tokens[i + 1].text : ";";
+
+      if (strcmp(name, "(") == 0 || strcmp(name, "[") == 0)
+      {
+         ++depth;
+      }
+      else if (strcmp(name, ")") == 0 || strcmp(name, "]") == 0)
+      {
+         --depth;
+      }
+      else if (depth == 0 && strcmp(name, "=") == 0)
+      {
+         initializer = 1;
+      }
+      else if (depth == 0 && strcmp(name, ",") == 0)
+      {
+         initializer = 0;
+      }
+
+      if (depth != 0 || initializer || !isIdentifier(name) || isKeyword(name))
+      {
+         continue;
+      }
+
+      if (strcmp(next, "(") == 0)
+      {
+         // a prototype. Nothing else on the line counts.
+         if (findMacro(name) == NULL)
+         {
+            declare(findFunction(name), current.code.near, path, tokens[i].line);
+         }
+         return;
+      }
+      if (strcmp(next, "=") == 0 || strcmp(next, "[") == 0 ||
+          strcmp(next, ",") == 0 || strcmp(next, ";") == 0)
+      {
+         variable = lookupVariable(name);
+         if (variable == NULL)
+         {
+            variables = grow(variables, (variableCount + 1) * sizeof(Variable));
+            variable = &variables[variableCount++];
+            copyName(variable->name, name);
+            variable->farData = 0;
+            variable->wide = 0;
+         }
+         variable->farData |= farData;
+         variable->wide |= wide;
+      }
+   }
+}
+
+//*****************************************************************************
+// Starts a function definition.
+//
+// Parameters:
+//    tokens  Its head, up to the {.
+//    count   How many.
+//    path    File it's in.
+//
+// Return: The function, NULL if the head isn't one.
+//*****************************************************************************
+static Function* definition(const Token* tokens, int count, const char* path)
+{
+   const Macro* macro;
+   Function* function;
+   const char* name = NULL;
+   int line = 0;
+   int isr = 0;
+   int i;
+   int j;
+
+   for (i = 1; i < count && name == NULL; ++i)
+   {
+      if (strcmp(tokens[i].text, "(") == 0 && isIdentifier(tokens[i - 1].text) &&
+          !isKeyword(tokens[i - 1].text))
+      {
+         name = tokens[i - 1].text;
+         line = tokens[i - 1].line;
+
+         // HAL_ISR(vector, name), the function is the last word in it.
+         macro = findMacro(name);
+         if (macro != NULL && macro->functionLike)
+         {
+            for (j = i + 1; j < count; ++j)
+            {
+               if (isIdentifier(tokens[j].text))
+               {
+                  name = tokens[j].text;
+               }
+            }
+            for (j = 0; j < macro->body.count; ++j)
+            {
+               isr |= (strcmp(macro->body.tokens[j].text, "interrupt") == 0);
+            }
+         }
+      }
+   }
+   if (name == NULL)
+   {
+      return NULL;
+   }
+
+   function = findFunction(name);
+   function->defined = 1;
+   function->isr = isr;
+   function->segment = current.code;
+   function->line = line;
+   function->unit = unit;
+   (void) snprintf(function->file, MAX_PATH, "%s", path);
+   declare(function, current.code.near, path, line);
+
+   // the long parameters.
+   function->wideCount = 0;
+   for (; i < count; ++i)
+   {
+      if (isLongType(tokens[i].text))
+      {
+         for (j = i + 1; j < count && isTypeWord(tokens[j].text); ++j)
+         {
+         }
+         if (j < count && isIdentifier(tokens[j].text))
+         {
+            addWideName(function, tokens[j].text);
+         }
+      }
+   }
+   return function;
+}
+
+
+//*****************************************************************************
+// Reads one file, the headers it includes along with it. Only the parts the
+// conditionals leave in are looked at.
+//
+// Parameters:
+//    path  The file.
+//
+// Return: None.
+//*****************************************************************************
+static void parseFile(const char* path)
+{
+   TokenList list = { NULL, 0, 0 };
+   TokenList head = { NULL, 0, 0 };     // the top level statement so far
+   TokenList body = { NULL, 0, 0 };     // the function body so far
+   Function* function = NULL;
+   const Token* token;
+   char word[MAX_NAME];
+   char* text;
+   int live[MAX_STACK];                 // per open conditional
+   int taken[MAX_STACK];                // a branch of it has been live
+   int conditionals = 0;
+   int outer;
+   int brace = 0;
+   int inBody = 0;
+   int skipping = 0;                    // an initializer or a struct body
+   int value;
+   int i;
+   int k;
+
+   text = readFile(path);
+   if (text == NULL)
+   {
+      // a header that isn't in the tree, such as the derivative's.
+      return;
+   }
+   tokenize(text, &list);
+   free(text);
+
+   for (i = 0; i < list.count; ++i)
+   {
+      token = &list.tokens[i];
+      outer = (conditionals == 0 || live[conditionals - 1]);
+
+      if (token->directive)
+      {
+         word[0] = '\0';
+         (void) sscanf(token->text, " %63s", word);
+         if (strncmp(word, "if", 2) == 0 && conditionals < MAX_STACK)
+         {
+            value = condition(token->text);
+            live[conditionals] = outer && value > 0;
+            taken[conditionals] = value > 0;
+            ++conditionals;
+         }
+         else if (strcmp(word, "elif") == 0 && conditionals > 0)
+         {
+            value = condition(token->text);
+            live[conditionals - 1] = !taken[conditionals - 1] && value > 0 &&
+               (conditionals == 1 || live[conditionals - 2]);
+            taken[conditionals - 1] |= (value > 0);
+         }
+         else if (strcmp(word, "else") == 0 && conditionals > 0)
+         {
+            live[conditionals - 1] = !taken[conditionals - 1] &&
+               (conditionals == 1 || live[conditionals - 2]);
+            taken[conditionals - 1] = 1;
+         }
+         else if (strcmp(word, "endif") == 0 && conditionals > 0)
+         {
+            --conditionals;
+         }
+         else if (outer)
+         {
+            directive(token->text, path);
+         }
+         continue;
+      }
+
+      if (!outer)
+      {
+         continue;
+      }
+
+      if (inBody || skipping)
+      {
+         brace += (strcmp(token->text, "{") == 0);
+         brace -= (strcmp(token->text, "}") == 0);
+         if (brace > 0 && inBody)
+         {
+            addToken(&body, token->text, token->line, 0);
+         }
+         else if (brace == 0 && inBody)
+         {
+            scanBody(function, body.tokens, body.count, 0, NULL, 0);
+            freeTokens(&body);
+            freeTokens(&head);
+            inBody = 0;
+         }
+         skipping = skipping && brace > 0;
+      }
+      else if (strcmp(token->text, ";") == 0)
+      {
+         declaration(head.tokens, head.count, path);
+         freeTokens(&head);
+      }
+      else if (strcmp(token->text, "{") == 0)
+      {
+         // a function body, or the braces of an initializer or a struct,
+         // which are part of the statement.
+         value = 0;
+         for (k = 0; k < head.count; ++k)
+         {
+            value |= (strcmp(head.tokens[k].text, "=") == 0);
+         }
+         function = NULL;
+         if (!value && head.count > 0 &&
+             strcmp(head.tokens[head.count - 1].text, ")") == 0)
+         {
+            function = definition(head.tokens, head.count, path);
+         }
+         brace = 1;
+         inBody = (function != NULL);
+         skipping = !inBody;
+      }
+      else
+      {
+         addToken(&head, token->text, token->line, 0);
+      }
+   }
+
+   freeTokens(&body);
+   freeTokens(&head);
+   freeTokens(&list);
+}
+
+//*****************************************************************************
+// Reads a translation unit, starting from a clean preprocessor and the
+// default segments.
+//
+// Parameters:
+//    path  The source file.
+//
+// Return: None.
+//*****************************************************************************
+static void parseUnit(const char* path)
+{
+   int i;
+
+   for (i = 0; i < macroCount; ++i)
+   {
+      freeTokens(&macros[i].body);
+   }
+   macroCount = 0;
+   defineCount = 0;
+   for (i = 0; i < commandDefineCount; ++i)
+   {
+      define(commandDefines[i]);
+   }
+
+   memset(&current, 0, sizeof(current));
+   copyName(current.code.name, "DEFAULT");
+   current.code.banked = 1;
+   stackDepth = 0;
+
+   parseFile(path);
+
+   if (stackDepth != 0)
+   {
+      (void) printf("%s: pragma push without a pop\n", path);
+      ++problems;
+   }
+}
+
+//*****************************************************************************
+// The file name without its directories, for the report.
+//*****************************************************************************
+static const char* baseName(const char* path)
+{
+   const char* slash = strrchr(path, '/');
+
+   return slash ? slash + 1 : path;
+}
+
+//*****************************************************************************
+// Writes the line of one hot function and the problems in it.
+//
+// Parameters:
+//    function  The function.
+//
+// Return: None.
+//*****************************************************************************
+static void reportHot(const Function* function)
+{
+   const Reference* reference;
+   const Function* callee;
+   const Variable* variable;
+   char segment[2 * MAX_NAME];
+   int nearCalls = 0;
+   int farCalls = 0;
+   int libraryCalls = 0;
+   int farData = 0;
+   int i;
+
+   for (i = 0; i < function->referenceCount; ++i)
+   {
+      reference = &function->references[i];
+      if (reference->farPointer)
+      {
+         ++farData;
+         (void) printf("   %s:%d: %s uses a __far pointer\n",
+                       baseName(function->file), reference->line, function->name);
+         continue;
+      }
+
+      if (reference->runtime)
+      {
+         ++nearCalls;
+         continue;
+      }
+
+      callee = lookupFunction(reference->name);
+      if (reference->call && callee != NULL)
+      {
+         if (callee->declaredNear == 1 && (!callee->defined || callee->segment.near))
+         {
+            ++nearCalls;
+         }
+         else
+         {
+            ++farCalls;
+            (void) printf("   %s:%d: %s calls %s, which is %s\n",
+                          baseName(function->file), reference->line, function->name,
+                          callee->name, callee->segment.banked ? "banked" : "far");
+         }
+      }
+      else if (reference->call)
+      {
+         ++libraryCalls;
+         (void) printf("   %s:%d: %s calls %s, which is in the library\n",
+                       baseName(function->file), reference->line, function->name,
+                       reference->name);
+      }
+      else
+      {
+         variable = lookupVariable(reference->name);
+         if (variable != NULL && variable->farData)
+         {
+            ++farData;
+            (void) printf("   %s:%d: %s uses %s, which is far data\n",
+                          baseName(function->file), reference->line, function->name,
+                          variable->name);
+         }
+      }
+   }
+
+   problems += farCalls + libraryCalls + farData;
+
+   (void) snprintf(segment, sizeof(segment), "%s%s", function->segment.name,
+                   function->isr ? " (ISR)" : "");
+   (void) printf("%-26s %-12s %-18s %5d %5d %8d %9d\n", function->name,
+                 baseName(function->file), segment, nearCalls, farCalls,
+                 libraryCalls, farData);
+}
+
+//*****************************************************************************
+// Orders the functions the way they are in the sources.
+//*****************************************************************************
+static int compareFunctions(const void* a, const void* b)
+{
+   const Function* first = a;
+   const Function* second = b;
+
+   if (first->unit != second->unit)
+   {
+      return first->unit - second->unit;
+   }
+   return first->line - second->line;
+}
+
+//*****************************************************************************
+// Writes the report.
+//
+// Parameters:
+//    argc, argv  The command line, for the heading.
+//
+// Return: None.
+//*****************************************************************************
+static void report(int argc, char** argv)
+{
+   const Function* function;
+   const char* previous;
+   const char* lowest;
+   int done;
+   int column;
+   int i;
+   int j;
+
+   (void) printf("BEGIN PLACEMENT\n");
+   (void) printf("FILES");
+   for (i = 1; i < argc; ++i)
+   {
+      (void) printf(" %s", baseName(argv[i]));
+   }
+   (void) printf("\n\n");
+
+   qsort(functions, (size_t)functionCount, sizeof(Function), compareFunctions);
+
+   // the hot functions, with any problem ahead of the line it's counted in.
+   (void) printf("%-26s %-12s %-18s %5s %5s %8s %9s\n", "HOT FUNCTION", "FILE",
+                 "SEGMENT", "NEAR", "FAR", "LIBRARY", "FAR DATA");
+   for (i = 0; i < functionCount; ++i)
+   {
+      function = &functions[i];
+      if (function->defined && function->segment.near)
+      {
+         reportHot(function);
+      }
+   }
+
+   // the rest by segment, in order of their names.
+   (void) printf("\n%-26s %s\n", "OTHER SEGMENT", "FUNCTIONS");
+   previous = "";
+   for (;;)
+   {
+      lowest = NULL;
+      for (i = 0; i < functionCount; ++i)
+      {
+         function = &functions[i];
+         if (function->defined && !function->segment.near &&
+             strcmp(function->segment.name, previous) > 0 &&
+             (lowest == NULL || strcmp(function->segment.name, lowest) < 0))
+         {
+            lowest = function->segment.name;
+         }
+      }
+      if (lowest == NULL)
+      {
+         break;
+      }
+
+      (void) printf("%-26s", lowest);
+      column = 26;
+      for (i = 0; i < functionCount; ++i)
+      {
+         function = &functions[i];
+         if (function->defined && !function->segment.near &&
+             strcmp(function->segment.name, lowest) == 0)
+         {
+            if (column + 1 + (int)strlen(function->name) > 79)
+            {
+               (void) printf("\n%-26s", "");
+               column = 26;
+            }
+            (void) printf(" %s", function->name);
+            column += 1 + (int)strlen(function->name);
+         }
+      }
+      (void) printf("\n");
+      previous = lowest;
+   }
+
+   // a function declared one way and defined the other is called wrongly.
+   done = 0;
+   for (i = 0; i < functionCount; ++i)
+   {
+      function = &functions[i];
+      if (function->declarationConflict ||
+          (function->defined && function->declaredNear != function->segment.near))
+      {
+         if (!done)
+         {
+            (void) printf("\n");
+            done = 1;
+         }
+         (void) printf("%s:%d: %s is declared both near and far\n",
+                       baseName(function->declarationConflict ?
+                                function->declarationFile : function->file),
+                       function->declarationConflict ?
+                       function->declarationLine : function->line,
+                       function->name);
+         ++problems;
+      }
+   }
+
+   j = 0;
+   for (i = 0; i < functionCount; ++i)
+   {
+      j += (functions[i].defined && functions[i].segment.near);
+   }
+   (void) printf("\nHOT %d PROBLEMS %d\nEND PLACEMENT\n", j, problems);
+}
+
+//*****************************************************************************
+// Entry point.
+//
+// Parameters:
+//    argc, argv  The command line.
+//
+// Return: Exit status, 1 if there were problems.
+//*****************************************************************************
+int main(int argc, char** argv)
+{
+   int files = 0;
+   int i;
+
+   for (i = 1; i < argc; ++i)
+   {
+      if (strncmp(argv[i], "-D", 2) == 0 && argv[i][2] != '\0' &&
+          commandDefineCount < MAX_DEFINES)
+      {
+         commandDefines[commandDefineCount++] = argv[i] + 2;
+      }
+      else if (argv[i][0] == '-')
+      {
+         (void) fprintf(stderr, "usage: %s [-D<name> ...] file.c ...\n", argv[0]);
+         return 2;
+      }
+      else
+      {
+         argv[++files] = argv[i];
+      }
+   }
+
+   if (files == 0)
+   {
+      (void) fprintf(stderr, "usage: %s [-D<name> ...] file.c ...\n", argv[0]);
+      return 2;
+   }
+
+   for (unit = 1; unit <= files; ++unit)
+   {
+      parseUnit(argv[unit]);
+   }
+
+   report(files + 1, argv);
+   return problems ? 1 : 0;
+}
@@ -0,0 +1,411 @@
+/******************************************************************************
+ * Synthetic pulse trains
+ *
+ * Description:
+ *
+ * See pulsegen.h. The random numbers come from a xorshift generator rather
+ * than rand(), so a seed gives the same train on every C library.
+ *
+ *****************************************************************************/
+
+// system includes
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// project includes
+#include "pulsegen.h"
+
+// Definitions
+
+// Shortest interval handed out, so edge times always go forward.
+#define MIN_INTERVAL_US 0.001
+
+// Longest shape specification PulseShapeParse takes.
+#define MAX_SPEC 128
+
+// Names of the shapes, indexed by PULSE_ kind.
+static const char* const shapeNames[] =
+{
+   "fixed", "gaussian", "poisson", "burst", "drift"
+};
+
+//*****************************************************************************
+// Steps the random number generator.
+//
+// Parameters:
+//    gen  The generator.
+//
+// Return: A uniformly distributed number in [0, 1).
+//*****************************************************************************
+static double uniform(PulseGen* gen)
+{
+   UINT32 x = gen->random;
+
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   gen->random = x;
+
+   return (double)(x >> 8) / 16777216.0;
+}
+
+//*****************************************************************************
+// Draws from the standard normal distribution by the Box-Muller method.
+//
+// Parameters:
+//    gen  The generator.
+//
+// Return: A normally distributed number with mean 0 and deviation 1.
+//*****************************************************************************
+static double gaussian(PulseGen* gen)
+{
+   double u1 = 1.0 - uniform(gen);
+   double u2 = uniform(gen);
+
+   return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+//*****************************************************************************
+// Fills in the default shape, fixed at 1000 us with no end.
+//
+// Parameters:
+//    shape  The shape.
+//
+// Return: None.
+//*****************************************************************************
+void PulseShapeDefaults(PulseShape* shape)
+{
+   shape->kind = PULSE_FIXED;
+   shape->period = 1000.0;
+   shape->jitter = 0.0;
+   shape->burst = 1;
+   shape->gap = 10.0;
+   shape->drift = 0.0;
+   shape->outliers = 0.0;
+   shape->scale = 10.0;
+   shape->count = 0;
+   shape->seed = 1;
+}
+
+//*****************************************************************************
+// Reads a shape from its text form, see pulsegen.h, over whatever is in it
+// already.
+//
+// Parameters:
+//    shape  The shape.
+//    spec   The text.
+//
+// Return: 0 if all of it was understood, -1 if not.
+//*****************************************************************************
+int PulseShapeParse(PulseShape* shape, const char* spec)
+{
+   char copy[MAX_SPEC];
+   char* field;
+   char* value;
+   char* end;
+   double number;
+   UINT8 kind;
+
+   if (strlen(spec) >= sizeof(copy))
+   {
+      return -1;
+   }
+   strcpy(copy, spec);
+
+   field = strtok(copy, ",");
+   if (field == NULL)
+   {
+      return -1;
+   }
+
+   for (kind = 0; kind < sizeof(shapeNames) / sizeof(shapeNames[0]); ++kind)
+   {
+      if (strcmp(field, shapeNames[kind]) == 0)
+      {
+         break;
+      }
+   }
+   if (kind == sizeof(shapeNames) / sizeof(shapeNames[0]))
+   {
+      return -1;
+   }
+   shape->kind = kind;
+
+   while ((field = strtok(NULL, ",")) != NULL)
+   {
+      value = strchr(field, '=');
+      if (value == NULL)
+      {
+         return -1;
+      }
+      *value++ = '\0';
+
+      number = strtod(value, &end);
+      if (end == value || *end != '\0')
+      {
+         return -1;
+      }
+
+      if (strcmp(field, "period") == 0 && number > 0.0)
+      {
+         shape->period = number;
+      }
+      else if (strcmp(field, "jitter") == 0 && number >= 0.0)
+      {
+         shape->jitter = number;
+      }
+      else if (strcmp(field, "burst") == 0 && number >= 1.0 && number <= 65535.0)
+      {
+         shape->burst = (UINT16)number;
+      }
+      else if (strcmp(field, "gap") == 0 && number > 0.0)
+      {
+         shape->gap = number;
+      }
+      else if (strcmp(field, "drift") == 0)
+      {
+         shape->drift = number;
+      }
+      else if (strcmp(field, "outliers") == 0 && number >= 0.0 && number <= 1.0)
+      {
+         shape->outliers = number;
+      }
+      else if (strcmp(field, "scale") == 0 && number > 0.0)
+      {
+         shape->scale = number;
+      }
+      else if (strcmp(field, "count") == 0 && number >= 0.0)
+      {
+         shape->count = (unsigned long)number;
+      }
+      else if (strcmp(field, "seed") == 0 && number >= 1.0 && number <= 4294967295.0)
+      {
+         shape->seed = (UINT32)number;
+      }
+      else
+      {
+         return -1;
+      }
+   }
+
+   return 0;
+}
+
+//*****************************************************************************
+// Starts a train.
+//
+// Parameters:
+//    gen          The generator.
+//    shape        What the train looks like.
+//    cyclesPerUs  Bus cycles in a microsecond, for PulseGenEdges.
+//
+// Return: None.
+//*****************************************************************************
+void PulseGenInit(PulseGen* gen, const PulseShape* shape, double cyclesPerUs)
+{
+   gen->shape = *shape;
+   gen->now = 0.0;
+   gen->period = shape->period;
+   gen->burstLeft = 0;
+   gen->produced = 0;
+   gen->random = shape->seed ? shape->seed : 1;
+   gen->cyclesPerUs = cyclesPerUs;
+   gen->lastCycle = 0;
+}
+
+//*****************************************************************************
+// Works out the time to the next edge and moves the train on to it.
+//
+// Parameters:
+//    gen  The generator.
+//
+// Return: The interval in us, or a negative number at the end of the train.
+//*****************************************************************************
+double PulseGenNextInterval(PulseGen* gen)
+{
+   const PulseShape* shape = &gen->shape;
+   double interval;
+
+   if (shape->count != 0 && gen->produced >= shape->count)
+   {
+      return -1.0;
+   }
+
+   switch (shape->kind)
+   {
+      case PULSE_GAUSSIAN:
+         interval = gen->period + shape->jitter * gaussian(gen);
+         break;
+
+      case PULSE_POISSON:
+         interval = -gen->period * log(1.0 - uniform(gen));
+         break;
+
+      case PULSE_BURST:
+         if (gen->burstLeft > 0)
+         {
+            interval = shape->gap;
+            --gen->burstLeft;
+         }
+         else
+         {
+            // Bursts start a period apart, the first one a period in.
+            interval = gen->period;
+            if (gen->produced != 0)
+            {
+               interval -= shape->gap * (shape->burst - 1);
+            }
+            gen->burstLeft = (UINT16)(shape->burst - 1);
+         }
+         break;
+
+      case PULSE_DRIFT:
+         interval = gen->period;
+         gen->period += shape->drift;
+         break;
+
+      default:
+         interval = gen->period;
+         break;
+   }
+
+   if (shape->outliers > 0.0 && uniform(gen) < shape->outliers)
+   {
+      interval = gen->period * shape->scale;
+   }
+
+   if (interval < MIN_INTERVAL_US)
+   {
+      interval = MIN_INTERVAL_US;
+   }
+
+   ++gen->produced;
+   gen->now += interval;
+   return interval;
+}
+
+//*****************************************************************************
+// Hands out the next edge as a bus cycle. Edges closer together than a
+// cycle are pushed apart so the times keep going up.
+//
+// Parameters:
+//    context  The PulseGen.
+//
+// Return: Bus cycle of the edge, or ECT_NO_EDGE at the end of the train.
+//*****************************************************************************
+EctCycles PulseGenEdges(void* context)
+{
+   PulseGen* gen = (PulseGen*)context;
+   EctCycles cycle;
+
+   if (PulseGenNextInterval(gen) < 0.0)
+   {
+      return ECT_NO_EDGE;
+   }
+
+   cycle = (EctCycles)(gen->now * gen->cyclesPerUs + 0.5);
+   if (cycle <= gen->lastCycle)
+   {
+      cycle = gen->lastCycle + 1;
+   }
+   gen->lastCycle = cycle;
+
+   return cycle;
+}
+
+//*****************************************************************************
+// Fills values with the timer counts the next edges are captured at.
+//
+// Parameters:
+//    gen         The generator.
+//    values      Where the captures go.
+//    count       How many to make.
+//    ticksPerUs  Timer rate.
+//
+// Return: How many were made.
+//*****************************************************************************
+unsigned int PulseGenCaptures(PulseGen* gen, UINT16* values, unsigned int count,
+                              double ticksPerUs)
+{
+   unsigned int i;
+
+   for (i = 0; i < count; ++i)
+   {
+      if (PulseGenNextInterval(gen) < 0.0)
+      {
+         break;
+      }
+      values[i] = (UINT16)(unsigned long long)(gen->now * ticksPerUs);
+   }
+
+   return i;
+}
+
+//*****************************************************************************
+// Starts a train that follows the one shape describes. Its jitter and gaps
+// come from a generator of their own, seeded off the shape's seed, so they
+// don't change the train it follows.
+//
+// Parameters:
+//    follower     The train.
+//    shape        What the train it follows looks like.
+//    delay        How far behind it the edges come, in us.
+//    jitter       Standard deviation of the delay, in us.
+//    missing      Chance of an edge being left out, 0 to 1.
+//    cyclesPerUs  Bus cycles in a microsecond.
+//
+// Return: None.
+//*****************************************************************************
+void PulseFollowerInit(PulseFollower* follower, const PulseShape* shape,
+                       double delay, double jitter, double missing,
+                       double cyclesPerUs)
+{
+   PulseShape noise = *shape;
+
+   noise.seed = (shape->seed ^ 0x9E3779B9u) ? (shape->seed ^ 0x9E3779B9u) : 1;
+   PulseGenInit(&follower->leader, shape, cyclesPerUs);
+   PulseGenInit(&follower->noise, &noise, cyclesPerUs);
+   follower->delay = delay;
+   follower->jitter = jitter;
+   follower->missing = missing;
+   follower->cyclesPerUs = cyclesPerUs;
+   follower->lastCycle = 0;
+}
+
+//*****************************************************************************
+// Hands out the next edge of a follower as a bus cycle. Edges that would
+// come before the start, or before the one handed out last, are moved up
+// so the times keep going up.
+//
+// Parameters:
+//    context  The PulseFollower.
+//
+// Return: Bus cycle of the edge, or ECT_NO_EDGE at the end of the train.
+//*****************************************************************************
+EctCycles PulseFollowerEdges(void* context)
+{
+   PulseFollower* follower = (PulseFollower*)context;
+   EctCycles cycle;
+   double when;
+
+   do
+   {
+      if (PulseGenNextInterval(&follower->leader) < 0.0)
+      {
+         return ECT_NO_EDGE;
+      }
+   }
+   while (follower->missing > 0.0 && uniform(&follower->noise) < follower->missing);
+
+   when = follower->leader.now + follower->delay +
+          follower->jitter * gaussian(&follower->noise);
+   cycle = (when > 0.0) ? (EctCycles)(when * follower->cyclesPerUs + 0.5) : 0;
+   if (cycle <= follower->lastCycle)
+   {
+      cycle = follower->lastCycle + 1;
+   }
+   follower->lastCycle = cycle;
+
+   return cycle;
+}
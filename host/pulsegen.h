@@ -0,0 +1,121 @@
+/******************************************************************************
+ * Synthetic pulse trains
+ *
+ * Description:
+ *
+ * Reproducible rising edge trains for the host build and the benches. A
+ * train is described by a PulseShape:
+ *
+ *    fixed     every interval is the period
+ *    gaussian  the period plus normally distributed jitter
+ *    poisson   exponentially distributed intervals averaging the period,
+ *              that is edges arriving at random
+ *    burst     bursts of edges a gap apart, one burst every period
+ *    drift     the period ramps by drift microseconds every edge
+ *
+ * On top of any of them, outliers replaces an interval with one scale times
+ * as long now and then, a missed pulse for a scale over 1 or a glitch for a
+ * scale under it.
+ *
+ * A PulseFollower is the other channel of a skew measurement. Its edges
+ * follow those of a train a delay behind, with jitter of their own, and
+ * some of them can be left out.
+ *
+ * The same seed always gives the same train. A generator hands out edges
+ * either as bus cycles, for the ECT simulator, or as TC1 style 16-bit
+ * captures that wrap round the way the timer does.
+ *
+ * PulseShapeParse() reads a shape from the command line, a name followed by
+ * comma separated settings in microseconds:
+ *
+ *    gaussian,period=1000,jitter=20,seed=7
+ *    burst,period=5000,burst=8,gap=40,outliers=0.01,scale=0.2
+ *
+ *****************************************************************************/
+
+#ifndef PULSEGEN_H
+#define PULSEGEN_H
+
+#include "types.h"
+#include "ectsim.h"
+
+// Shapes of train.
+#define PULSE_FIXED     0
+#define PULSE_GAUSSIAN  1
+#define PULSE_POISSON   2
+#define PULSE_BURST     3
+#define PULSE_DRIFT     4
+
+typedef struct
+{
+   UINT8 kind;                // PULSE_ one of the above
+   double period;             // interval, or mean interval, in us
+   double jitter;             // standard deviation of gaussian, in us
+   UINT16 burst;              // edges in each burst
+   double gap;                // interval inside a burst, in us
+   double drift;              // change of period each edge, in us
+   double outliers;           // chance of each interval being an outlier
+   double scale;              // outlier interval as a multiple of the period
+   unsigned long count;       // edges in the train, 0 for no end
+   UINT32 seed;               // random number seed, not 0
+} PulseShape;
+
+typedef struct
+{
+   PulseShape shape;
+   double now;                // time of the last edge, in us
+   double period;             // the period now, after any drift
+   UINT16 burstLeft;          // edges left in the current burst
+   unsigned long produced;    // edges handed out so far
+   UINT32 random;             // generator state
+   double cyclesPerUs;        // bus cycles in a microsecond
+   EctCycles lastCycle;       // last edge handed to the simulator
+} PulseGen;
+
+// A train that follows another one. Each of its edges comes delay after the
+// edge of the other train with the same number, give or take normally
+// distributed jitter, unless it is one of the missing fraction left out. It
+// runs a copy of the other train, so both have to start from the same shape.
+typedef struct
+{
+   PulseGen leader;           // the copy of the other train
+   PulseGen noise;            // random numbers for the jitter and the gaps
+   double delay;              // in us, negative to lead instead
+   double jitter;             // standard deviation, in us
+   double missing;            // chance of an edge being left out
+   double cyclesPerUs;
+   EctCycles lastCycle;
+} PulseFollower;
+
+// Fills in the default shape, fixed at 1000 us with no end.
+void PulseShapeDefaults(PulseShape* shape);
+
+// Reads a shape from its text form over the defaults. Returns 0 if it
+// understood all of it, -1 if not.
+int PulseShapeParse(PulseShape* shape, const char* spec);
+
+// Starts a train. cyclesPerUs is only needed by PulseGenEdges.
+void PulseGenInit(PulseGen* gen, const PulseShape* shape, double cyclesPerUs);
+
+// Time from the last edge to the next, in us, or a negative number at the
+// end of the train.
+double PulseGenNextInterval(PulseGen* gen);
+
+// An EctEdgeSource for a PulseGen.
+EctCycles PulseGenEdges(void* context);
+
+// Fills values with the timer counts the next edges are captured at, for a
+// timer running at ticksPerUs and wrapping at 16 bits. Returns how many it
+// filled, fewer than count at the end of the train.
+unsigned int PulseGenCaptures(PulseGen* gen, UINT16* values, unsigned int count,
+                              double ticksPerUs);
+
+// Starts a follower of the train shape describes, all times in us.
+void PulseFollowerInit(PulseFollower* follower, const PulseShape* shape,
+                       double delay, double jitter, double missing,
+                       double cyclesPerUs);
+
+// An EctEdgeSource for a PulseFollower.
+EctCycles PulseFollowerEdges(void* context);
+
+#endif // PULSEGEN_H
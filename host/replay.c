@@ -0,0 +1,373 @@
+/******************************************************************************
+ * Capture trace replay
+ *
+ * Description:
+ *
+ * Reads the traces written by the TRACE command and puts each one through
+ * the firmware's own processTimerMeasurements() and dumpResults(), so the
+ * DUMP that comes out is byte for byte the one the board would have sent
+ * for that capture. Anything in the input outside BEGIN TRACE and END TRACE
+ * is skipped, so a whole terminal log can be fed in as it is.
+ *
+ *    replay [--range <lowerUs> <upperUs>] [--map <cells>] [--time] [file ...]
+ *
+ *    --range  histogram over a different range than the capture was made
+ *             with
+ *    --map    write the return map with that many cells a side after each
+ *             DUMP, the way DUMPMAP does, see MAP
+ *    --time   report the processing time per interval on stderr
+ *
+ * With no files it reads stdin. A trace made in live mode is processed in
+ * one go, which gives the same histogram the live binning did. It is built
+ * with CAPTURE_PAGED, so it takes the traces of deep captures as well, and
+ * the values are read back through paged memory like firmware_host_deep
+ * reads them.
+ *
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#define HAL_HOST_BACKEND
+
+// system includes
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// project includes
+#include "hal.h"
+#include "command.h"
+#include "farcursor.h"
+
+// Definitions
+
+// The newest trace version this understands, see traceResults in main.c.
+// Version 1 had no GLITCH line, which reads as no filter.
+#define TRACE_VERSION 2
+
+// As main.c has them.
+#define TRUE               1
+#define MAX_VALUES         65535u
+#define CAPTURE_FIRST_PAGE 0x30
+#define BUCKETS            100
+#define MAP_CELLS_MAX      1000
+
+#define MAX_LINE   256
+
+// The firmware's state and the pipeline, see main.c.
+extern UINT16 intervalCount;
+extern UINT16 rangeLowerUs;
+extern UINT16 rangeUpperUs;
+extern UINT16 rangeSet;
+extern UINT16 outputMode;
+extern UINT16 glitchMinimumUs;
+extern volatile UINT16 glitchRejected;
+extern UINT16 mapCellsSet;
+void processTimerMeasurements(UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs);
+void dumpResults(UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs);
+void dumpMap(void);
+void FlushOutput(void);
+
+// One trace as it's read in.
+typedef struct
+{
+   int open;                  // between BEGIN TRACE and END TRACE
+   unsigned long lower;
+   unsigned long upper;
+   unsigned long buckets;
+   unsigned long intervals;
+   unsigned long drops;
+   unsigned long overruns;
+   unsigned long mode;
+   unsigned long glitchMinimum;
+   unsigned long glitchRejected;
+   unsigned int values;       // timer values read so far
+} Trace;
+
+// Options.
+static int overrideRange = 0;
+static UINT16 overrideLower = 0;
+static UINT16 overrideUpper = 0;
+static int timing = 0;
+
+//*****************************************************************************
+// Runs a complete trace through the firmware and writes its DUMP.
+//
+// Parameters:
+//    trace  The trace, its values are in paged memory.
+//    name   Where it came from, for the messages.
+//    line   Line its END TRACE is on.
+//
+// Return: 0 if it was processed, -1 if it was incomplete.
+//*****************************************************************************
+static int replayTrace(const Trace* trace, const char* name, unsigned long line)
+{
+   struct timespec start;
+   struct timespec end;
+   double elapsed;
+
+   if (trace->intervals == 0 || trace->values != trace->intervals + 1)
+   {
+      (void) fprintf(stderr, "%s:%lu: trace has %u values for %lu intervals\n",
+                     name, line, trace->values, trace->intervals);
+      return -1;
+   }
+
+   if (trace->drops != 0 || trace->overruns != 0)
+   {
+      (void) fprintf(stderr, "%s:%lu: capture missed %lu edges (mod 256),"
+                     " %lu received characters\n",
+                     name, line, trace->drops, trace->overruns);
+   }
+
+   intervalCount = (UINT16)trace->intervals;
+   rangeLowerUs = overrideRange ? overrideLower : (UINT16)trace->lower;
+   rangeUpperUs = overrideRange ? overrideUpper : (UINT16)trace->upper;
+   rangeSet = TRUE;
+   glitchMinimumUs = (UINT16)trace->glitchMinimum;
+   glitchRejected = (UINT16)trace->glitchRejected;
+
+   // every mode bins the same, the DUMP is the batch one.
+   outputMode = MODE_BATCH;
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &start);
+   processTimerMeasurements(rangeLowerUs, rangeUpperUs);
+   (void) clock_gettime(CLOCK_MONOTONIC, &end);
+
+   dumpResults(rangeLowerUs, rangeUpperUs);
+   if (mapCellsSet != 0)
+   {
+      dumpMap();
+   }
+   FlushOutput();
+   (void) fflush(stdout);
+
+   if (timing)
+   {
+      elapsed = (double)(end.tv_sec - start.tv_sec) * 1e9 +
+                (double)(end.tv_nsec - start.tv_nsec);
+      (void) fprintf(stderr, "%s:%lu: %.1f ns per interval\n",
+                     name, line, elapsed / trace->intervals);
+   }
+
+   return 0;
+}
+
+//*****************************************************************************
+// Reads the timer values off a VALUES line.
+//
+// Parameters:
+//    trace  The trace being read.
+//    text   What follows VALUES.
+//
+// Return: 0 if they were all good, -1 if not.
+//*****************************************************************************
+static int readValues(Trace* trace, char* text)
+{
+   FarCursor cursor;
+   char* word;
+   char* end;
+   unsigned long value;
+   int result = 0;
+
+   // where the firmware's deep capture keeps them, see CAPTURE_PAGED.
+   FarCursorOpen(&cursor, CAPTURE_FIRST_PAGE, HAL_PAGE_WINDOW_START,
+                 (UINT16)trace->values);
+   for (word = strtok(text, " "); word != NULL; word = strtok(NULL, " "))
+   {
+      value = strtoul(word, &end, 16);
+      if (*end != '\0' || end - word != 4 || trace->values >= MAX_VALUES)
+      {
+         result = -1;
+         break;
+      }
+      FAR_CURSOR_WRITE(&cursor, (UINT16)value);
+      ++trace->values;
+   }
+   FarCursorClose(&cursor);
+
+   return result;
+}
+
+//*****************************************************************************
+// Reads the traces from a file and replays each one.
+//
+// Parameters:
+//    file  The input.
+//    name  Its name, for the messages.
+//
+// Return: Number of traces that couldn't be read.
+//*****************************************************************************
+static int replayFile(FILE* file, const char* name)
+{
+   char line[MAX_LINE];
+   unsigned long lineNumber = 0;
+   unsigned long version;
+   unsigned long busHz;
+   unsigned long prescaleShift;
+   int failures = 0;
+   int bad = 0;
+   Trace trace;
+   size_t length;
+
+   memset(&trace, 0, sizeof(trace));
+
+   while (fgets(line, sizeof(line), file) != NULL)
+   {
+      ++lineNumber;
+      length = strcspn(line, "\r\n");
+      line[length] = '\0';
+
+      if (strcmp(line, "BEGIN TRACE") == 0)
+      {
+         memset(&trace, 0, sizeof(trace));
+         trace.open = 1;
+         bad = 0;
+         continue;
+      }
+
+      if (!trace.open)
+      {
+         continue;
+      }
+
+      if (strcmp(line, "END TRACE") == 0)
+      {
+         trace.open = 0;
+         if (bad || replayTrace(&trace, name, lineNumber) != 0)
+         {
+            ++failures;
+         }
+      }
+      else if (strncmp(line, "VALUES ", 7) == 0)
+      {
+         if (readValues(&trace, line + 7) != 0)
+         {
+            (void) fprintf(stderr, "%s:%lu: bad timer values\n", name, lineNumber);
+            bad = 1;
+         }
+      }
+      else if (sscanf(line, "TRACE %lu %lu %lu", &version, &busHz, &prescaleShift) == 3)
+      {
+         if (version < 1 || version > TRACE_VERSION)
+         {
+            (void) fprintf(stderr, "%s:%lu: trace version %lu, this reads up to %d\n",
+                           name, lineNumber, version, TRACE_VERSION);
+            bad = 1;
+         }
+      }
+      else if (sscanf(line, "RANGE %lu %lu %lu",
+                      &trace.lower, &trace.upper, &trace.buckets) == 3)
+      {
+         if (trace.buckets != BUCKETS || trace.lower >= trace.upper ||
+             trace.upper > 65535)
+         {
+            (void) fprintf(stderr, "%s:%lu: range this firmware can't use\n",
+                           name, lineNumber);
+            bad = 1;
+         }
+      }
+      else if (sscanf(line, "GLITCH %lu %lu",
+                      &trace.glitchMinimum, &trace.glitchRejected) == 2)
+      {
+         // the filter ran on the board, the values are what it kept.
+      }
+      else if (sscanf(line, "CAPTURE %lu %lu %lu %lu", &trace.intervals,
+                      &trace.drops, &trace.overruns, &trace.mode) != 4)
+      {
+         (void) fprintf(stderr, "%s:%lu: not part of a trace: %s\n",
+                        name, lineNumber, line);
+         bad = 1;
+      }
+   }
+
+   if (trace.open)
+   {
+      (void) fprintf(stderr, "%s: trace without an END TRACE\n", name);
+      ++failures;
+   }
+
+   return failures;
+}
+
+//*****************************************************************************
+// Entry point.
+//
+// Parameters:
+//    argc, argv  The command line.
+//
+// Return: Exit status, 1 if any trace couldn't be read.
+//*****************************************************************************
+int main(int argc, char** argv)
+{
+   int failures = 0;
+   int files = 0;
+   FILE* file;
+   int i;
+
+   for (i = 1; i < argc; ++i)
+   {
+      if (strcmp(argv[i], "--range") == 0 && i + 2 < argc)
+      {
+         overrideLower = (UINT16)strtoul(argv[++i], NULL, 10);
+         overrideUpper = (UINT16)strtoul(argv[++i], NULL, 10);
+         if (overrideUpper <= overrideLower ||
+             overrideUpper - overrideLower < BUCKETS)
+         {
+            (void) fprintf(stderr, "%s: bad range\n", argv[0]);
+            return 2;
+         }
+         overrideRange = 1;
+      }
+      else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc)
+      {
+         mapCellsSet = (UINT16)strtoul(argv[++i], NULL, 10);
+         if (mapCellsSet < 2 ||
+             (unsigned long)mapCellsSet * mapCellsSet > MAP_CELLS_MAX)
+         {
+            (void) fprintf(stderr, "%s: bad map\n", argv[0]);
+            return 2;
+         }
+      }
+      else if (strcmp(argv[i], "--time") == 0)
+      {
+         timing = 1;
+      }
+      else if (argv[i][0] == '-')
+      {
+         (void) fprintf(stderr,
+            "usage: %s [--range <lowerUs> <upperUs>] [--map <cells>] [--time]"
+            " [file ...]\n", argv[0]);
+         return 2;
+      }
+      else
+      {
+         // the files are read once all the options are in.
+         argv[++files] = argv[i];
+      }
+   }
+
+   // The firmware's output goes out through SCI0_isr, which runs off the
+   // simulated clock. There are no edges and the port isn't paced.
+   HalHostSetPacing(0);
+   HalHostStartTimer(HAL_HOST_PRESCALE_SHIFT);
+
+   for (i = 1; i <= files; ++i)
+   {
+      file = fopen(argv[i], "r");
+      if (file == NULL)
+      {
+         perror(argv[i]);
+         ++failures;
+         continue;
+      }
+      failures += replayFile(file, argv[i]);
+      (void) fclose(file);
+   }
+
+   if (files == 0)
+   {
+      failures += replayFile(stdin, "stdin");
+   }
+
+   return failures ? 1 : 0;
+}
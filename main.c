@@ -20,14 +20,17 @@
 
 
 // system includes
-#include <hidef.h>      /* common defines and macros */
 #include <stdio.h>      /* Standard I/O Library */
-#include <ctype.h>
-#include <stdlib.h>
 
 // project includes
+#include "hal.h"        /* all register access goes through here */
 #include "types.h"
-#include "derivative.h" /* derivative-specific definitions */
+#include "format.h"     /* printf-free output for the reporting paths */
+#include "command.h"    /* line oriented command interpreter */
+#include "profile.h"    /* stage timing for the PROFILE command */
+#include "farcursor.h"  /* paged storage for deep captures */
+#include "ring.h"       /* the queues between the ISRs and the main loop */
+#include "task.h"       /* the cooperative scheduler the main loop runs */
 
 // Definitions
 
@@ -53,24 +56,147 @@
 // Boolean Definitions to make the code more readable.
 #define FALSE 0
 #define TRUE 1
+
+#ifdef CAPTURE_PAGED
+// Deep captures. The timer values are kept in paged memory from page
+// CAPTURE_FIRST_PAGE on, which takes 8 pages of the 16K window for the
+// largest capture and a part whose window is RAM: the host build, not the
+// DT256, which only pages its flash. OC1_isr still does a near store into
+// captureRing, CAPTURE_RING_SIZE values here, and drainCapture empties the
+// ring into the pages from the main loop. A full ring loses the edge, which
+// the edge count shows as a drop. The limit is what the 16-bit counts of
+// the protocol and the histogram can hold. The target build refuses it, see
+// hal_hcs12.h.
+#define MAXINPUTVALUES     65535u
+#define CAPTURE_RING_SIZE  128
+#ifndef CAPTURE_FIRST_PAGE
+#define CAPTURE_FIRST_PAGE 0x30
+#endif
+#define CAPTURE_ROOM()     (!RING_FULL(captureRing, CAPTURE_RING_SIZE))
+#define CAPTURE_STORED()   (captureRing.tail)
+#else
+// The ring holds the largest capture, so it never wraps and nothing takes
+// the values out: timer value i stays in timerValuesUs[i].
 #define MAXINPUTVALUES 1001
+#define CAPTURE_RING_SIZE  1024
+#define CAPTURE_ROOM()     (TRUE)
+#define CAPTURE_STORED()   (captureRing.head)
+#endif
+
+// Reads the timer values of a capture in order, from value i on. Through a
+// far cursor for a deep capture, through a near pointer otherwise.
+#ifdef CAPTURE_PAGED
+#define CAPTURE_READER             FarCursor
+#define CAPTURE_OPEN(reader, i)    \
+   FarCursorOpen(&(reader), CAPTURE_FIRST_PAGE, HAL_PAGE_WINDOW_START, (i))
+#define CAPTURE_READ(reader, value) FAR_CURSOR_READ(&(reader), value)
+#define CAPTURE_CLOSE(reader)      FarCursorClose(&(reader))
+#else
+#define CAPTURE_READER             const volatile UINT16*
+#define CAPTURE_OPEN(reader, i)    ((reader) = &timerValuesUs[i])
+#define CAPTURE_READ(reader, value) ((value) = *(reader)++)
+#define CAPTURE_CLOSE(reader)      ((void)0)
+#endif
+
+// Timer ticks in a millisecond, for the duration of a capture.
+#define CAPTURE_TICKS_PER_MS \
+   ((HAL_BUS_CLOCK_HZ >> HAL_TIMER_PRESCALE_SHIFT) / 1000UL)
+
+// Returned by processInterval for an interval outside of the range.
+#define NO_BUCKET (-1)
+
+// Live mode bandwidth budget. An update goes out every LIVE_UPDATE_OVERFLOWS
+// timer overflows (65.536 ms each at 1 MHz), and carries at most
+// LIVE_MAX_BUCKETS buckets. A LIVE line is at most 11 + 12 * LIVE_MAX_BUCKETS
+// characters, so this is about 59 characters every 197 ms, under a third of
+// the 9600 baud link. Buckets that don't fit are sent with the next update.
+#define LIVE_UPDATE_OVERFLOWS 3
+#define LIVE_MAX_BUCKETS      4
+
+// Size of the SCI0 receive buffer, a power of two. It only has to hold the
+// characters that come in during one pass of the tasks.
+#define RX_BUFFER_SIZE 32
+
+// Size of the ring the channel 2 edges of a skew capture wait in to be
+// paired, a power of two. pairSlice keeps up with them as they come, so it
+// only has to hold the ones that come in during a pass of the tasks.
+#define SKEW_RING_SIZE 64
+
+// Longest a channel 2 edge can wait behind OC1_isr and the other interrupts.
+// One that came up to this much before an A edge can still be stored after
+// it, see pairSlice.
+#define SKEW_EARLY_US 256
+
+// Most cells of the return map, see returnMap. 31 by 31 is the largest
+// square that fits.
+#define MAP_CELLS_MAX 1000
+
+// Most intervals a window capture keeps, see windowInterval.
+#define WINDOW_MAX 256
+
+// Number of percentiles a window capture tracks, see windowPercent.
+#define WINDOW_QUANTILES 2
+
+// Size of the SCI0 transmit buffer, a power of two. PutChar only waits for
+// the link once it is full, and a LIVE line always fits.
+#define TX_BUFFER_SIZE 128
+
+// Longest LIVE line, see LIVE_MAX_BUCKETS.
+#define LIVE_LINE_MAX  (11 + 12 * LIVE_MAX_BUCKETS)
+
+// Live mode. An update is due once LIVE_UPDATE_OVERFLOWS have gone by since
+// the last one went out and a whole LIVE line fits in txBuffer.
+#define LIVE_UPDATE_DUE() \
+   ((UINT16)(timerOverflows - liveLastOverflow) >= LIVE_UPDATE_OVERFLOWS && \
+    TX_BUFFER_SIZE - RING_COUNT(txRing) >= LIVE_LINE_MAX)
+
+// Most intervals a task bins in one slice. processInterval takes about 110
+// bus cycles an interval (host/binbench), so a slice is under 2 ms and a
+// pass of the tasks stays well inside the 33 ms it takes to fill rxBuffer
+// at 9600 baud.
+#define BIN_SLICE 32
+
+// The scheduler events, see task.h.
+#define EVENT_EDGE     0x01   // OC1_isr stored a timer value
+#define EVENT_PROCESS  0x02   // a finished capture is waiting to be binned
+#define EVENT_TICK     0x04   // TOF_isr counted an overflow
+#define EVENT_RX       0x08   // SCI0_isr received a character
 
 // Number of buckets in the histogram.
 const int numberOfBuckets = 100; 
 
-// This is a generic index.
-UINT16 index = 0;
+// The timer values OC1_isr has captured. head is the number it has stored
+// so far. For a deep capture tail is the number drainCapture has moved to
+// paged memory, otherwise it stays at 0.
+Ring captureRing = { 0, 0 };
 
 // Normally I'd use something awesome like a bool but we're stuck with this err
 // limited system.
 // This is used to let the program know when to capture values.
-UINT16 captureValues = FALSE;
+volatile UINT16 captureValues = FALSE;
+
+// Set from the last edge of a capture until processTask has binned it.
+UINT16 processing = FALSE;
+
+// Counts timer overflows, bumped by TOF_isr. Used as the slow clock for
+// anything that outlasts one trip round TCNT.
+volatile UINT16 timerOverflows = 0;
+
+// Characters received by SCI0_isr, taken out by PollChar.
+volatile UINT8 rxBuffer [RX_BUFFER_SIZE];
+Ring rxRing = { 0, 0 };
+
+// Characters dropped because rxBuffer was full.
+volatile UINT16 rxOverruns = 0;
 
-// holds the timer values captured on the rising edge.
-UINT16 timerValuesUs [1001] = { 0 };
+// Characters queued by PutChar, sent by SCI0_isr.
+volatile UINT8 txBuffer [TX_BUFFER_SIZE];
+Ring txRing = { 0, 0 };
 
-// holds the time inteval between rising edges.
-UINT16 pulseIntervalsUs [1000] = { 0 };
+// holds the timer values captured on the rising edge, the buffer of
+// captureRing. For a deep capture they only wait here to be moved to paged
+// memory.
+volatile UINT16 timerValuesUs [CAPTURE_RING_SIZE] = { 0 };
 
 // holds the minimum time value for each histogram bucket.
 UINT16 minimumHistogramValueUs [100] = { 0 };
@@ -78,214 +204,1385 @@ UINT16 minimumHistogramValueUs [100] = { 0 };
 // holds the minimum time value for each histogram bucket.
 UINT16 histogram [100] = { 0 };
 
-// I prefer the new school method of declaring functions at the top of the file HR.
-void displayResults(void);
-void getMeasurements(void);
-void getMoronsInput(UINT16* lowerBoundaryUs, UINT16* upperBoundaryUs);
-UINT16 getUINT16Input(void);
-UINT16 post_function(void);
-void processTimerMeasurements(UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs);
+// Size of each histogram bucket for the current range.
+UINT16 bucketWidthUs = 1;
 
-// Initializes SCI0 for 8N1, 9600 baud, polled I/O
-// The value for the baud selection registers is determined
-// using the formula:
-//
-// SCI0 Baud Rate = ( 2 MHz Bus Clock ) / ( 16 * SCI0BD[12:0] )
-//--------------------------------------------------------------
-void InitializeSerialPort(void)
-{
-    // Set baud rate to ~9600 (See above formula)
-    SCI0BD = 13;          
-    
-    // 8N1 is default, so we don't have to touch SCI0CR1.
-    // Enable the transmitter and receiver.
-    SCI0CR2_TE = 1;
-    SCI0CR2_RE = 1;
-}
+// Summary of the last capture, filled in by processTimerMeasurements.
+// The sum is kept in 32 bits so the mean of 1000 intervals can't overflow.
+UINT16 belowRangeCount = 0;
+UINT16 aboveRangeCount = 0;
+UINT16 minimumIntervalUs = 0;
+UINT16 maximumIntervalUs = 0;
+UINT32 intervalSumUs = 0;
 
+// Number of intervals in the last completed capture.
+UINT16 intervalCount = 0;
 
-// Initializes I/O and timer settings for the demo.
-//--------------------------------------------------------------       
-void InitializeTimer(void)
-{
-  // Set the timer prescaler to %2, since the bus clock is at 2 MHz,
-  // and we want the timer running at 1 MHz
-  TSCR2_PR0 = 1;
-  TSCR2_PR1 = 0;
-  TSCR2_PR2 = 0;       
-    
-  // Change to an input compare. HR 
-  // Enable input capture on Channel 1  
-  TIOS_IOS1 = 0;
-  
-  
-  // Set up input capture edge control to capture on a rising edge. 
-  TCTL4_EDG1A = 1;
-  TCTL4_EDG1B = 0;
-   
-  // from here down we want this code. HR.
-  // Clear the input capture Interrupt Flag (Channel 1) 
-  TFLG1 = TFLG1_C1F_MASK;
-  
-  // Enable the input capture interrupt on Channel 1;
-  TIE_C1I = 1;  
-  
-  //
-  // Enable the timer
-  // 
-  TSCR1_TEN = 1;
-   
-  //
-  // Enable interrupts via macro provided by hidef.h
-  //
-  EnableInterrupts;
-}
+// Pulse accumulator readings at the start of the capture and at its last
+// edge, and the edges the capture missed in between, modulo 256.
+UINT8 captureStartEdges = 0;
+volatile UINT8 captureEndEdges = 0;
+UINT8 captureDrops = 0;
+
+// Glitch rejection, set by the GLITCH command. An edge that comes less than
+// glitchMinimumUs after the last one captured is taken for noise, left out
+// of the capture and counted in glitchRejected. 0 turns it off.
+UINT16 glitchMinimumUs = 0;
+volatile UINT16 glitchRejected = 0;
+
+// Timer value of the last edge captured, what OC1_isr measures against.
+UINT16 captureLast = 0;
+
+// Skew capture, started by SKEW instead of CAPTURE. Channel 1 is the A
+// signal and channel 2 the B signal. Each A edge is paired with the first B
+// edge that comes before the next A edge, and the histogram is of the A to
+// B delays instead of the intervals. IC2_isr puts the B edges in skewRing
+// and pairSlice takes them out as it pairs them. Along with each one goes
+// the number of A edges stored when it came in, which places it among them
+// however far apart they are.
+UINT16 skewCapture = FALSE;
+volatile UINT16 skewValuesUs [SKEW_RING_SIZE];
+volatile UINT16 skewAEdges [SKEW_RING_SIZE];
+Ring skewRing = { 0, 0 };
+
+// Set once the A edge being paired has its B edge.
+UINT16 skewPartnered = FALSE;
+
+// A edges paired, A edges with no B edge before the next one, B edges that
+// came after the partner of the same A edge or before the first A edge, and
+// B edges lost to a full skewRing. Every B edge captured is one of them.
+UINT16 skewPairs = 0;
+UINT16 skewMissing = 0;
+UINT16 skewExtra = 0;
+volatile UINT16 skewLost = 0;
+
+// Number of timer values the capture in progress collects. That's one more
+// than the number of intervals asked for. OC1_isr stops storing once head
+// gets to it, so a window capture, which keeps taking the values out, moves
+// it on to a ring full past tail as it goes, see windowSlice, and OC3_isr
+// moves it back to head when the time is up.
+volatile UINT16 captureTarget = MAXINPUTVALUES;
+
+// Capture given a duration. The channel 3 compares still to come before it
+// is up, counted down by OC3_isr, and whether it ended the last capture
+// before all its edges were in.
+volatile UINT16 captureComparesLeft = 0;
+volatile UINT16 captureTimedOut = FALSE;
+
+// Histogram range set by the RANGE command. Nothing can be captured until
+// a range has been given.
+UINT16 rangeLowerUs = 0;
+UINT16 rangeUpperUs = 0;
+UINT16 rangeSet = FALSE;
+
+// Return map, turned on by MAP. A 2D histogram of each interval against the
+// one after it, mapCells by mapCells over the histogram range on both axes,
+// that shows patterns like alternating long and short intervals the
+// histogram can't. The pairs with the first interval in cell x and the
+// second in cell y are counted at returnMap[y * mapCells + x]. It has the
+// RAM the table of intervals had before they were worked out on the fly.
+UINT16 returnMap [MAP_CELLS_MAX] = { 0 };
+
+// Cells a side set by MAP for the captures from now on, 0 for no map, and
+// the ones the map of the last capture has.
+UINT16 mapCellsSet = 0;
+UINT16 mapCells = 0;
+
+// Width of a cell of the map, the pairs counted in it, and the cell of the
+// last interval binned, NO_BUCKET if it was out of range.
+UINT16 mapCellWidthUs = 1;
+UINT16 mapPairs = 0;
+int mapLastCell = NO_BUCKET;
+
+// Window capture, started by WINDOW. It runs until it is stopped and keeps
+// the histogram of the last windowSize intervals only, for watching a
+// process drift. The intervals in the window and where each of them went,
+// 0 for below the range, the bucket + 1 or numberOfBuckets + 1 for above,
+// are kept in a ring, windowNext is the slot of the oldest once it's full.
+// windowSize is 0 when the last capture wasn't a window capture.
+UINT16 windowIntervalsUs [WINDOW_MAX] = { 0 };
+UINT8 windowPositions [WINDOW_MAX] = { 0 };
+UINT16 windowSize = 0;
+UINT16 windowCount = 0;
+UINT16 windowNext = 0;
+
+// Window capture. The last timer value taken out of captureRing, once
+// windowStarted says there has been one.
+UINT16 windowPrevious = 0;
+UINT8 windowStarted = FALSE;
+
+// Window capture. The percentiles POLL reports, and where each of them is:
+// the position the interval at its rank is in and the number of intervals
+// in the window below that position. They are moved along as the intervals
+// come and go, so reading them doesn't take a walk over the histogram.
+const UINT8 windowPercent [WINDOW_QUANTILES] = { 50, 99 };
+UINT8 windowQuantilePosition [WINDOW_QUANTILES] = { 0 };
+UINT16 windowQuantileBelow [WINDOW_QUANTILES] = { 0 };
 
+// MODE_BATCH dumps the results in one go in the fixed layout written by
+// dumpResults.
+// MODE_PAGED shows them one key at a time with displayResults, and DONE
+// says how many intervals were out of the range.
+// MODE_LIVE bins each interval as it arrives and streams the changed buckets
+// while the capture runs, DUMP then works the same as in MODE_BATCH.
+UINT16 outputMode = MODE_BATCH;
+
+// The outputMode the last capture was made in, for its trace. MODE can
+// change outputMode once the capture is done.
+UINT16 captureMode = MODE_BATCH;
+
+// Number of timer values of the capture binned so far, the first one
+// only starts the clock. For a skew capture, the number of A edges paired.
+// The live mode updates report it.
+UINT16 binIndex = 0;
+
+// Live mode. One bit per bucket that changed since it was last sent.
+UINT8 liveChangedBuckets [(100 + 7) / 8] = { 0 };
+
+// Live mode. Bucket the next update starts looking from, so a busy low
+// bucket can't keep the higher ones from ever being sent.
+int liveNextBucket = 0;
+
+// Live mode. Value of timerOverflows when the last update went out. An
+// update held back doesn't bring the next one forward.
+UINT16 liveLastOverflow = 0;
+
+// I prefer the new school method of declaring functions at the top of the file HR.
+// They are grouped the way they are placed, see hal.h. The tasks stay in
+// the default segment, see task.c.
+UINT16 executeCommand(const Command* command);
+UINT8 captureTask(void);
+UINT8 processTask(void);
+UINT8 liveTask(void);
+UINT8 commandTask(void);
+
+// The capture, the binning and the output.
+#include "hal_hot_begin.h"
+UINT8 binSlice(void);
+void clearTable(UINT8* table, UINT16 bytes);
+UINT8 pairSlice(void);
+void dumpMap(void);
+void dumpResults(UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs);
+void finishCapture(void);
+void mapInterval(UINT16 intervalUs, UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs);
+int processInterval(UINT16 intervalUs, UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs);
+void reportStats(void);
+void reportWindow(void);
+void resetResults(UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs);
+void sendLiveUpdate(void);
+void traceResults(void);
+void startCapture(UINT16 intervals, UINT16 skew, UINT16 durationMs);
+void startWindow(UINT16 intervals);
+void stopWindow(void);
+void windowInterval(UINT16 intervalUs);
+UINT16 windowPositionCount(UINT8 position);
+UINT8 windowSlice(void);
+#ifdef CAPTURE_PAGED
+void drainCapture(void);
+#endif
+void processTimerMeasurements(UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs);
+#include "hal_hot_end.h"
+
+// Code that runs once or at the user's pace.
+#include "hal_cold_begin.h"
+void displayResults(void);
+void FlushOutput(void);
+UINT8 GetChar(void);
+UINT16 post_function(void);
+void TERMIO_PutChar(INT8 ch);
+#include "hal_cold_end.h"
 
 // Output Compare Channel 1 Interrupt Service Routine
 // Refreshes TC1 and clears the interrupt flag.
+//
+// InitializeTimer makes this the highest priority interrupt, and
+// it measures its own latency for the PROFILE report.
 //          
-// The first CODE_SEG pragma is needed to ensure that the ISR
-// is placed in non-banked memory. The following CODE_SEG
-// pragma returns to the default scheme. This is neccessary
-// when non-ISR code follows. 
-//
-// The TRAP_PROC tells the compiler to implement an
-// interrupt funcion. Alternitively, one could use
-// the __interrupt keyword instead.
+// hal_isr_begin.h places the ISR in non-banked memory and
+// hal_isr_end.h returns to the default scheme.
 // 
 // The following line must be added to the Project.prm
 // file in order for this ISR to be placed in the correct
 // location:
 //		VECTOR ADDRESS 0xFFEC OC1_isr 
-#pragma push
-#pragma CODE_SEG __SHORT_SEG NON_BANKED
+#include "hal_isr_begin.h"
 //--------------------------------------------------------------       
-void interrupt 9 OC1_isr( void )
+HAL_ISR(9, OC1_isr)
 {
+   UINT16 capture;
+   
    // This interrupt stores the values from the table into the array.
    // we don't want to do any calculations because we are dealing with
    // Us and want the reads to be as accurate as possible.
   
-   if (captureValues == TRUE && index < MAXINPUTVALUES) 
+   if (captureValues == TRUE && captureRing.head != captureTarget && 
+       CAPTURE_ROOM()) 
    {
-    
-      timerValuesUs[index] = TC1;
-      ++index;      
+      capture = HAL_READ_CAPTURE1();
+      PROFILE_LATENCY(capture);
+      
+      // an edge too soon after the last one is a glitch. The first edge of
+      // a capture has nothing to be measured against and is always kept.
+      if (captureRing.head != 0 && 
+          (UINT16)(capture - captureLast) < glitchMinimumUs) 
+      {
+         ++glitchRejected;
+      }
+      else 
+      {
+         RING_PUT(captureRing, timerValuesUs, CAPTURE_RING_SIZE, capture);
+         captureLast = capture;
+         
+         // note the edge count at the last edge, for the drop count.
+         if (captureRing.head == captureTarget) 
+         {
+            captureEndEdges = HAL_READ_EDGE_COUNT();
+         }
+         TASK_RAISE(EVENT_EDGE);
+      }
    }
    
    // set the interrupt enable flag for that port because it is cleared every
    // everytime an interrupt fires.
-   TFLG1   =   TFLG1_C1F_MASK;
+   HAL_CLEAR_CAPTURE1_FLAG();
 }
-#pragma pop
+#include "hal_isr_end.h"
 
-// This function is called by printf in order to
-// output data. Our implementation will use polled
-// serial I/O on SCI0 to output the character.
+// Input Capture Channel 2 Interrupt Service Routine
+// Stores the B edges of a skew capture for pairSlice, and clears the
+// interrupt flag. It is only turned on while a skew capture runs, and
+// leaves the pairing, with the wrap round and the missing edges, to the
+// main loop, so it stays as short as OC1_isr.
+//
+// The following line must be added to the Project.prm file:
+//		VECTOR ADDRESS 0xFFEA IC2_isr 
+#include "hal_isr_begin.h"
+//--------------------------------------------------------------       
+HAL_ISR(10, IC2_isr)
+{
+   // a B edge before the first A edge has nothing to be paired with.
+   if (captureValues == TRUE && captureRing.head != 0) 
+   {
+      if (RING_FULL(skewRing, SKEW_RING_SIZE)) 
+      {
+         ++skewLost;
+      }
+      else 
+      {
+         skewAEdges[skewRing.head & (SKEW_RING_SIZE - 1)] = captureRing.head;
+         RING_PUT(skewRing, skewValuesUs, SKEW_RING_SIZE, HAL_READ_CAPTURE2());
+         TASK_RAISE(EVENT_EDGE);
+      }
+   }
+   
+   HAL_CLEAR_CAPTURE2_FLAG();
+}
+#include "hal_isr_end.h"
+
+// Output Compare Channel 3 Interrupt Service Routine
+// Ends a capture given a duration when the time is up, and clears the
+// interrupt flag. The compare comes round every trip of the timer, and
+// startCapture sets it up so the last one it counts is at the end. The
+// capture is cut short by bringing captureTarget down to the timer values
+// stored, so OC1_isr stores no more and captureTask finishes it as if they
+// were all it had asked for. It is only turned on while such a capture
+// runs.
+//
+// The following line must be added to the Project.prm file:
+//		VECTOR ADDRESS 0xFFE8 OC3_isr 
+#include "hal_isr_begin.h"
+//--------------------------------------------------------------       
+HAL_ISR(11, OC3_isr)
+{
+   if (--captureComparesLeft == 0) 
+   {
+      HAL_COMPARE3_INTERRUPT_OFF();
+      
+      // the last edge can have come in just before.
+      if (captureValues == TRUE && captureRing.head != captureTarget) 
+      {
+         captureTarget = captureRing.head;
+         captureEndEdges = HAL_READ_EDGE_COUNT();
+         captureTimedOut = TRUE;
+         TASK_RAISE(EVENT_EDGE);
+      }
+   }
+   
+   HAL_CLEAR_COMPARE3_FLAG();
+}
+#include "hal_isr_end.h"
+
+// Timer Overflow Interrupt Service Routine
+// Counts the overflows and clears the interrupt flag.
+//
+// The following line must be added to the Project.prm file:
+//		VECTOR ADDRESS 0xFFDE TOF_isr 
+#include "hal_isr_begin.h"
+//--------------------------------------------------------------       
+HAL_ISR(16, TOF_isr)
+{
+   ++timerOverflows;
+   HAL_CLEAR_OVERFLOW_FLAG();
+   TASK_RAISE(EVENT_TICK);
+}
+#include "hal_isr_end.h"
+
+// SCI0 Interrupt Service Routine
+// Moves a received character into rxBuffer. Reading SCI0SR1 and then
+// SCI0DRL clears RDRF, and an overrun along with it.
+//
+// Sends the next character from txBuffer when the transmit data register
+// is free. PutChar turns the transmit interrupt on after it queues one,
+// and it is turned off here once there is nothing left to send.
+//
+// It moves at most one character each way and leaves the rest to the
+// tasks, so it holds up a capture for as short a time as it can. It
+// only touches its own end of each ring, so the main loop never has to
+// mask it.
+//
+// The following line must be added to the Project.prm file:
+//		VECTOR ADDRESS 0xFFD6 SCI0_isr 
+#include "hal_isr_begin.h"
+//--------------------------------------------------------------       
+HAL_ISR(20, SCI0_isr)
+{
+   UINT8 ch;
+   
+   if (HAL_SCI_RECEIVED()) 
+   {
+      ch = HAL_SCI_READ();
+      if (!RING_FULL(rxRing, RX_BUFFER_SIZE)) 
+      {
+         RING_PUT(rxRing, rxBuffer, RX_BUFFER_SIZE, ch);
+      } 
+      else 
+      {
+         ++rxOverruns;
+      }
+      TASK_RAISE(EVENT_RX);
+   }
+   
+   if (HAL_SCI_TRANSMIT_READY()) 
+   {
+      if (!RING_EMPTY(txRing)) 
+      {
+         RING_GET(txRing, txBuffer, TX_BUFFER_SIZE, ch);
+         HAL_SCI_WRITE(ch);
+      }
+      if (RING_EMPTY(txRing)) 
+      {
+         HAL_SCI_TRANSMIT_INTERRUPT_OFF();
+      }
+   }
+}
+#include "hal_isr_end.h"
+
+// Sends one character. It is queued in txBuffer for SCI0_isr,
+// so the caller only waits on the link when the buffer is
+// full, sleeping until the interrupt has made room. All of
+// the output goes through here, so it is kept near.
 //
-// Remember to call InitializeSerialPort() before using printf!
+// Remember to call InitializeSerialPort() before using it!
 //
 // Parameters: character to output
 //--------------------------------------------------------------       
-void TERMIO_PutChar(INT8 ch)
+#include "hal_hot_begin.h"
+void PutChar(INT8 ch)
 {
-    // Poll for the last transmit to be complete
-    do
+    for (;;)
     {
-      // Nothing  
-    } while (SCI0SR1_TC == 0);
+      HAL_DISABLE_INTERRUPTS();
+      if (!RING_FULL(txRing, TX_BUFFER_SIZE)) 
+      {
+        HAL_ENABLE_INTERRUPTS();
+        break;
+      }
+      HAL_SLEEP_UNTIL_INTERRUPT();
+    }
     
-    // write the data to the output shift register
-    SCI0DRL = ch;
+    // queue it first, so the interrupt always finds it.
+    RING_PUT(txRing, txBuffer, TX_BUFFER_SIZE, (UINT8)ch);
+    HAL_SCI_TRANSMIT_INTERRUPT_ON();
+    PROFILE_BYTE();
+}
+#include "hal_hot_end.h"
+
+// This function is called by printf in order to
+// output data. printf is only used by the cold code,
+// and the library calls this with CALL, so it stays far.
+//
+// Parameters: character to output
+//--------------------------------------------------------------       
+#include "hal_cold_begin.h"
+void TERMIO_PutChar(INT8 ch)
+{
+    PutChar(ch);
 }
 
 
-// Polls for a character on the serial port.
+// Waits for a character on the serial port, sleeping until one
+// has been received.
 //
 // Returns: Received character
 //--------------------------------------------------------------       
 UINT8 GetChar(void)
 { 
-  // Poll for data
-  do
+  UINT8 ch = 0;
+  
+  for (;;)
+  {
+    HAL_DISABLE_INTERRUPTS();
+    if (!RING_EMPTY(rxRing)) 
+    {
+      HAL_ENABLE_INTERRUPTS();
+      break;
+    }
+    HAL_SLEEP_UNTIL_INTERRUPT();
+  }
+  
+  (void) PollChar(&ch);
+  return ch;
+}
+
+
+// Waits for everything PutChar has queued to go out, before
+// the program ends.
+//--------------------------------------------------------------       
+void FlushOutput(void)
+{ 
+  for (;;)
   {
-    // Nothing
-  } while(SCI0SR1_RDRF == 0);
+    HAL_DISABLE_INTERRUPTS();
+    if (RING_EMPTY(txRing)) 
+    {
+      HAL_ENABLE_INTERRUPTS();
+      break;
+    }
+    HAL_SLEEP_UNTIL_INTERRUPT();
+  }
+}
+
+#include "hal_cold_end.h"
+
+
+// Checks for a received character without waiting.
+//
+// Parameters: where to store the character
+//
+// Returns: TRUE if a character was read
+//--------------------------------------------------------------       
+UINT8 PollChar(UINT8* ch)
+{ 
+  if (RING_EMPTY(rxRing)) 
+  {
+    return FALSE;
+  }
    
-  // Fetch and return data from SCI0
-  return SCI0DRL;
+  RING_GET(rxRing, rxBuffer, RX_BUFFER_SIZE, *ch);
+  return TRUE;
 }
 
 
+// The main loop, highest priority first. The capture comes first
+// so its ring is emptied before anything else runs, and the
+// commands last because the user can wait a pass.
+const Task tasks[] = 
+{
+  { EVENT_EDGE,    captureTask },
+  { EVENT_PROCESS, processTask },
+  { EVENT_TICK,    liveTask },
+  { EVENT_RX,      commandTask }
+};
+#define TASKS ((UINT8)(sizeof(tasks) / sizeof(tasks[0])))
+
+
 // Entry point of our application code
 //--------------------------------------------------------------       
 void main(void)
 {
-
-  UINT8 userInput = 0;
-  UINT16 lowerBoundaryUs = 0;
-  UINT16 upperBoundaryUs = 0;
-  
-  InitializeSerialPort();
-  InitializeTimer();
-   
-  // Post function
+
+  InitializeSerialPort();
+  InitializeTimer();
+   
+  // Post function
+  
+  // if we pass post run the program otherwise go home.
+  if(post_function()) 
+  {
+     // Explain the program to the user.
+     (void) printf("Histogram of rising edge interarrival times, with the lowest\r\n");
+     (void) printf("arrival time of each of the 100 buckets. One command per line:\r\n");
+     (void) printf("  RANGE lo hi   CAPTURE n [ms]   SKEW n [ms]   GLITCH us\r\n");
+     (void) printf("  MODE BATCH|PAGED|LIVE\r\n");
+     (void) printf("  MAP n   WINDOW n   POLL   DUMP   DUMPMAP   STATS   TRACE   RESET\r\n");
+     (void) printf("  PROFILE   EXIT\r\n");
+     PutString("READY\r\n");
+  
+     //start of main loop, it runs until the EXIT command.
+     TaskRun(tasks, TASKS);
+  }
+  
+  (void) printf("\r\n\r\nOk I'm outa here!!!\r\n\r\n");
+  FlushOutput();
+}
+
+//*****************************************************************************
+// Carries out one parsed command and acknowledges it. Every command answers
+// with exactly one line that starts with OK or ERR, so a host script can wait
+// for that line before sending the next command. A capture answers once more
+// with DONE when its last edge has been processed, or what it got by the
+// end of its duration.
+//
+// Parameters:
+//    command  The command to run.
+//
+// Return: FALSE when the program should end, otherwise TRUE.
+//*****************************************************************************
+UINT16 executeCommand(const Command* command) 
+{
+  UINT8 step = 0;
+  UINT16 intervals = 0;
+  UINT16 durationMs = 0;
+  
+  // a capture in progress owns the tables until it has been binned, only
+  // RESET may touch them. WINDOW 0 stops a window capture. PROFILE's report
+  // is more than txBuffer holds, it would wait on the link with the capture
+  // running.
+  if ((captureValues == TRUE || processing == TRUE) && 
+     (command->id == CMD_RANGE || command->id == CMD_CAPTURE || 
+      command->id == CMD_DUMP || command->id == CMD_STATS || 
+      command->id == CMD_TRACE || command->id == CMD_GLITCH || 
+      command->id == CMD_SKEW || command->id == CMD_MAP || 
+      command->id == CMD_DUMPMAP || command->id == CMD_PROFILE || 
+      (command->id == CMD_WINDOW && command->args[0] != 0))) 
+  {
+     PutString("ERR BUSY\r\n");
+     return TRUE;
+  }
+  
+  switch (command->id) 
+  {
+    case CMD_RANGE:
+       // each bucket has to be at least 1 us wide.
+       if (command->args[0] >= command->args[1] || 
+           command->args[1] - command->args[0] < (UINT16)numberOfBuckets) 
+       {
+          PutString("ERR BAD RANGE\r\n");
+          break;
+       }
+       rangeLowerUs = command->args[0];
+       rangeUpperUs = command->args[1];
+       rangeSet = TRUE;
+       PutString("OK RANGE ");
+       PutUnsigned(rangeLowerUs);
+       PutChar(' ');
+       PutUnsigned(rangeUpperUs);
+       PutNewLine();
+       break;
+       
+    case CMD_CAPTURE:
+    case CMD_SKEW:
+       if (!rangeSet) 
+       {
+          PutString("ERR NO RANGE\r\n");
+          break;
+       }
+       // with a duration, a count of 0 is as many as there's room for.
+       intervals = command->args[0];
+       durationMs = (command->argCount > 1) ? command->args[1] : 0;
+       if (intervals == 0 && durationMs != 0) 
+       {
+          intervals = MAXINPUTVALUES - 1;
+       }
+       if (intervals == 0 || intervals > MAXINPUTVALUES - 1) 
+       {
+          PutString("ERR BAD COUNT\r\n");
+          break;
+       }
+       PutString((command->id == CMD_SKEW) ? "OK SKEW " : "OK CAPTURE ");
+       PutUnsigned(intervals);
+       if (durationMs != 0) 
+       {
+          PutChar(' ');
+          PutUnsigned(durationMs);
+       }
+       PutNewLine();
+       startCapture(intervals, command->id == CMD_SKEW, durationMs);
+       break;
+       
+    case CMD_MODE:
+       // the live bookkeeping is set up when the capture starts.
+       if (captureValues == TRUE || processing == TRUE) 
+       {
+          PutString("ERR BUSY\r\n");
+          break;
+       }
+       outputMode = command->args[0];
+       PutString("OK MODE\r\n");
+       break;
+       
+    case CMD_DUMP:
+    case CMD_STATS:
+    case CMD_TRACE:
+    case CMD_DUMPMAP:
+       if (intervalCount == 0) 
+       {
+          PutString("ERR NO DATA\r\n");
+          break;
+       }
+       if (command->id == CMD_DUMPMAP && 
+           (mapCells == 0 || skewCapture == TRUE || windowSize != 0)) 
+       {
+          PutString("ERR NO MAP\r\n");
+          break;
+       }
+       if (command->id == CMD_TRACE && (skewCapture == TRUE || windowSize != 0)) 
+       {
+          // the B edges aren't kept once they are paired, and the timer
+          // values of a window capture once they are binned.
+          PutString("ERR NO TRACE\r\n");
+          break;
+       }
+       PutString("OK\r\n");
+       PROFILE_START(PROFILE_OUTPUT);
+       if (command->id == CMD_STATS) 
+       {
+          reportStats();
+       }
+       else if (command->id == CMD_TRACE) 
+       {
+          traceResults();
+       }
+       else if (command->id == CMD_DUMPMAP) 
+       {
+          dumpMap();
+       }
+       else if (outputMode == MODE_PAGED) 
+       {
+          displayResults();
+       }
+       else 
+       {
+          dumpResults(rangeLowerUs, rangeUpperUs);
+       }
+       PROFILE_STOP(PROFILE_OUTPUT, 0);
+       break;
+       
+    case CMD_GLITCH:
+       // the delay counter throws the narrowest glitches away before they
+       // cost an interrupt. It gets the longest step up to half the minimum,
+       // so a square wave at the minimum interval still gets through, and
+       // OC1_isr filters whatever is left by the interval.
+       while (step < HAL_CAPTURE_DELAY_STEPS && 
+              HAL_CAPTURE_DELAY_CYCLES(step + 1) <= 
+              (UINT32)command->args[0] * (HAL_BUS_CLOCK_HZ / 1000000UL) / 2) 
+       {
+          ++step;
+       }
+       HAL_SET_CAPTURE_DELAY(step);
+       glitchMinimumUs = command->args[0];
+       PutString("OK GLITCH ");
+       PutUnsigned(glitchMinimumUs);
+       PutChar(' ');
+       PutUnsigned(step ? (UINT16)HAL_CAPTURE_DELAY_CYCLES(step) : 0);
+       PutNewLine();
+       break;
+       
+    case CMD_MAP:
+       // 1 cell would only count the pairs that are in range.
+       if (command->args[0] == 1 || 
+           (UINT32)command->args[0] * command->args[0] > MAP_CELLS_MAX) 
+       {
+          PutString("ERR BAD MAP\r\n");
+          break;
+       }
+       mapCellsSet = command->args[0];
+       PutString("OK MAP ");
+       PutUnsigned(mapCellsSet);
+       PutNewLine();
+       break;
+       
+    case CMD_WINDOW:
+       if (command->args[0] == 0) 
+       {
+          if (captureValues != TRUE || windowSize == 0) 
+          {
+             PutString("ERR NO WINDOW\r\n");
+             break;
+          }
+          stopWindow();
+          PutString("OK WINDOW 0\r\n");
+          break;
+       }
+       if (!rangeSet) 
+       {
+          PutString("ERR NO RANGE\r\n");
+          break;
+       }
+       if (command->args[0] > WINDOW_MAX) 
+       {
+          PutString("ERR BAD COUNT\r\n");
+          break;
+       }
+       PutString("OK WINDOW ");
+       PutUnsigned(command->args[0]);
+       PutNewLine();
+       startWindow(command->args[0]);
+       break;
+       
+    case CMD_POLL:
+       // what's in the window now, or was when it was stopped.
+       if (windowSize == 0) 
+       {
+          PutString("ERR NO WINDOW\r\n");
+          break;
+       }
+       PutString("OK ");
+       reportWindow();
+       break;
+       
+    case CMD_PROFILE:
+       // the last run of each stage, a capture in progress doesn't count.
+       PutString("OK\r\n");
+       ProfileReport();
+       break;
+       
+    case CMD_RESET:
+       // drop any capture in progress and the results of the last one.
+       captureValues = FALSE;
+       processing = FALSE;
+       HAL_CAPTURE2_INTERRUPT_OFF();
+       HAL_COMPARE3_INTERRUPT_OFF();
+       skewCapture = FALSE;
+       windowSize = 0;
+       RING_RESET(captureRing);
+       intervalCount = 0;
+       captureDrops = 0;
+       glitchRejected = 0;
+       resetResults(rangeLowerUs, rangeUpperUs);
+       PutString("OK RESET\r\n");
+       break;
+       
+    case CMD_EXIT:
+       PutString("OK EXIT\r\n");
+       return FALSE;
+       
+    default:
+       PutString("ERR ");
+       PutString(command->error);
+       PutNewLine();
+       break;
+  }
+  
+  return TRUE;
+}
+
+//*****************************************************************************
+// Task, on an edge. Moves a deep capture's timer values on to paged memory,
+// hands the capture over to processTask once its last edge is in and, in
+// live mode, bins a slice of what has come in so far. A skew capture is
+// paired a slice at a time as it comes in, in every mode, which keeps
+// skewRing from filling up, and a window capture is binned straight out of
+// captureRing.
+//
+// Parameters: None.
+//
+// Return: TRUE while there are intervals left to bin.
+//*****************************************************************************
+UINT8 captureTask(void) 
+{
+  if (captureValues != TRUE) 
+  {
+     return FALSE;
+  }
+  
+  if (windowSize != 0) 
+  {
+     return windowSlice();
+  }
+  
+#ifdef CAPTURE_PAGED
+  drainCapture();
+#endif
+  
+  if (CAPTURE_STORED() >= captureTarget) 
+  {
+     finishCapture();
+     return FALSE;
+  }
+  
+  if (skewCapture == TRUE) 
+  {
+     return pairSlice();
+  }
+  return (outputMode == MODE_LIVE) ? binSlice() : FALSE;
+}
+
+//*****************************************************************************
+// Task, once a capture is finished. Builds the histogram a slice at a time
+// and tells the host it's done. In live mode most of it has been binned
+// already, what's left is sending every bucket that is still outstanding,
+// at the same pace as the updates during the capture. liveTask brings it
+// back when the next one is due.
+//
+// Parameters: None.
+//
+// Return: TRUE until the capture is done.
+//*****************************************************************************
+UINT8 processTask(void) 
+{
+  if (processing != TRUE) 
+  {
+     return FALSE;
+  }
+  
+  if ((skewCapture == TRUE) ? pairSlice() : binSlice()) 
+  {
+     return TRUE;
+  }
+  
+  if (outputMode == MODE_LIVE && liveNextBucket != NO_BUCKET) 
+  {
+     if (!LIVE_UPDATE_DUE()) 
+     {
+        return FALSE;
+     }
+     liveLastOverflow = timerOverflows;
+     sendLiveUpdate();
+     return TRUE;
+  }
+  
+  processing = FALSE;
+  PROFILE_STOP(PROFILE_PROCESS, intervalCount);
+  
+  PutString((skewCapture == TRUE) ? "DONE SKEW " : "DONE CAPTURE ");
+  PutUnsigned(intervalCount);
+  if (captureTimedOut == TRUE) 
+  {
+     PutString(" TIMEOUT");
+  }
+  if (outputMode == MODE_PAGED) 
+  {
+     PutString(" OUTOFRANGE ");
+     PutUnsigned(belowRangeCount);
+     PutChar(' ');
+     PutUnsigned(aboveRangeCount);
+  }
+  PutNewLine();
+  return FALSE;
+}
+
+//*****************************************************************************
+// Task, on a timer overflow. Live mode. Sends an update of the changed
+// buckets when one is due. The update clock ticks off the overflows, so it
+// keeps going when no edges are coming in. An update that wouldn't fit in
+// txBuffer waits for a later tick rather than hold up the capture. Once the
+// capture has finished, processTask sends the updates and this only wakes
+// it when one is due.
+//
+// Parameters: None.
+//
+// Return: FALSE, the next tick brings it back.
+//*****************************************************************************
+UINT8 liveTask(void) 
+{
+  if (outputMode == MODE_LIVE && LIVE_UPDATE_DUE()) 
+  {
+     if (captureValues == TRUE) 
+     {
+        liveLastOverflow = timerOverflows;
+        sendLiveUpdate();
+     }
+     else if (processing == TRUE) 
+     {
+        // the updates that finish the capture are sent by processTask.
+        TASK_RAISE(EVENT_PROCESS);
+     }
+  }
+  
+  return FALSE;
+}
+
+//*****************************************************************************
+// Task, on a received character. Runs the command once its line is in,
+// one command a slice. CommandPoll never waits for input, so the capture
+// keeps getting its turn while a command is being typed.
+//
+// Parameters: None.
+//
+// Return: TRUE while there are characters left to read.
+//*****************************************************************************
+UINT8 commandTask(void) 
+{
+  Command command;
+  
+  if (CommandPoll(&command) != CMD_NONE && !executeCommand(&command)) 
+  {
+     TaskStop();
+     return FALSE;
+  }
+  
+  return !RING_EMPTY(rxRing);
+}
+
+// Everything from here to displayResults is on the capture's hot path.
+#include "hal_hot_begin.h"
+
+//*****************************************************************************
+// Clears out the tables and arms the input capture interrupt to record the
+// rising edges. This returns right away, captureTask picks the capture up
+// again once the last edge is in.
+//
+// Parameters:
+//    intervals   Number of intervals to capture, 1 to MAXINPUTVALUES - 1.
+//                For a skew capture, the number of A edges to pair.
+//    skew        TRUE for a skew capture.
+//    durationMs  Longest the capture can take, 0 for no limit. OC3_isr
+//                cuts it short with what it has by then.
+//
+// Return: None.
+//*****************************************************************************
+void startCapture(UINT16 intervals, UINT16 skew, UINT16 durationMs) 
+{
+  UINT32 ticks = (UINT32)durationMs * CAPTURE_TICKS_PER_MS;
+  
+  // clean out any old data in our tables.
+  captureValues = FALSE;
+  RING_RESET(captureRing);
+  intervalCount = 0;
+  resetResults(rangeLowerUs, rangeUpperUs);
+  
+  // one more timer value than intervals, the first edge only starts the clock.
+  captureTarget = intervals + 1;
+  glitchRejected = 0;
+  captureTimedOut = FALSE;
+  
+  // live mode bins from the first interval and starts the update clock now.
+  captureMode = outputMode;
+  binIndex = 0;
+  liveNextBucket = 0;
+  liveLastOverflow = timerOverflows;
+  clearTable(liveChangedBuckets, sizeof(liveChangedBuckets));
+  
+  // not a window capture, unless startWindow makes it one.
+  windowSize = 0;
+  
+  // a skew capture pairs each of its A edges with a B edge, the last A
+  // edge only closes the window of the one before.
+  skewCapture = skew;
+  RING_RESET(skewRing);
+  skewPartnered = FALSE;
+  skewPairs = 0;
+  skewMissing = 0;
+  skewExtra = 0;
+  skewLost = 0;
+  
+  // turn on recording the rising edge values. The edge count is taken with
+  // the interrupts masked and any stale capture thrown away, so every edge
+  // from here on is both counted and captured.
+  PROFILE_START(PROFILE_CAPTURE);
+  PROFILE_LATENCY_RESET();
+  HAL_DISABLE_INTERRUPTS();
+  HAL_CLEAR_CAPTURE1_FLAG();
+  HAL_CLEAR_CAPTURE2_FLAG();
+  if (skew == TRUE) 
+  {
+     HAL_CAPTURE2_INTERRUPT_ON();
+  }
+  captureStartEdges = HAL_READ_EDGE_COUNT();
+  if (durationMs != 0) 
+  {
+     // the compare comes round every trip of the timer, the first one the
+     // part of a trip left over.
+     captureComparesLeft = (UINT16)((ticks + 0xFFFFUL) >> 16);
+     HAL_SET_COMPARE3((UINT16)(HAL_READ_TIMER() + (UINT16)ticks));
+     HAL_CLEAR_COMPARE3_FLAG();
+     HAL_COMPARE3_INTERRUPT_ON();
+  }
+  captureValues = TRUE;
+  HAL_ENABLE_INTERRUPTS();
+}
+
+//*****************************************************************************
+// Turns off the recording of rising edges and hands the capture over to
+// processTask, which builds the histogram and tells the host it's done.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void finishCapture(void) 
+{
+  // turn off recording the rising edge values.
+  captureValues = FALSE;
+  HAL_CAPTURE2_INTERRUPT_OFF();
+  HAL_COMPARE3_INTERRUPT_OFF();
+  
+  // a capture that ran out of time can have stopped before its first edge.
+  intervalCount = (captureTarget != 0) ? captureTarget - 1 : 0;
+  // the glitches were counted by the pulse accumulator too.
+  captureDrops = (UINT8)(captureEndEdges - captureStartEdges - 
+                         (UINT8)captureTarget - (UINT8)glitchRejected);
+  PROFILE_STOP(PROFILE_CAPTURE, intervalCount);
+  PROFILE_START(PROFILE_PROCESS);
+  
+  // live mode sends what changed since the last update as well.
+  if (liveNextBucket == NO_BUCKET) 
+  {
+     liveNextBucket = 0;
+  }
+  
+  processing = TRUE;
+  TASK_RAISE(EVENT_PROCESS);
+}
+
+//*****************************************************************************
+// Starts a window capture, which keeps the histogram of the last intervals
+// only and runs until stopWindow. It goes through captureRing like any
+// other capture, but windowSlice takes the timer values out as they come,
+// so the ring goes round and OC1_isr is kept a ring full ahead.
+//
+// Parameters:
+//    intervals  Number of intervals in the window, 1 to WINDOW_MAX.
+//
+// Return: None.
+//*****************************************************************************
+void startWindow(UINT16 intervals) 
+{
+  UINT8 q = 0;
+  
+  // nothing is taken out of the ring before the task runs.
+  startCapture(CAPTURE_RING_SIZE - 1, FALSE, 0);
+  
+  windowSize = intervals;
+  windowCount = 0;
+  windowNext = 0;
+  windowStarted = FALSE;
+  for (q = 0; q < WINDOW_QUANTILES; ++q) 
+  {
+     windowQuantilePosition[q] = 0;
+     windowQuantileBelow[q] = 0;
+  }
+}
+
+//*****************************************************************************
+// Stops a window capture and leaves the histogram and the summary of the
+// window as the results, for DUMP and STATS. The timer values still in
+// captureRing are dropped.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void stopWindow(void) 
+{
+  captureValues = FALSE;
+  intervalCount = windowCount;
+  
+  // edges lost to a full ring can't be told from the ones taken out.
+  captureDrops = 0;
+  PROFILE_STOP(PROFILE_CAPTURE, intervalCount);
+}
+
+#ifdef CAPTURE_PAGED
+//*****************************************************************************
+// Deep capture. Moves the timer values waiting in the ring into paged
+// memory, with the page mapped once for the lot. Called by captureTask
+// while a capture is running, often enough that the ring doesn't fill up.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void drainCapture(void) 
+{
+  FarCursor cursor;
+  UINT16 waiting = RING_COUNT(captureRing);
+  UINT16 i;
+  
+  if (waiting == 0) 
+  {
+     return;
+  }
+  
+  FarCursorOpen(&cursor, CAPTURE_FIRST_PAGE, HAL_PAGE_WINDOW_START, 
+                captureRing.tail);
+  for (i = 0; i < waiting; ++i) 
+  {
+     FAR_CURSOR_WRITE(&cursor, 
+                      RING_PEEK(captureRing, timerValuesUs, CAPTURE_RING_SIZE, i));
+  }
+  FarCursorClose(&cursor);
+  
+  // only now can OC1_isr have the slots back.
+  RING_SKIP(captureRing, waiting);
+}
+#endif
+
+//*****************************************************************************
+// Bins up to BIN_SLICE of the intervals whose timer values are in, from where
+// the last slice stopped, and marks the buckets they went into for the live
+// updates. This is how the capture tasks build the histogram, a slice at a
+// time outside of the input capture interrupt. processTimerMeasurements
+// does the same in one go for the host tools.
+//
+// Parameters: None.
+//
+// Return: TRUE if there are intervals in that are still to be binned.
+//*****************************************************************************
+UINT8 binSlice(void) 
+{
+  CAPTURE_READER reader;
+  UINT16 stored = CAPTURE_STORED();
+  UINT16 count = 0;
+  UINT16 previous = 0;
+  UINT16 value = 0;
+  int bucket = 0;
+  
+  // the interval after timer value binIndex needs the next one to be in.
+  if (binIndex + 1 >= stored) 
+  {
+     return FALSE;
+  }
+  
+  count = stored - 1 - binIndex;
+  if (count > BIN_SLICE) 
+  {
+     count = BIN_SLICE;
+  }
+  
+  CAPTURE_OPEN(reader, binIndex);
+  CAPTURE_READ(reader, previous);
+  while (count-- != 0) 
+  {
+     CAPTURE_READ(reader, value);
+     bucket = processInterval((UINT16)(value - previous), rangeLowerUs, rangeUpperUs);
+     if (bucket != NO_BUCKET) 
+     {
+        liveChangedBuckets[bucket >> 3] |= (UINT8)(1 << (bucket & 7));
+     }
+     if (mapCells != 0) 
+     {
+        mapInterval((UINT16)(value - previous), rangeLowerUs, rangeUpperUs);
+     }
+     previous = value;
+     ++binIndex;
+  }
+  CAPTURE_CLOSE(reader);
+  
+  return (binIndex + 1 < stored) ? TRUE : FALSE;
+}
+
+//*****************************************************************************
+// Window capture. Takes up to BIN_SLICE timer values out of captureRing and
+// puts the intervals between them through the window, then lets OC1_isr
+// have the slots back. The first timer value only starts the clock.
+//
+// Parameters: None.
+//
+// Return: TRUE if there are timer values left in the ring.
+//*****************************************************************************
+UINT8 windowSlice(void) 
+{
+  UINT16 count = RING_COUNT(captureRing);
+  UINT16 value = 0;
+  UINT16 i = 0;
+  
+  if (count > BIN_SLICE) 
+  {
+     count = BIN_SLICE;
+  }
+  
+  for (i = 0; i < count; ++i) 
+  {
+     value = RING_PEEK(captureRing, timerValuesUs, CAPTURE_RING_SIZE, i);
+     if (windowStarted) 
+     {
+        windowInterval((UINT16)(value - windowPrevious));
+        ++binIndex;
+     }
+     windowPrevious = value;
+     windowStarted = TRUE;
+  }
+  
+  // the target follows tail round, so OC1_isr stops only on a full ring.
+  RING_SKIP(captureRing, count);
+  captureTarget = (UINT16)(captureRing.tail + CAPTURE_RING_SIZE);
+  
+  return RING_EMPTY(captureRing) ? FALSE : TRUE;
+}
+
+//*****************************************************************************
+// Skew capture. Pairs the A edges that are in with their B edges, from
+// where the last slice stopped, and bins the delays the way binSlice bins
+// the intervals. A slice takes at most BIN_SLICE B edges and A edges.
+//
+// The B edges that belong to A edge i are the ones before A edge i + 1: the
+// first is its partner and any more are extra. Which A edge a B edge came
+// after is the count IC2_isr stored with it, less one if it came just
+// before that A edge and had to wait for OC1_isr. Its delay is then a 16-bit
+// difference, which wraps the same way the timer does, so it comes out
+// right across an overflow as long as the A edges are less than a trip
+// round the timer apart. A B edge can still be waiting for IC2_isr when
+// A edge i + 1 is stored, so A edge i is only done with once a later B edge
+// has come in, A edge i + 2 has been stored or the capture is over.
+//
+// Parameters: None.
+//
+// Return: TRUE if the slice ran out with pairing still to do.
+//*****************************************************************************
+UINT8 pairSlice(void) 
+{
+  CAPTURE_READER reader;
+  UINT16 stored = CAPTURE_STORED();
+  UINT16 count = BIN_SLICE;
+  UINT16 a = 0;
+  UINT16 next = 0;
+  UINT16 b = 0;
+  UINT16 owner = 0;
+  UINT8 closed = FALSE;
+  int bucket = 0;
+  
+  if (binIndex + 1 >= stored) 
+  {
+     return FALSE;
+  }
+  
+  CAPTURE_OPEN(reader, binIndex);
+  CAPTURE_READ(reader, a);
+  while (count != 0 && binIndex + 1 < stored) 
+  {
+     CAPTURE_READ(reader, next);
+     closed = FALSE;
+     while (count != 0 && !RING_EMPTY(skewRing)) 
+     {
+        b = RING_PEEK(skewRing, skewValuesUs, SKEW_RING_SIZE, 0);
+        owner = (UINT16)(RING_PEEK(skewRing, skewAEdges, SKEW_RING_SIZE, 0) - 1);
+        if (owner == binIndex + 1 && b != next && 
+            (UINT16)(next - b) <= SKEW_EARLY_US) 
+        {
+           owner = binIndex;
+        }
+        else if (owner == binIndex && b != a && 
+                 (UINT16)(a - b) <= SKEW_EARLY_US) 
+        {
+           // it came before the first A edge, it has no A edge to pair with.
+           RING_SKIP(skewRing, 1);
+           --count;
+           ++skewExtra;
+           continue;
+        }
+        
+        if (owner != binIndex) 
+        {
+           closed = TRUE;
+           break;
+        }
+        
+        RING_SKIP(skewRing, 1);
+        --count;
+        if (skewPartnered == TRUE) 
+        {
+           ++skewExtra;
+        }
+        else 
+        {
+           skewPartnered = TRUE;
+           ++skewPairs;
+           bucket = processInterval((UINT16)(b - a), rangeLowerUs, rangeUpperUs);
+           if (bucket != NO_BUCKET) 
+           {
+              liveChangedBuckets[bucket >> 3] |= (UINT8)(1 << (bucket & 7));
+           }
+        }
+     }
+     
+     // out of time, or a B edge of this A edge may be on its way.
+     if (!closed && 
+         (count == 0 || (captureValues == TRUE && binIndex + 2 >= stored))) 
+     {
+        break;
+     }
+     
+     if (skewPartnered != TRUE) 
+     {
+        ++skewMissing;
+     }
+     skewPartnered = FALSE;
+     a = next;
+     ++binIndex;
+     --count;
+  }
+  CAPTURE_CLOSE(reader);
+  
+  return (count == 0) ? TRUE : FALSE;
+}
+
+//*****************************************************************************
+// Live mode. Sends one update line with up to LIVE_MAX_BUCKETS of the buckets
+// that changed since they were last sent:
+//
+//    LIVE <intervalsBinned> <bucket>:<count> ...
+//
+// Nothing is sent when no bucket has changed. liveNextBucket is left at
+// NO_BUCKET once every changed bucket has gone out.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void sendLiveUpdate(void) 
+{
+  int scanned = 0;
+  int sent = 0;
+  int bucket = liveNextBucket;
   
-  // if we pass post run the program otherwise go home.
-  if(post_function()) 
+  if (bucket == NO_BUCKET) 
   {
-     // Explain the program to the user.
-     (void) printf("This fine piece of crap program will give you a histogram of 1000 rising edge\r\n");
-     (void) printf("rising edge interarrival times.  It will display the results as a 100 bucket \r\n");
-     (void) printf("histogram in ascening order, with the lowest arrival time for that bucket\r\n");
-     (void) printf("displayed.\r\n\r\n");
-  
+     bucket = 0;
+  }
   
-     //start of main loop 
-     for(;;)
+  for (scanned = 0; scanned < numberOfBuckets; ++scanned) 
+  {
+     if (liveChangedBuckets[bucket >> 3] & (1 << (bucket & 7))) 
      {
-        // Check to see if the user wants another set of readings
-        (void) printf("Press s key to capture the readings or e to end the program. ");
-        userInput = GetChar();
-        (void)printf("%c", userInput);;
-    
-        if(userInput == 's') {
-          // clean out any old data in our tables.
-          index = 0;
-          memset(timerValuesUs, 0, sizeof(timerValuesUs));
-          memset(pulseIntervalsUs, 0, sizeof(pulseIntervalsUs));
-          memset(minimumHistogramValueUs, 0, sizeof(minimumHistogramValueUs));
-          memset(histogram, 0, sizeof(histogram));
-        
-           // Get the input
-           getMoronsInput(&lowerBoundaryUs, &upperBoundaryUs);
-  
-           // Debug code
-           //(void)printf("\r\nlowerBoundaryUs  %u\r\n",  lowerBoundaryUs);
-           //(void)printf("upperBoundaryUs  %u\r\n",  upperBoundaryUs);
-           //(void)printf("index  %u\r\n", index);
-           // end Debug code.    
- 
-           // get measurements when user pushes a key.  
-           (void) getMeasurements();
-  
-           // calculate the histogram and outputs.
-           (void) processTimerMeasurements(lowerBoundaryUs, upperBoundaryUs);
-  
-           // display results.
-           (void) displayResults();
-        } 
-        else if(userInput == 'e'){
-           // exit the program.
+        if (sent == LIVE_MAX_BUCKETS) 
+        {
+           // out of budget, carry on from here next time.
            break;
         }
+        if (sent == 0) 
+        {
+           PutString("LIVE ");
+           PutUnsigned(binIndex);
+        }
+        liveChangedBuckets[bucket >> 3] &= (UINT8)~(1 << (bucket & 7));
+        PutChar(' ');
+        PutUnsigned((UINT16)bucket);
+        PutChar(':');
+        PutUnsigned(histogram[bucket]);
+        ++sent;
+     }
+     
+     if (++bucket == numberOfBuckets) 
+     {
+        bucket = 0;
      }
   }
   
-  (void) printf("\r\n\r\nOk I'm outa here!!!\r\n\r\n");
+  if (sent != 0) 
+  {
+     PutNewLine();
+  }
+  
+  liveNextBucket = (scanned == numberOfBuckets) ? NO_BUCKET : bucket;
 }
 
+#include "hal_hot_end.h"
+
+// The paged display waits on the user.
+#include "hal_cold_begin.h"
+
 //*****************************************************************************
 // This unmitigated piece of crap will display the lowest value in each bucket
 // of the minimumHistogramValue table and the number of entries in the
@@ -304,7 +1601,6 @@ void main(void)
 void displayResults(void) 
 {
   int i = 0;
-  UINT8 userinput = 0;
   
   // This is debug code and will be ruthlessly commented out.
 /*          
@@ -319,134 +1615,339 @@ void displayResults(void)
 */  
           
   // Give them the instructions
-  (void)printf("Please press a key to show each histogram entry.\r\n");
+  PutString("Please press a key to show each histogram entry.\r\n");
   
-  userinput = GetChar();
+  (void) GetChar();
   
-  (void)printf("\r\nStart of the histogram results.\r\n"); 
+  PutString("\r\nStart of the histogram results.\r\n"); 
                  
   for (i = 0; i < numberOfBuckets; ++i) 
   {
      if (histogram[i] !=0) 
      {
        //(void)printf("histogram[%d]  %u\r\n", i, histogram[i]);
-       (void)printf("minimumValue %u  histogram[%d]  %u \r\n", minimumHistogramValueUs[i], i, histogram[i]);
-       userinput = GetChar();
+       PutString("minimumValue ");
+       PutUnsigned(minimumHistogramValueUs[i]);
+       PutString("  histogram[");
+       PutUnsigned((UINT16)i);
+       PutString("]  ");
+       PutUnsigned(histogram[i]);
+       PutString(" \r\n");
+       (void) GetChar();
      }
   };
   
-  (void)printf("End of the histogram results..\r\n\r\n"); 
+  PutString("End of the histogram results..\r\n\r\n"); 
   
 }
 
+#include "hal_cold_end.h"
+
+// The output.
+#include "hal_hot_begin.h"
 
 //*****************************************************************************
-// This unmitigated piece of crap will set the captureValues flag to true and
-// and then poll the index until we have MAXINPUTVALUES readings.
+// Dumps the complete histogram, the statistics and the out of range summary
+// without waiting for any keypresses. The layout is fixed so a host script can
+// parse it: one record per line, the record name first and the fields
+// separated by single spaces, framed by BEGIN/END lines.
+//
+//    BEGIN DUMP
+//    RANGE <lowerUs> <upperUs> <buckets> <bucketWidthUs>
+//    STATS <intervals> <minimumUs> <maximumUs> <meanUs with 1 decimal>
+//    OUTOFRANGE <below> <above>
+//    GLITCH <minimumUs> <rejected>
+//    SKEW <pairs> <missing> <extra> <lost>       (skew captures only)
+//    WINDOW <size> <intervals> <meanUs> <p50Us> <p99Us>
+//                                                (window captures only)
+//    BUCKET <index> <minimumValueUs> <count>     (one per bucket, empty ones too)
+//    END DUMP
 //
-// The measurements are stored in the timerValuesUs table in the global namespace. 
+// For a skew capture STATS, OUTOFRANGE and the buckets are over the delays
+// of the pairs instead of the intervals, see pairSlice. For a window capture
+// they are over the intervals in the window, except for the minimum and
+// maximum, which are over every interval since it started.
 //
-// Parameters: NONE
+// Parameters:
+//    lowerBoundaryUs  The lower boundary used to build the histogram.
+//    upperBoundaryUs  The upper boundary used to build the histogram.
 //
-// Return: NONE
+// Return: None.
 //*****************************************************************************
-void getMeasurements(void) 
+void dumpResults(UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs) 
 {
   int i = 0;
-  (void) printf("\r\nPress any key to capture the readings. ");
   
-  if(GetChar()) 
+  PutString("BEGIN DUMP\r\n");
+  
+  PutString("RANGE ");
+  PutUnsigned(lowerBoundaryUs);
+  PutChar(' ');
+  PutUnsigned(upperBoundaryUs);
+  PutChar(' ');
+  PutUnsigned((UINT16)numberOfBuckets);
+  PutChar(' ');
+  PutUnsigned(bucketWidthUs);
+  PutNewLine();
+  
+  reportStats();
+  
+  for (i = 0; i < numberOfBuckets; ++i) 
   {
-     // turn on recording the rising edge values.
-     captureValues = TRUE;
-     
-     // clean up our output to the screen.
-     (void) printf("\r\n\r\n");
+     PutString("BUCKET ");
+     PutUnsigned((UINT16)i);
+     PutChar(' ');
+     PutUnsigned(minimumHistogramValueUs[i]);
+     PutChar(' ');
+     PutUnsigned(histogram[i]);
+     PutNewLine();
   }
-    
-  while (index < MAXINPUTVALUES) {
-  // spin in a tight loop while we collect the data.
+  
+  PutString("END DUMP\r\n\r\n");
+}
+
+//*****************************************************************************
+// Writes the raw capture and what it takes to process it again, so a host
+// can replay it through the same code (host/replay.c). The timer values go
+// out as 4 hex digits, 16 to a line:
+//
+//    BEGIN TRACE
+//    TRACE <version> <busClockHz> <prescaleShift>
+//    RANGE <lowerUs> <upperUs> <buckets>
+//    GLITCH <minimumUs> <rejected>
+//    CAPTURE <intervals> <drops> <rxOverruns> <mode>
+//    VALUES <hex> ...                             (intervals + 1 values)
+//    END TRACE
+//
+// drops is the number of edges the capture missed, modulo 256, and rejected
+// the glitches it left out. mode is the MODE_ value the capture was made in.
+// Version 1 had no GLITCH line.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void traceResults(void) 
+{
+  CAPTURE_READER reader;
+  UINT16 value = 0;
+  UINT16 i = 0;
+  
+  PutString("BEGIN TRACE\r\nTRACE 2 ");
+  PutUnsignedLong(HAL_BUS_CLOCK_HZ);
+  PutChar(' ');
+  PutUnsigned(HAL_TIMER_PRESCALE_SHIFT);
+  PutNewLine();
+  
+  PutString("RANGE ");
+  PutUnsigned(rangeLowerUs);
+  PutChar(' ');
+  PutUnsigned(rangeUpperUs);
+  PutChar(' ');
+  PutUnsigned((UINT16)numberOfBuckets);
+  PutNewLine();
+  
+  PutString("GLITCH ");
+  PutUnsigned(glitchMinimumUs);
+  PutChar(' ');
+  PutUnsigned(glitchRejected);
+  PutNewLine();
+  
+  PutString("CAPTURE ");
+  PutUnsigned(intervalCount);
+  PutChar(' ');
+  PutUnsigned(captureDrops);
+  PutChar(' ');
+  PutUnsigned(rxOverruns);
+  PutChar(' ');
+  PutUnsigned(captureMode);
+  
+  CAPTURE_OPEN(reader, 0);
+  for (i = 0; i <= intervalCount; ++i) 
+  {
+     CAPTURE_READ(reader, value);
+     PutString((i & 15) ? " " : "\r\nVALUES ");
+     PutHex(value);
   }
-    
-  // turn off recording the rising edge values.
-  captureValues = FALSE;
-    
-  // This is debug code and will be ruthlessly commented out.  
-  /* 
-  for (i = 0; i < index; ++i) 
+  CAPTURE_CLOSE(reader);
+  
+  PutString("\r\nEND TRACE\r\n\r\n");
+}
+
+//*****************************************************************************
+// Writes the STATS, OUTOFRANGE and GLITCH records of the last capture, and
+// SKEW for a skew capture, in the layout described at dumpResults.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void reportStats(void) 
+{
+  // every A edge of a skew capture can have gone without a partner.
+  UINT16 binned = (skewCapture == TRUE) ? skewPairs : intervalCount;
+  
+  // the mean goes out with one decimal. The remainder is scaled by 10, not
+  // the sum, which would overflow for a deep capture.
+  PutString("STATS ");
+  PutUnsigned(binned);
+  PutChar(' ');
+  PutUnsigned(minimumIntervalUs);
+  PutChar(' ');
+  PutUnsigned(maximumIntervalUs);
+  PutChar(' ');
+  PutFixed((binned == 0) ? 0 : (intervalSumUs / binned) * 10 + 
+           ((intervalSumUs % binned) * 10) / binned, 1);
+  PutNewLine();
+  
+  PutString("OUTOFRANGE ");
+  PutUnsigned(belowRangeCount);
+  PutChar(' ');
+  PutUnsigned(aboveRangeCount);
+  PutNewLine();
+  
+  PutString("GLITCH ");
+  PutUnsigned(glitchMinimumUs);
+  PutChar(' ');
+  PutUnsigned(glitchRejected);
+  PutNewLine();
+  
+  if (windowSize != 0) 
   {
-       (void)printf("timerValuesUs[%d]  %u\r\n", i, timerValuesUs[i]);
-  };
-  */
+     reportWindow();
+  }
+  
+  if (skewCapture == TRUE) 
+  {
+     PutString("SKEW ");
+     PutUnsigned(skewPairs);
+     PutChar(' ');
+     PutUnsigned(skewMissing);
+     PutChar(' ');
+     PutUnsigned(skewExtra);
+     PutChar(' ');
+     PutUnsigned(skewLost);
+     PutNewLine();
+  }
 }
 
 //*****************************************************************************
-// This unmitigated piece of crap will get the upper and lower boundaries we
-// are going to use in the histogram.
+// Writes the WINDOW record of a window capture, in the layout described at
+// dumpResults. It only reads the running sums and the percentile positions,
+// so it takes the same time however big the window is.
 //
-// Parameters:
-//    lowerBoundaryUs  A pointer to where the lower boundary value is to be stored.
-//    upperBoundaryUs  A pointer to where the upper boundary value is to be stored.
+// Parameters: None.
 //
-// Return: A value between 0 and 65535 for each function argument.
+// Return: None.
 //*****************************************************************************
-void getMoronsInput(UINT16* lowerBoundaryUs, UINT16* upperBoundaryUs) 
-{  
-   // Get the lower range.
-   (void) printf("\r\nPlease enter the lower range in microseconds. ");
-   *lowerBoundaryUs = getUINT16Input();
-         
-   // Get the upper range.
-   (void) printf("\r\nPlease enter the upper range in microseconds. ");
-   *upperBoundaryUs = getUINT16Input();   
+void reportWindow(void) 
+{
+  UINT8 position = 0;
+  UINT8 q = 0;
+  
+  PutString("WINDOW ");
+  PutUnsigned(windowSize);
+  PutChar(' ');
+  PutUnsigned(windowCount);
+  PutChar(' ');
+  PutFixed((windowCount == 0) ? 0 : (intervalSumUs / windowCount) * 10 + 
+           ((intervalSumUs % windowCount) * 10) / windowCount, 1);
+  
+  // a percentile is the bottom of the bucket it is in, 0 below the range
+  // and 65535 above it.
+  for (q = 0; q < WINDOW_QUANTILES; ++q) 
+  {
+     position = windowQuantilePosition[q];
+     PutChar(' ');
+     if (position == 0) 
+     {
+        PutUnsigned(0);
+     }
+     else if (position > numberOfBuckets) 
+     {
+        PutUnsigned(65535);
+     }
+     else 
+     {
+        PutUnsigned((UINT16)(rangeLowerUs + (position - 1) * bucketWidthUs));
+     }
+  }
+  PutNewLine();
 }
 
 //*****************************************************************************
-// This unmitigated piece of crap will get UINT16 input from the keyboard and
-// turn it into something a drill sergent would be proud of.
+// Writes the return map of the last capture, a line for each row with
+// anything in it, with only the cells that have:
+//
+//    BEGIN MAP
+//    MAP <cells> <lowerUs> <cellWidthUs> <pairs> <outside>
+//    ROW <y> <x>:<count> ...
+//    END MAP
+//
+// Row y has the pairs whose second interval is in cell y, x is the cell of
+// the first. Cell x starts at lowerUs + x * cellWidthUs. The width is
+// rounded up, so the cells can end past the top of the range, and any that
+// start past it stay empty. outside is the pairs with an interval
+// out of the range, which aren't in the map.
 //
-// Parameters: NONE
+// Parameters: None.
 //
-// Return: A value between 0 and 65535
+// Return: None.
 //*****************************************************************************
-UINT16 getUINT16Input(void) 
+void dumpMap(void) 
 {
-   UINT8 buffer [6];
-   INT8 bufferIndex = 0;
-   UINT8 carriageRet = '\r';
-   UINT16 value = 0;
-   
-      // Read the digits into a buffer until you get a carage return.
-   do
-   { 
-      // Fetch and echo the user input
-      buffer[bufferIndex] = GetChar();
-      (void)printf("%c", buffer[bufferIndex]);
-      
-      // If it's a digit store it.
-      if(isdigit( buffer[bufferIndex]) && bufferIndex < 5) 
-      {
-        ++bufferIndex;
-      } 
-      else if (bufferIndex == 6) 
-      {
-        // Bugger this!!! Input is too long and we're breaking out of this loop crap. 
-        buffer[bufferIndex] = carriageRet;
-      }    
-   }
-   while( buffer[bufferIndex] != carriageRet); 
-   
-   // append a null character on the end of our array.
-   buffer[bufferIndex] = 0;
-   
-   // Debug code
-//   (void)printf("\n  buffer[bufferIndex] %s\n",  buffer); 
-   
-   value = atoi (buffer);
-      
-   return value;  
+  const UINT16* row = returnMap;
+  UINT16 x = 0;
+  UINT16 y = 0;
+  UINT8 empty = TRUE;
+  
+  PutString("BEGIN MAP\r\nMAP ");
+  PutUnsigned(mapCells);
+  PutChar(' ');
+  PutUnsigned(rangeLowerUs);
+  PutChar(' ');
+  PutUnsigned(mapCellWidthUs);
+  PutChar(' ');
+  PutUnsigned(mapPairs);
+  PutChar(' ');
+  PutUnsigned((UINT16)(intervalCount - 1 - mapPairs));
+  PutNewLine();
+  
+  for (y = 0; y < mapCells; ++y, row += mapCells) 
+  {
+     empty = TRUE;
+     for (x = 0; x < mapCells; ++x) 
+     {
+        if (row[x] == 0) 
+        {
+           continue;
+        }
+        if (empty) 
+        {
+           PutString("ROW ");
+           PutUnsigned(y);
+           empty = FALSE;
+        }
+        PutChar(' ');
+        PutUnsigned(x);
+        PutChar(':');
+        PutUnsigned(row[x]);
+     }
+     if (!empty) 
+     {
+        PutNewLine();
+     }
+  }
+  
+  PutString("END MAP\r\n\r\n");
 }
 
+
+#include "hal_hot_end.h"
+
+// The POST only runs at start up.
+#include "hal_cold_begin.h"
+
 //*****************************************************************************
 // This unmitigated piece of crap will test to make sure the timer is running
 // on the board.  If it is not running it will print an error message and fail.
@@ -459,10 +1960,10 @@ UINT16 getUINT16Input(void)
 UINT16 post_function(void){
   UINT16 timer_check_value1, timer_check_value2;   //Two values to check whether timer is running or not.
   UINT8 i;
-  timer_check_value1 =  TCNT;                      //Take first value at some time.
+  timer_check_value1 =  HAL_READ_TIMER();                      //Take first value at some time.
   for(i=0;i<200;i++) {                             //Take some rest before reading second value
   }
-  timer_check_value2 =  TCNT;                      //Take second value at some time
+  timer_check_value2 =  HAL_READ_TIMER();                      //Take second value at some time
   if (timer_check_value2 == timer_check_value1) {
     (void)printf("POST failed! You buggy man.\r\n");        //POST get failed. Big reason to worry!
     return FALSE;
@@ -470,6 +1971,11 @@ UINT16 post_function(void){
   return TRUE;
 }
 
+#include "hal_cold_end.h"
+
+// The binning.
+#include "hal_hot_begin.h"
+
 //*****************************************************************************
 // This unmitigated piece of crap will take the timing measurements and
 // insert them into the correct histogram bucket.  The histogram range is between
@@ -488,73 +1994,313 @@ UINT16 post_function(void){
 //*****************************************************************************
 void processTimerMeasurements(UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs) 
 {
-   const UINT16 maxUnsignedValue = 65535;                
-   int i = 0;
+   CAPTURE_READER reader;
+   UINT16 previous = 0;
+   UINT16 value = 0;
+   UINT16 i = 0;
+   
+   resetResults(lowerBoundaryUs, upperBoundaryUs);
+   
+   // Construct the histogram and update the lowest value for each histogram
+   // bucket, streaming over the timer values. The 16-bit subtraction wraps
+   // the same way the timer does, so an interval across a timer overflow
+   // comes out right without any special case.
+   CAPTURE_OPEN(reader, 0);
+   CAPTURE_READ(reader, previous);
+   for (i = 0; i < intervalCount; ++i) 
+   {
+      CAPTURE_READ(reader, value);
+      (void) processInterval((UINT16)(value - previous), lowerBoundaryUs, upperBoundaryUs);
+      if (mapCells != 0) 
+      {
+         mapInterval((UINT16)(value - previous), lowerBoundaryUs, upperBoundaryUs);
+      }
+      previous = value;
+   }
+   CAPTURE_CLOSE(reader);
+}
+
+//*****************************************************************************
+// Empties the histogram and the summary and works out the bucket size for
+// the range, ready for processInterval.
+//
+// Parameters:
+//    lowerBoundaryUs  The lower boundary of the histogram.
+//    upperBoundaryUs  The upper boundary of the histogram.
+//
+// Return: None.
+//*****************************************************************************
+void resetResults(UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs) 
+{
+   clearTable((UINT8*)minimumHistogramValueUs, sizeof(minimumHistogramValueUs));
+   clearTable((UINT8*)histogram, sizeof(histogram));
+   
+   // calculate out the size of each bucket, rounded up so the buckets
+   // cover the whole range. They can end past its top, and any that start
+   // past it stay empty.
+   bucketWidthUs = (UINT16)(upperBoundaryUs - lowerBoundaryUs - 1) / numberOfBuckets + 1;
+   
+   // start the summary from scratch.
+   belowRangeCount = 0;
+   aboveRangeCount = 0;
+   minimumIntervalUs = 65535;
+   maximumIntervalUs = 0;
+   intervalSumUs = 0;
+   
+   // the map is laid out for the cells set now, the cells rounded up the
+   // same as the buckets.
+   mapCells = mapCellsSet;
+   mapCellWidthUs = (mapCells != 0) ? 
+      (UINT16)(upperBoundaryUs - lowerBoundaryUs - 1) / mapCells + 1 : 1;
+   clearTable((UINT8*)returnMap, mapCells * mapCells * sizeof(returnMap[0]));
+   mapPairs = 0;
+   mapLastCell = NO_BUCKET;
+}
+
+//*****************************************************************************
+// Zeroes a table. memset comes from the banked ANSI library, a far call.
+//
+// Parameters:
+//    table  The table.
+//    bytes  Its size in bytes.
+//
+// Return: None.
+//*****************************************************************************
+void clearTable(UINT8* table, UINT16 bytes) 
+{
+   while (bytes != 0) 
+   {
+      *table++ = 0;
+      --bytes;
+   }
+}
+
+//*****************************************************************************
+// Adds one pulse interval, the difference of a pair of timer values, to the
+// histogram and the summary. One out of the range is only counted, it runs
+// while the capture does and has no time to write about it.
+//
+// Parameters:
+//    intervalUs       The interval.
+//    lowerBoundaryUs  The lower boundary of the histogram.
+//    upperBoundaryUs  The upper boundary of the histogram.
+//
+// Return: The histogram bucket the interval went into, or NO_BUCKET if it was
+//         out of range.
+//*****************************************************************************
+int processInterval(UINT16 intervalUs, UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs) 
+{
    int histogramIndex = 0;
-     
-   // calculate out the size of each bucket.
-   int quotent = (upperBoundaryUs - lowerBoundaryUs) / numberOfBuckets;
    
-   // calculate the pulse intervals and store them.
-   for (i = 0; i < MAXINPUTVALUES - 1; ++i) 
+   // keep the summary over every interval, in range or not.
+   intervalSumUs += intervalUs;
+   if (intervalUs < minimumIntervalUs) 
    {
-     if (  timerValuesUs [i] < timerValuesUs [i + 1]) 
-     {
-        pulseIntervalsUs[i] = timerValuesUs [i + 1] - timerValuesUs [i];
-     } 
-     else 
-     {
-         // don't mess with this function or you'll end up with a result greater than 65535.
-         // which means you'll get wrap around.
-         pulseIntervalsUs[i] = maxUnsignedValue - timerValuesUs [i] + timerValuesUs [i + 1];   
-     }
-     
-     // This is debug code 
-     //(void)printf("pulseIntervalsUs[%d]  %u\r\n", i, pulseIntervalsUs[i]);
+      minimumIntervalUs = intervalUs;
+   }
+   if (intervalUs > maximumIntervalUs) 
+   {
+      maximumIntervalUs = intervalUs;
+   }
+   
+   if(intervalUs < lowerBoundaryUs)
+   {
+     ++belowRangeCount;
+     return NO_BUCKET;
+   }
+   
+   if (intervalUs > upperBoundaryUs )
+   {
+      ++aboveRangeCount;
+      return NO_BUCKET;
+   } 
+   
+   // the value falls in the area of interest so add it to the histogram
+   
+   // calculate the index for the histogram
+   histogramIndex = ((intervalUs - lowerBoundaryUs) / bucketWidthUs);
+   
+   // the range is inclusive, so when the buckets cover it exactly its top
+   // lands one past the end. It belongs in the last bucket.
+   if (histogramIndex >= numberOfBuckets) 
+   {
+      histogramIndex = numberOfBuckets - 1;
+   }
+   
+   //(void)printf("histogramIndex %d = %u\r\n", i, histogramIndex);
+   
+   // Check to see if we need to update the lowest value for that bucket 
+   if (histogram[histogramIndex] == 0) 
+   {
+        // This bucket is empty.  Just add the value to it.
+        minimumHistogramValueUs[histogramIndex] = intervalUs;
+   } 
+   else if (intervalUs < minimumHistogramValueUs[histogramIndex]) 
+   {
+        // we have a new lowest value for that bucket.
+         minimumHistogramValueUs[histogramIndex] = intervalUs; 
    }
    
-    // Construct the histogram and update the lowest value for each histogram bucket.
-   for (i = 0; i < MAXINPUTVALUES - 1; ++i) 
+   // increment the histogram bucket;
+   ++histogram[histogramIndex]; 
+   
+   return histogramIndex;
+}
+
+//*****************************************************************************
+// Window capture. Adds an interval to the window, taking the oldest out
+// first once it's full: its bucket is counted down, its interval comes off
+// the sum, and the percentiles are moved along for both. Each percentile
+// only moves when the count below it has gone past its rank one way or the
+// other, which an interval in and one out can only do by one. It still steps
+// over every empty position on the way to the next interval, so in the worst
+// case, a window with nothing between the ends of the range, one percentile
+// walks numberOfBuckets + 1 positions, 101 steps, for one interval. With the
+// intervals bunched together as usual it's a step or two.
+//
+// A position is 0 for below the range, the bucket + 1, or numberOfBuckets
+// + 1 for above. The rank of percentile p of n intervals is the 
+// ceil(p * n / 100)th smallest.
+//
+// Parameters:
+//    intervalUs  The interval.
+//
+// Return: None.
+//*****************************************************************************
+void windowInterval(UINT16 intervalUs) 
+{
+   UINT8 position = 0;
+   UINT8 q = 0;
+   UINT16 rank = 0;
+   int bucket = 0;
+   
+   if (windowCount == windowSize) 
    {
-      if(pulseIntervalsUs[i] < lowerBoundaryUs)
+      position = windowPositions[windowNext];
+      intervalSumUs -= windowIntervalsUs[windowNext];
+      if (position == 0) 
       {
-        (void)printf("Error: pulseIntervalsUs[%d] %u is below the lower range\r\n", i, pulseIntervalsUs[i]);
+         --belowRangeCount;
       }
-      else if (pulseIntervalsUs[i] > upperBoundaryUs )
+      else if (position > numberOfBuckets) 
       {
-         (void)printf("Error:pulseIntervalsUs[%d] %u is above the upper range\r\n", i, pulseIntervalsUs[i]);
-      } 
+         --aboveRangeCount;
+      }
       else 
       {
-         // the value falls in the area of interest so add it to the histogram
-         
-         // calculate the index for the histogram
-         histogramIndex = ((pulseIntervalsUs[i] - lowerBoundaryUs) / quotent);
-         
-         //(void)printf("histogramIndex %d = %u\r\n", i, histogramIndex);
-         
-         // Check to see if we need to update the lowest value for that bucket 
-         if (histogram[histogramIndex] == 0) 
-         {
-              // This bucket is empty.  Just add the value to it.
-              minimumHistogramValueUs[histogramIndex] = pulseIntervalsUs[i];
-              
-              // This is debug code  
-              // (void)printf("Empty Bucket %d minimumHistogramValue[%d]  %u\r\n", i, histogramIndex, minimumHistogramValue[i]);
-         } 
-         else if (pulseIntervalsUs[i] < minimumHistogramValueUs[histogramIndex]) 
+         bucket = position - 1;
+         --histogram[bucket];
+         liveChangedBuckets[bucket >> 3] |= (UINT8)(1 << (bucket & 7));
+      }
+      for (q = 0; q < WINDOW_QUANTILES; ++q) 
+      {
+         if (position < windowQuantilePosition[q]) 
          {
-              // we have a new lowest value for that bucket.
-               minimumHistogramValueUs[histogramIndex] = pulseIntervalsUs[i]; 
-                   
-               // This is debug code  
-               // (void)printf("Changed value is %d minimumHistogramValue[%d]  %u\r\n", i, histogramIndex, minimumHistogramValue[i]);
+            --windowQuantileBelow[q];
          }
-         
-         // increment the histogram bucket;
-         ++histogram[histogramIndex]; 
       }
    }
+   else 
+   {
+      ++windowCount;
+   }
+   
+   bucket = processInterval(intervalUs, rangeLowerUs, rangeUpperUs);
+   if (bucket != NO_BUCKET) 
+   {
+      liveChangedBuckets[bucket >> 3] |= (UINT8)(1 << (bucket & 7));
+      position = (UINT8)(bucket + 1);
+   }
+   else 
+   {
+      position = (intervalUs < rangeLowerUs) ? 0 : (UINT8)(numberOfBuckets + 1);
+   }
+   
+   windowIntervalsUs[windowNext] = intervalUs;
+   windowPositions[windowNext] = position;
+   if (++windowNext == windowSize) 
+   {
+      windowNext = 0;
+   }
+   
+   for (q = 0; q < WINDOW_QUANTILES; ++q) 
+   {
+      if (position < windowQuantilePosition[q]) 
+      {
+         ++windowQuantileBelow[q];
+      }
+      
+      rank = (UINT16)((windowCount * windowPercent[q] + 99) / 100 - 1);
+      while (windowQuantileBelow[q] > rank) 
+      {
+         --windowQuantilePosition[q];
+         windowQuantileBelow[q] -= windowPositionCount(windowQuantilePosition[q]);
+      }
+      while (windowQuantileBelow[q] + 
+             windowPositionCount(windowQuantilePosition[q]) <= rank) 
+      {
+         windowQuantileBelow[q] += windowPositionCount(windowQuantilePosition[q]);
+         ++windowQuantilePosition[q];
+      }
+   }
+}
+
+//*****************************************************************************
+// Window capture. Number of intervals in the window at a position, see
+// windowInterval.
+//
+// Parameters:
+//    position  The position.
+//
+// Return: The number of intervals.
+//*****************************************************************************
+UINT16 windowPositionCount(UINT8 position) 
+{
+   if (position == 0) 
+   {
+      return belowRangeCount;
+   }
+   if (position > numberOfBuckets) 
+   {
+      return aboveRangeCount;
+   }
+   return histogram[position - 1];
+}
+
+//*****************************************************************************
+// Adds an interval to the return map, paired with the one before it. Called
+// after processInterval for each interval in turn, while mapCells isn't 0.
+// A pair with either interval out of the range isn't counted.
+//
+// Parameters:
+//    intervalUs       The interval.
+//    lowerBoundaryUs  The lower boundary of the histogram.
+//    upperBoundaryUs  The upper boundary of the histogram.
+//
+// Return: None.
+//*****************************************************************************
+void mapInterval(UINT16 intervalUs, UINT16 lowerBoundaryUs, UINT16 upperBoundaryUs) 
+{
+   int cell = NO_BUCKET;
+   
+   if (intervalUs >= lowerBoundaryUs && intervalUs <= upperBoundaryUs) 
+   {
+      // the range is inclusive, so when the cells cover it exactly its top
+      // lands one past the last one, the same as in processInterval.
+      cell = (intervalUs - lowerBoundaryUs) / mapCellWidthUs;
+      if (cell >= (int)mapCells) 
+      {
+         cell = (int)mapCells - 1;
+      }
+      
+      if (mapLastCell != NO_BUCKET) 
+      {
+         ++returnMap[cell * (int)mapCells + mapLastCell];
+         ++mapPairs;
+      }
+   }
+   
+   mapLastCell = cell;
 }
 
- 
+#include "hal_hot_end.h"
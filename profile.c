@@ -0,0 +1,178 @@
+/******************************************************************************
+ * Stage profiler
+ *
+ * Description:
+ *
+ * See profile.h. The report is one line per stage:
+ *
+ *    BEGIN PROFILE
+ *    PROBE <cycles one probe takes>
+ *    LATENCY <worst capture latency in cycles>
+ *    STAGE <name> <cycles> <samples> <cycles per sample> <bytes> <cycles per byte>
+ *    END PROFILE
+ *
+ * Cycles are bus cycles, the timer ticks scaled by the prescaler. The per
+ * sample and per byte figures are 0 when the stage had none.
+ *
+ *****************************************************************************/
+
+// project includes
+#include "hal.h"
+#include "format.h"
+#include "profile.h"
+
+// Definitions
+
+typedef struct
+{
+   UINT32 start;          // time the stage started
+   UINT32 ticks;          // timer ticks the last run took
+   UINT16 startBytes;     // profileBytes when it started
+   UINT16 bytes;          // bytes sent during the last run
+   UINT16 samples;        // samples it worked on
+} ProfileStage;
+
+// Overflow count kept by TOF_isr, see main.c.
+extern volatile UINT16 timerOverflows;
+
+UINT16 profileBytes = 0;
+volatile UINT16 profileLatency = 0;
+
+static ProfileStage stages[PROFILE_STAGES];
+
+static const char* const stageNames[PROFILE_STAGES] =
+{
+   "CAPTURE", "PROCESS", "OUTPUT"
+};
+
+// The probes run on the hot paths they time.
+#include "hal_hot_begin.h"
+
+//*****************************************************************************
+// Reads the timer extended by the overflow count. The count is read on both
+// sides of the timer so an overflow interrupt in between is caught, and an
+// overflow that hasn't been serviced yet is added in when the timer value
+// shows it has wrapped.
+//
+// Parameters: None.
+//
+// Return: Timer ticks since the timer started.
+//*****************************************************************************
+UINT32 ProfileNow(void)
+{
+   UINT16 high;
+   UINT16 low;
+   UINT8 pending;
+
+   do
+   {
+      high = timerOverflows;
+      low = HAL_READ_TIMER();
+      pending = (UINT8)(HAL_OVERFLOW_PENDING() != 0);
+   }
+   while (high != timerOverflows);
+
+   if (pending && low < 0x8000)
+   {
+      ++high;
+   }
+
+   return ((UINT32)high << 16) | low;
+}
+
+//*****************************************************************************
+// Probe at the start of a stage.
+//
+// Parameters:
+//    stage  PROFILE_ stage.
+//
+// Return: None.
+//*****************************************************************************
+void ProfileStart(UINT8 stage)
+{
+   stages[stage].startBytes = profileBytes;
+   stages[stage].start = ProfileNow();
+}
+
+//*****************************************************************************
+// Probe at the end of a stage.
+//
+// Parameters:
+//    stage    PROFILE_ stage.
+//    samples  Samples the stage worked on, 0 for none.
+//
+// Return: None.
+//*****************************************************************************
+void ProfileStop(UINT8 stage, UINT16 samples)
+{
+   stages[stage].ticks = ProfileNow() - stages[stage].start;
+   stages[stage].bytes = (UINT16)(profileBytes - stages[stage].startBytes);
+   stages[stage].samples = samples;
+}
+
+#include "hal_hot_end.h"
+
+// The report only runs on request.
+#include "hal_cold_begin.h"
+
+//*****************************************************************************
+// Writes a cost per unit, 0 when there were no units.
+//
+// Parameters:
+//    cycles  The total.
+//    units   What it's divided by.
+//
+// Return: None.
+//*****************************************************************************
+static void putPerUnit(UINT32 cycles, UINT16 units)
+{
+   PutChar(' ');
+   PutUnsignedLong(units ? cycles / units : 0);
+}
+
+//*****************************************************************************
+// Writes the report of the last run of every stage.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void ProfileReport(void)
+{
+   UINT32 cycles;
+   UINT8 i;
+
+   PutString("BEGIN PROFILE\r\n");
+
+   // what a probe costs, so it can be taken off short stages.
+   cycles = ProfileNow();
+   cycles = ProfileNow() - cycles;
+   PutString("PROBE ");
+   PutUnsignedLong(cycles << HAL_TIMER_PRESCALE_SHIFT);
+   PutNewLine();
+
+   PutString("LATENCY ");
+   PutUnsignedLong((UINT32)profileLatency << HAL_TIMER_PRESCALE_SHIFT);
+   PutNewLine();
+
+   for (i = 0; i < PROFILE_STAGES; ++i)
+   {
+      cycles = stages[i].ticks << HAL_TIMER_PRESCALE_SHIFT;
+
+      PutString("STAGE ");
+      PutString(stageNames[i]);
+      PutChar(' ');
+      PutUnsignedLong(cycles);
+      PutChar(' ');
+      PutUnsigned(stages[i].samples);
+      putPerUnit(cycles, stages[i].samples);
+      PutChar(' ');
+      PutUnsigned(stages[i].bytes);
+      putPerUnit(cycles, stages[i].bytes);
+      PutNewLine();
+   }
+
+   PutString("END PROFILE\r\n");
+}
+
+#include "hal_cold_end.h"
@@ -0,0 +1,82 @@
+/******************************************************************************
+ * Stage profiler
+ *
+ * Description:
+ *
+ * Times the stages of a capture on the target with the free running
+ * counter, extended to 32 bits by the overflow count. A probe at the start
+ * and the end of each stage records the time, the bytes sent through
+ * PutChar in between and, for the stages that work on the capture,
+ * the number of samples. The PROFILE command reports the last run of each
+ * stage, see ProfileReport.
+ *
+ * OC1_isr also records the worst capture latency of the last capture, how
+ * long after its edge it got to read the captured value. The timestamp
+ * itself is latched by the hardware at the edge, so the latency doesn't
+ * make it any less accurate, but an edge that comes in before the last one
+ * has been read overwrites it and is lost.
+ *
+ * A probe is a couple of loads and stores, cheap enough to leave in the
+ * production build. Defining PROFILE_OFF compiles them out all the same.
+ *
+ *****************************************************************************/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "types.h"
+
+// The stages.
+#define PROFILE_CAPTURE  0   // CAPTURE command to the last edge
+#define PROFILE_PROCESS  1   // building the histogram from the capture
+#define PROFILE_OUTPUT   2   // DUMP and STATS, mostly PutChar
+#define PROFILE_STAGES   3
+
+// Bytes sent through PutChar, it counts them with PROFILE_BYTE().
+extern UINT16 profileBytes;
+
+// Worst capture latency in timer ticks, kept by PROFILE_LATENCY().
+extern volatile UINT16 profileLatency;
+
+// The probes are on the hot paths, see hal_hot_begin.h.
+#include "hal_hot_begin.h"
+
+// Timer ticks since the timer started, overflows included.
+UINT32 ProfileNow(void);
+
+void ProfileStart(UINT8 stage);
+void ProfileStop(UINT8 stage, UINT16 samples);
+
+#include "hal_hot_end.h"
+
+// Writes the report, framed by BEGIN PROFILE and END PROFILE.
+#include "hal_cold_begin.h"
+void ProfileReport(void);
+#include "hal_cold_end.h"
+
+#ifdef PROFILE_OFF
+#define PROFILE_START(stage)           ((void)0)
+#define PROFILE_STOP(stage, samples)   ((void)0)
+#define PROFILE_BYTE()                 ((void)0)
+#define PROFILE_LATENCY(capture)       ((void)0)
+#define PROFILE_LATENCY_RESET()        ((void)0)
+#else
+#define PROFILE_START(stage)           ProfileStart(stage)
+#define PROFILE_STOP(stage, samples)   ProfileStop((stage), (samples))
+#define PROFILE_BYTE()                 (++profileBytes)
+
+// In the capture interrupt, with the value the edge latched. The timer is
+// read straight after it, the difference is the latency in ticks.
+#define PROFILE_LATENCY(capture)                                      \
+   do                                                                 \
+   {                                                                  \
+      UINT16 profileTicks = (UINT16)(HAL_READ_TIMER() - (capture));   \
+      if (profileTicks > profileLatency)                              \
+      {                                                               \
+         profileLatency = profileTicks;                               \
+      }                                                               \
+   } while (0)
+#define PROFILE_LATENCY_RESET()        (profileLatency = 0)
+#endif
+
+#endif // PROFILE_H
@@ -0,0 +1,90 @@
+/******************************************************************************
+ * Single producer, single consumer ring
+ *
+ * Description:
+ *
+ * The queue between an interrupt service routine and the main loop. One
+ * side only ever puts values in and the other only ever takes them out, so
+ * neither has to mask interrupts or take a lock:
+ *
+ *    head  values put in so far, written by the producer only
+ *    tail  values taken out so far, written by the consumer only
+ *
+ * Both counts run freely over 16 bits and a value's slot is its count
+ * masked with the size, which has to be a power of two. head - tail is the
+ * number of values waiting, so a full ring and an empty one can be told
+ * apart without a spare slot.
+ *
+ * The HCS12 loads and stores 16 bits in one instruction, which an interrupt
+ * can't split, so each side always sees a count the other side really
+ * wrote. At worst it is one that has since moved on, which only makes the
+ * ring look fuller to the producer or emptier to the consumer than it is.
+ *
+ * The producer stores the value before it moves head on, and the consumer
+ * reads it before it moves tail on, which hands the slot back. The counts
+ * and the buffer have to be volatile so the compiler keeps those accesses
+ * in that order at any optimisation level. The CPU doesn't reorder them.
+ *
+ *    volatile UINT16 buffer[SIZE];
+ *    Ring ring;
+ *
+ *    producer, an ISR                  consumer, the main loop
+ *    if (!RING_FULL(ring, SIZE))       while (!RING_EMPTY(ring))
+ *    {                                 {
+ *       RING_PUT(ring, buffer,            RING_GET(ring, buffer, SIZE,
+ *                SIZE, value);                     value);
+ *    }                                    ...
+ *                                      }
+ *
+ * A ring at least as big as the values that ever go through it before a
+ * RING_RESET never wraps, so value i stays in slot i, and once the producer
+ * has stopped the buffer can be read as a plain array.
+ *
+ *****************************************************************************/
+
+#ifndef RING_H
+#define RING_H
+
+#include "types.h"
+
+typedef struct
+{
+   volatile UINT16 head;
+   volatile UINT16 tail;
+} Ring;
+
+// Empties the ring. Only while the producer is stopped.
+#define RING_RESET(ring)             ((ring).head = 0, (ring).tail = 0)
+
+// Values waiting, on either side.
+#define RING_COUNT(ring)             ((UINT16)((ring).head - (ring).tail))
+#define RING_EMPTY(ring)             ((ring).head == (ring).tail)
+
+// Producer. Puts a value in, there has to be room for it.
+#define RING_FULL(ring, size)        (RING_COUNT(ring) >= (UINT16)(size))
+#define RING_PUT(ring, buffer, size, value)                 \
+   do                                                       \
+   {                                                        \
+      UINT16 ringHead = (ring).head;                        \
+      (buffer)[ringHead & ((size) - 1)] = (value);          \
+      (ring).head = (UINT16)(ringHead + 1);                 \
+   } while (0)
+
+// Consumer. Takes the oldest value out, there has to be one.
+#define RING_GET(ring, buffer, size, value)                 \
+   do                                                       \
+   {                                                        \
+      UINT16 ringTail = (ring).tail;                        \
+      (value) = (buffer)[ringTail & ((size) - 1)];          \
+      (ring).tail = (UINT16)(ringTail + 1);                 \
+   } while (0)
+
+// Consumer. Reads the value i places after the oldest without taking it,
+// and hands back the slots of the oldest count values, which have been
+// read with RING_PEEK. A batch of values costs one update of tail that way.
+#define RING_PEEK(ring, buffer, size, i)                    \
+   ((buffer)[(UINT16)((ring).tail + (i)) & ((size) - 1)])
+#define RING_SKIP(ring, count)                              \
+   ((ring).tail = (UINT16)((ring).tail + (count)))
+
+#endif // RING_H
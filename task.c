@@ -0,0 +1,82 @@
+/******************************************************************************
+ * Cooperative task scheduler
+ *
+ * Description:
+ *
+ * See task.h. This is the main loop, so it stays in the default segment
+ * with main(). The tasks are called through a pointer of the default kind
+ * and have to be defined in the default segment too, a near function would
+ * return the wrong way. They call down into the hot code themselves.
+ *
+ *****************************************************************************/
+
+// project includes
+#include "hal.h"
+#include "task.h"
+
+volatile TaskEvents taskEvents = 0;
+
+// Cleared by TaskStop.
+static UINT8 taskRunning = 0;
+
+//*****************************************************************************
+// Runs the tasks until one of them calls TaskStop. The events are taken with
+// the interrupts masked and left masked into the sleep, so one that comes
+// in between the check and the WAI still wakes the CPU, see
+// HAL_SLEEP_UNTIL_INTERRUPT.
+//
+// Sleeping instead of spinning saves power and heat, and keeps the CPU off
+// the bus so the capture interrupt is entered with less jitter. WAI also
+// has the registers stacked already when the interrupt arrives.
+//
+// Parameters:
+//    tasks  The task table, highest priority first.
+//    count  Number of tasks in it.
+//
+// Return: None.
+//*****************************************************************************
+void TaskRun(const Task* tasks, UINT8 count)
+{
+   TaskEvents ready = 0;
+   TaskEvents again;
+   UINT8 i;
+
+   taskRunning = 1;
+   while (taskRunning)
+   {
+      HAL_DISABLE_INTERRUPTS();
+      ready |= taskEvents;
+      taskEvents = 0;
+      if (ready == 0)
+      {
+         // nothing to do until the next edge, overflow or character.
+         HAL_SLEEP_UNTIL_INTERRUPT();
+         continue;
+      }
+      HAL_ENABLE_INTERRUPTS();
+
+      // one slice for each ready task, the ones that aren't done stay ready.
+      again = 0;
+      for (i = 0; i < count && taskRunning; ++i)
+      {
+         if ((tasks[i].events & ready) != 0 && tasks[i].run())
+         {
+            again |= tasks[i].events;
+         }
+      }
+      ready = again;
+   }
+}
+
+//*****************************************************************************
+// Makes TaskRun return once the task calling this is done. The tasks after
+// it in the table don't get their slice of this pass.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void TaskStop(void)
+{
+   taskRunning = 0;
+}
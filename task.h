@@ -0,0 +1,77 @@
+/******************************************************************************
+ * Cooperative task scheduler
+ *
+ * Description:
+ *
+ * Runs the work of the main loop as tasks that each take a bounded slice of
+ * it and return, so a long job like building the histogram of a deep
+ * capture doesn't hold up the commands or the output. Nothing is preempted:
+ * a task runs to the end of its slice, and the interrupts are the only
+ * thing that gets in between.
+ *
+ * The interrupt service routines raise events, one bit each, and every task
+ * waits on the events it is there to handle:
+ *
+ *    static const Task tasks[] =
+ *    {
+ *       { EVENT_EDGE, captureTask },     highest priority first
+ *       { EVENT_RX,   commandTask },
+ *    };
+ *
+ *    OC1_isr:   TASK_RAISE(EVENT_EDGE);
+ *    main:      TaskRun(tasks, 2);
+ *
+ * TaskRun takes the events raised since its last pass and gives every task
+ * one of them is for a slice, in table order. A task returns TRUE when it
+ * has more to do, which keeps it ready for the next pass without an event.
+ * With nothing ready the CPU sleeps until the next interrupt.
+ *
+ * One pass takes at most the slices of all the tasks, so that bounds how
+ * long any of them waits once its event is in. An event belongs to one
+ * task.
+ *
+ *****************************************************************************/
+
+#ifndef TASK_H
+#define TASK_H
+
+#include "types.h"
+
+// A set of events, one bit each.
+typedef UINT8 TaskEvents;
+
+// One entry of the task table.
+typedef struct
+{
+   TaskEvents events;           // what makes the task ready
+   UINT8 (*run)(void);          // runs one slice, TRUE to be run again
+} Task;
+
+// Events raised and not yet taken by TaskRun.
+extern volatile TaskEvents taskEvents;
+
+// Raises events, from an interrupt service routine or a task. With a
+// constant it compiles to one BSET, which an interrupt can't split.
+#define TASK_RAISE(events)  (taskEvents |= (TaskEvents)(events))
+
+//*****************************************************************************
+// Runs the tasks until one of them calls TaskStop.
+//
+// Parameters:
+//    tasks  The task table, highest priority first.
+//    count  Number of tasks in it.
+//
+// Return: None.
+//*****************************************************************************
+void TaskRun(const Task* tasks, UINT8 count);
+
+//*****************************************************************************
+// Makes TaskRun return once the task calling this is done.
+//
+// Parameters: None.
+//
+// Return: None.
+//*****************************************************************************
+void TaskStop(void);
+
+#endif // TASK_H
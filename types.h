@@ -11,6 +11,19 @@
  *
  *****************************************************************************/
 
+#ifndef TYPES_H
+#define TYPES_H
+
+// The host build (HAL_HOST) runs on a workstation where int and long are
+// wider than on the HCS12. Pin the types to the target's sizes so the
+// 16-bit arithmetic wraps the same way on both.
+#ifdef HAL_HOST
+#define INT16   short
+#define UINT16  unsigned short
+#define INT32   int
+#define UINT32  unsigned int
+#endif
+
 // Signed 8-bit Type
 #ifndef INT8
 typedef signed char         INT8;
@@ -40,3 +53,5 @@ typedef unsigned int        UINT16;
 #ifndef UINT32
 typedef unsigned long int   UINT32;
 #endif
+
+#endif // TYPES_H